@@ -16,6 +16,7 @@
 
 #include "aidl.h"
 
+#include <algorithm>
 #include <fcntl.h>
 #include <iostream>
 #include <map>
@@ -24,6 +25,7 @@
 #include <string.h>
 #include <sys/param.h>
 #include <sys/stat.h>
+#include <thread>
 #include <unistd.h>
 
 #ifdef _WIN32
@@ -35,12 +37,18 @@
 #include <android-base/strings.h>
 
 #include "aidl_language.h"
+#include "archive_io_delegate.h"
 #include "generate_cpp.h"
 #include "generate_java.h"
 #include "import_resolver.h"
 #include "logging.h"
+#include "mem_stats.h"
 #include "options.h"
 #include "os.h"
+#include "preprocessed_file.h"
+#include "srcjar.h"
+#include "thread_pool.h"
+#include "trace.h"
 #include "type_cpp.h"
 #include "type_java.h"
 #include "type_namespace.h"
@@ -50,7 +58,6 @@
 #endif
 
 using android::base::Join;
-using android::base::Split;
 using std::cerr;
 using std::endl;
 using std::map;
@@ -69,6 +76,9 @@ namespace {
 const int kMinUserSetMethodId = 0;
 const int kMaxUserSetMethodId = 16777214;
 
+// How many of the inputs that took longest a timings report lists.
+const size_t kMaxSlowestInputs = 20;
+
 bool check_filename(const std::string& filename,
                     const std::string& package,
                     const std::string& name,
@@ -245,6 +255,21 @@ int check_types(const string& filename,
   return err;
 }
 
+// Files imported from an archive stand for the archive itself, which is the
+// file the build system knows about.
+void add_dep_source(const string& filename, vector<string>* sources) {
+  string archive_path;
+  string entry_name;
+  if (SplitArchivePath(filename, &archive_path, &entry_name)) {
+    if (std::find(sources->begin(), sources->end(), archive_path) ==
+        sources->end()) {
+      sources->push_back(archive_path);
+    }
+  } else if (!filename.empty()) {
+    sources->push_back(filename);
+  }
+}
+
 void write_common_dep_file(const string& output_file,
                            const vector<string>& aidl_sources,
                            CodeWriter* writer,
@@ -280,9 +305,7 @@ bool write_java_dep_file(const JavaOptions& options,
 
   vector<string> source_aidl = {options.input_file_name_};
   for (const auto& import : imports) {
-    if (!import->GetFilename().empty()) {
-      source_aidl.push_back(import->GetFilename());
-    }
+    add_dep_source(import->GetFilename(), &source_aidl);
   }
 
   write_common_dep_file(output_file_name, source_aidl, writer.get(),
@@ -310,9 +333,7 @@ bool write_cpp_dep_file(const CppOptions& options,
 
   vector<string> source_aidl = {options.InputFileName()};
   for (const auto& import : imports) {
-    if (!import->GetFilename().empty()) {
-      source_aidl.push_back(import->GetFilename());
-    }
+    add_dep_source(import->GetFilename(), &source_aidl);
   }
 
   write_common_dep_file(options.OutputCppFilePath(), source_aidl, writer.get(),
@@ -449,32 +470,49 @@ bool validate_constants(const AidlInterface& interface) {
 }
 
 // TODO: Remove this in favor of using the YACC parser b/25479378
-bool ParsePreprocessedLine(const string& line, string* decl,
-                           vector<string>* package, string* class_name) {
+bool ParsePreprocessedLine(const char* line, size_t length,
+                           PreprocessedKind* kind, string* package,
+                           string* class_name) {
+  auto is_blank = [](char c) { return c == ' ' || c == '\t'; };
+
   // erase all trailing whitespace and semicolons
-  const size_t end = line.find_last_not_of(" ;\t");
-  if (end == string::npos) {
+  const char* end = line + length;
+  while (end != line && (is_blank(end[-1]) || end[-1] == ';')) {
+    --end;
+  }
+  if (end == line) {
     return false;
   }
-  if (line.rfind(';', end) != string::npos) {
+  if (memchr(line, ';', end - line) != nullptr) {
     return false;
   }
 
-  decl->clear();
+  string decl;
   string type;
-  vector<string> pieces = Split(line.substr(0, end + 1), " \t");
-  for (const string& piece : pieces) {
-    if (piece.empty()) {
+  for (const char* p = line; p != end; ) {
+    if (is_blank(*p)) {
+      ++p;
       continue;
     }
-    if (decl->empty()) {
-      *decl = std::move(piece);
+    const char* piece = p;
+    while (p != end && !is_blank(*p)) {
+      ++p;
+    }
+    if (decl.empty()) {
+      decl.assign(piece, p - piece);
     } else if (type.empty()) {
-      type = std::move(piece);
+      type.assign(piece, p - piece);
     } else {
       return false;
     }
   }
+  if (decl == "parcelable") {
+    *kind = PreprocessedKind::PARCELABLE;
+  } else if (decl == "interface") {
+    *kind = PreprocessedKind::INTERFACE;
+  } else {
+    return false;
+  }
 
   // Note that this logic is absolutely wrong.  Given a parcelable
   // org.some.Foo.Bar, the class name is Foo.Bar, but this code will claim that
@@ -484,7 +522,7 @@ bool ParsePreprocessedLine(const string& line, string* decl,
   size_t dot_pos = type.rfind('.');
   if (dot_pos != string::npos) {
     *class_name = type.substr(dot_pos + 1);
-    *package = Split(type.substr(0, dot_pos), ".");
+    *package = type.substr(0, dot_pos);
   } else {
     *class_name = type;
     package->clear();
@@ -498,47 +536,56 @@ bool ParsePreprocessedLine(const string& line, string* decl,
 namespace internals {
 
 bool parse_preprocessed_file(const IoDelegate& io_delegate,
-                             const string& filename, TypeNamespace* types) {
+                             const string& filename, TypeNamespace* types,
+                             FileState* state) {
   bool success = true;
-  unique_ptr<LineReader> line_reader = io_delegate.GetLineReader(filename);
-  if (!line_reader) {
+  if (state && !state->Record(io_delegate, filename)) {
+    LOG(ERROR) << "cannot open preprocessed file: " << filename;
+    return false;
+  }
+  // Preprocessed files can run to tens of thousands of lines, so walk them in
+  // place rather than copying each line out.
+  unique_ptr<SourceBuffer> buffer = io_delegate.GetSourceBuffer(filename);
+  if (!buffer) {
     LOG(ERROR) << "cannot open preprocessed file: " << filename;
     success = false;
     return success;
   }
+  if (state) {
+    state->SetContents(buffer->data(), buffer->size());
+  }
+  if (BinaryPreprocessedFile::IsBinary(buffer->data(), buffer->size())) {
+    // Declarations are looked up in the file, rather than loaded up front.
+    if (!types->AddBinaryPreprocessedFile(std::move(buffer), filename)) {
+      LOG(ERROR) << "malformed binary preprocessed file: " << filename;
+      return false;
+    }
+    return true;
+  }
 
-  string line;
+  LineIterator lines(buffer->data(), buffer->size());
+  const char* line = nullptr;
+  size_t length = 0;
   unsigned lineno = 1;
-  for ( ; line_reader->ReadLine(&line); ++lineno) {
-    if (line.empty() || line.compare(0, 2, "//") == 0) {
+  for ( ; lines.Next(&line, &length); ++lineno) {
+    if (length == 0 || (length >= 2 && line[0] == '/' && line[1] == '/')) {
       // skip comments and empty lines
       continue;
     }
 
-    string decl;
-    vector<string> package;
+    PreprocessedKind kind;
+    string package;
     string class_name;
-    if (!ParsePreprocessedLine(line, &decl, &package, &class_name)) {
-      success = false;
-      break;
-    }
-
-    if (decl == "parcelable") {
-      AidlParcelable doc(new AidlQualifiedName(class_name, ""),
-                         lineno, package);
-      types->AddParcelableType(doc, filename);
-    } else if (decl == "interface") {
-      auto temp = new std::vector<std::unique_ptr<AidlMember>>();
-      AidlInterface doc(class_name, lineno, "", false, temp, package);
-      types->AddBinderType(doc, filename);
-    } else {
+    if (!ParsePreprocessedLine(line, length, &kind, &package, &class_name)) {
       success = false;
       break;
     }
+    types->AddPreprocessedType(kind, package, class_name, filename, lineno);
   }
   if (!success) {
     LOG(ERROR) << filename << ':' << lineno
-               << " malformed preprocessed file line: '" << line << "'";
+               << " malformed preprocessed file line: '"
+               << string(line, length) << "'";
   }
 
   return success;
@@ -552,12 +599,14 @@ AidlError load_and_validate_aidl(
     const IoDelegate& io_delegate,
     TypeNamespace* types,
     std::unique_ptr<AidlInterface>* returned_interface,
-    std::vector<std::unique_ptr<AidlImport>>* returned_imports) {
+    std::vector<std::unique_ptr<AidlImport>>* returned_imports,
+    ImportCache* import_cache) {
   AidlError err = AidlError::OK;
 
-  std::map<AidlImport*,std::unique_ptr<AidlDocument>> docs;
+  std::map<AidlImport*, const AidlDocument*> docs;
 
   // import the preprocessed file
+  PhaseTimer preprocessed_timer(Phase::LOAD_PREPROCESSED);
   for (const string& s : preprocessed_files) {
     if (!parse_preprocessed_file(io_delegate, s, types)) {
       err = AidlError::BAD_PRE_PROCESSED_FILE;
@@ -566,12 +615,21 @@ AidlError load_and_validate_aidl(
   if (err != AidlError::OK) {
     return err;
   }
+  preprocessed_timer.Stop();
+
+  std::unique_ptr<ImportCache> local_import_cache;
+  if (!import_cache) {
+    local_import_cache.reset(new ImportCache(io_delegate));
+    import_cache = local_import_cache.get();
+  }
 
   // parse the input file
-  Parser p{io_delegate};
+  PhaseTimer parse_timer(Phase::PARSE_INPUT);
+  Parser p{io_delegate, import_cache->GetAstCache()};
   if (!p.ParseFile(input_file_name)) {
     return AidlError::PARSE_ERROR;
   }
+  parse_timer.Stop();
 
   AidlDocument* parsed_doc = p.GetDocument();
 
@@ -592,7 +650,8 @@ AidlError load_and_validate_aidl(
   }
 
   // parse the imports of the input file
-  ImportResolver import_resolver{io_delegate, import_paths};
+  ImportResolver import_resolver{io_delegate, import_paths,
+                                 import_cache->GetRootIndex()};
   for (auto& import : p.GetImports()) {
     if (types->HasImportType(*import)) {
       // There are places in the Android tree where an import doesn't resolve,
@@ -600,7 +659,9 @@ AidlError load_and_validate_aidl(
       // This seems like an error, but legacy support demands we support it...
       continue;
     }
+    PhaseTimer resolve_timer(Phase::RESOLVE_IMPORTS);
     string import_path = import_resolver.FindImportFile(import->GetNeededClass());
+    resolve_timer.Stop();
     if (import_path.empty()) {
       cerr << import->GetFileFrom() << ":" << import->GetLine()
            << ": couldn't find import for class "
@@ -610,24 +671,26 @@ AidlError load_and_validate_aidl(
     }
     import->SetFilename(import_path);
 
-    Parser p{io_delegate};
-    if (!p.ParseFile(import->GetFilename())) {
+    PhaseTimer import_timer(Phase::PARSE_IMPORTS);
+    const AidlDocument* document =
+        import_cache->GetDocument(import->GetFilename());
+    if (!document) {
       cerr << "error while parsing import for class "
            << import->GetNeededClass() << endl;
       err = AidlError::BAD_IMPORT;
       continue;
     }
 
-    std::unique_ptr<AidlDocument> document(p.ReleaseDocument());
-    if (!check_filenames(import->GetFilename(), document.get()))
+    if (!check_filenames(import->GetFilename(), document))
       err = AidlError::BAD_IMPORT;
-    docs[import.get()] = std::move(document);
+    docs[import.get()] = document;
   }
   if (err != AidlError::OK) {
     return err;
   }
 
   // gather the types that have been declared
+  PhaseTimer gather_timer(Phase::GATHER_TYPES);
   if (!types->AddBinderType(*interface.get(), input_file_name)) {
     err = AidlError::BAD_TYPE;
   }
@@ -644,21 +707,24 @@ AidlError load_and_validate_aidl(
       continue;
     }
 
-    if (!gather_types(import->GetFilename(), import_itr->second.get(), types)) {
+    if (!gather_types(import->GetFilename(), import_itr->second, types)) {
       err = AidlError::BAD_TYPE;
     }
   }
+  gather_timer.Stop();
 
   // check the referenced types in parsed_doc to make sure we've imported them
+  PhaseTimer check_timer(Phase::CHECK_TYPES);
   if (check_types(input_file_name, interface.get(), types) != 0) {
     err = AidlError::BAD_TYPE;
   }
   if (err != AidlError::OK) {
     return err;
   }
-
+  check_timer.Stop();
 
   // assign method ids and validate.
+  PhaseTimer method_id_timer(Phase::ASSIGN_METHOD_IDS);
   if (check_and_assign_method_ids(input_file_name.c_str(),
                                   interface->GetMethods()) != 0) {
     return AidlError::BAD_METHOD_ID;
@@ -666,6 +732,7 @@ AidlError load_and_validate_aidl(
   if (!validate_constants(*interface)) {
     return AidlError::BAD_CONSTANTS;
   }
+  method_id_timer.Stop();
 
   if (returned_interface)
     *returned_interface = std::move(interface);
@@ -678,47 +745,60 @@ AidlError load_and_validate_aidl(
 
 } // namespace internals
 
+namespace {
+
 int compile_aidl_to_cpp(const CppOptions& options,
-                        const IoDelegate& io_delegate) {
+                        const IoDelegate& io_delegate,
+                        cpp::TypeNamespace* types,
+                        ImportCache* import_cache,
+                        vector<unique_ptr<AidlImport>>* returned_imports) {
   unique_ptr<AidlInterface> interface;
-  std::vector<std::unique_ptr<AidlImport>> imports;
-  unique_ptr<cpp::TypeNamespace> types(new cpp::TypeNamespace());
-  types->Init();
+  std::vector<std::unique_ptr<AidlImport>>& imports = *returned_imports;
   AidlError err = internals::load_and_validate_aidl(
       std::vector<std::string>{},  // no preprocessed files
       options.ImportPaths(),
       options.InputFileName(),
       options.ShouldGenTraces(),
       io_delegate,
-      types.get(),
+      types,
       &interface,
-      &imports);
+      &imports,
+      import_cache);
   if (err != AidlError::OK) {
     return 1;
   }
 
+  PhaseTimer dep_timer(Phase::WRITE_OUTPUT);
   if (!write_cpp_dep_file(options, *interface, imports, io_delegate)) {
     return 1;
   }
-
-  return (cpp::GenerateCpp(options, *types, *interface, io_delegate)) ? 0 : 1;
+  dep_timer.Stop();
+
+  // A batch compiled on several threads keeps every core busy already, so
+  // its entries build their documents one at a time.
+  const size_t document_threads =
+      options.Jobs() > 1 ? 1 : std::thread::hardware_concurrency();
+  return (cpp::GenerateCpp(options, *types, *interface, io_delegate,
+                           document_threads)) ? 0 : 1;
 }
 
 int compile_aidl_to_java(const JavaOptions& options,
-                         const IoDelegate& io_delegate) {
+                         const IoDelegate& io_delegate,
+                         java::JavaTypeNamespace* types,
+                         ImportCache* import_cache,
+                         vector<unique_ptr<AidlImport>>* returned_imports) {
   unique_ptr<AidlInterface> interface;
-  std::vector<std::unique_ptr<AidlImport>> imports;
-  unique_ptr<java::JavaTypeNamespace> types(new java::JavaTypeNamespace());
-  types->Init();
+  std::vector<std::unique_ptr<AidlImport>>& imports = *returned_imports;
   AidlError aidl_err = internals::load_and_validate_aidl(
-      options.preprocessed_files_,
+      std::vector<std::string>{},  // already loaded into |types|
       options.import_paths_,
       options.input_file_name_,
       options.gen_traces_,
       io_delegate,
-      types.get(),
+      types,
       &interface,
-      &imports);
+      &imports,
+      import_cache);
   if (aidl_err == AidlError::FOUND_PARCELABLE && !options.fail_on_parcelable_) {
     // We aborted code generation because this file contains parcelables.
     // However, we were not told to complain if we find parcelables.
@@ -742,18 +822,437 @@ int compile_aidl_to_java(const JavaOptions& options,
     return 1;
   }
 
-  if (!write_java_dep_file(options, imports, io_delegate, output_file_name)) {
+  // With a srcjar, the build only knows about the archive.
+  const string& dep_target =
+      options.srcjar_file_.empty() ? output_file_name : options.srcjar_file_;
+  PhaseTimer dep_timer(Phase::WRITE_OUTPUT);
+  if (!write_java_dep_file(options, imports, io_delegate, dep_target)) {
     return 1;
   }
+  dep_timer.Stop();
 
   return generate_java(output_file_name, options.input_file_name_.c_str(),
-                       interface.get(), types.get(), io_delegate, options);
+                       interface.get(), types, io_delegate, options);
+}
+
+// Returns everything in |options| that affects the outputs, other than the
+// import paths: the files imports resolve to are checked when restoring.
+string describe_outputs(const CppOptions& options) {
+  vector<string> parts = {"cpp",
+                          options.InputFileName(),
+                          options.OutputHeaderDir(),
+                          options.OutputCppFilePath(),
+                          options.DependencyFilePath(),
+                          options.DependencyFileNinja() ? "ninja" : "",
+                          options.ShouldGenTraces() ? "traces" : ""};
+  return Join(parts, '\0');
+}
+
+string describe_outputs(const JavaOptions& options) {
+  vector<string> parts = {
+      "java",
+      options.input_file_name_,
+      options.output_file_name_,
+      options.output_base_folder_,
+      options.DependencyFilePath(),
+      options.DependencyFileNinja() ? "ninja" : "",
+      options.gen_traces_ ? "traces" : "",
+      options.fail_on_parcelable_ ? "fail_on_parcelable" : "",
+      std::to_string(options.onTransact_outline_threshold_),
+      std::to_string(options.onTransact_non_outline_count_)};
+  parts.insert(parts.end(), options.preprocessed_files_.begin(),
+               options.preprocessed_files_.end());
+  return Join(parts, '\0');
+}
+
+// Restores the outputs of compiling |input_file| from |output_cache|, if it
+// is given and holds them.  Otherwise calls |compile| with an IoDelegate to
+// write the outputs to, and the imports to fill in, and stores the outputs if
+// it succeeds.
+template <typename CompileFunc>
+int compile_with_output_cache(const OutputCache* output_cache,
+                              const string& description,
+                              const string& input_file,
+                              const vector<string>& import_paths,
+                              const vector<string>& preprocessed_files,
+                              ImportRootIndex* root_index,
+                              const IoDelegate& io_delegate,
+                              CompileFunc compile) {
+  vector<unique_ptr<AidlImport>> imports;
+  const string key =
+      output_cache ? output_cache->Key(description, input_file) : "";
+  if (key.empty()) {
+    // Without a readable input there is nothing to cache; let the compile
+    // report the error.
+    return compile(io_delegate, &imports);
+  }
+
+  PhaseTimer restore_timer(Phase::WRITE_OUTPUT);
+  ImportResolver import_resolver{io_delegate, import_paths, root_index};
+  if (output_cache->Restore(key, import_resolver, io_delegate)) {
+    return 0;
+  }
+  restore_timer.Stop();
+
+  OutputRecorder recorder(io_delegate);
+  const int ret = compile(recorder, &imports);
+  if (ret == 0) {
+    output_cache->Store(key, imports, preprocessed_files, recorder);
+  }
+  return ret;
+}
+
+int compile_cpp_entry(const CppOptions& options,
+                      const IoDelegate& io_delegate,
+                      const cpp::TypeNamespace& builtin_types,
+                      CompileCache* cache) {
+  TimedInput timed_input(cache->GetTimings(), options.InputFileName());
+  return compile_with_output_cache(
+      cache->Outputs(), describe_outputs(options), options.InputFileName(),
+      options.ImportPaths(), vector<string>{}, cache->Imports()->GetRootIndex(),
+      io_delegate,
+      [&](const IoDelegate& io, vector<unique_ptr<AidlImport>>* imports) {
+        unique_ptr<cpp::TypeNamespace> types(new cpp::TypeNamespace());
+        types->InitFromParent(builtin_types);
+        return compile_aidl_to_cpp(options, io, types.get(), cache->Imports(),
+                                   imports);
+      });
+}
+
+// If |builtin_types| is nullptr, the types are loaded through |cache| when
+// needed, which is not safe to do from several threads at once.
+int compile_java_entry(const JavaOptions& options,
+                       const IoDelegate& io_delegate,
+                       const java::JavaTypeNamespace* builtin_types,
+                       CompileCache* cache) {
+  TimedInput timed_input(cache->GetTimings(), options.input_file_name_);
+  return compile_with_output_cache(
+      cache->Outputs(), describe_outputs(options), options.input_file_name_,
+      options.import_paths_, options.preprocessed_files_,
+      cache->Imports()->GetRootIndex(), io_delegate,
+      [&](const IoDelegate& io, vector<unique_ptr<AidlImport>>* imports) {
+        const java::JavaTypeNamespace* builtin =
+            builtin_types ? builtin_types
+                          : cache->JavaTypes(options.preprocessed_files_);
+        if (!builtin) {
+          return 1;
+        }
+        unique_ptr<java::JavaTypeNamespace> types(
+            new java::JavaTypeNamespace());
+        types->InitFromParent(*builtin);
+        return compile_aidl_to_java(options, io, types.get(), cache->Imports(),
+                                    imports);
+      });
+}
+
+// Calls |compile| with the options of every entry in |batch_file|, on
+// |options.jobs_| threads, and returns non-zero if any entry is malformed or
+// fails to compile.  |compile| must be safe to call from several threads.
+template <typename Options, typename CompileFunc>
+int compile_batch(const Options& options,
+                  const string& batch_file,
+                  size_t jobs,
+                  const IoDelegate& io_delegate,
+                  CompileFunc compile) {
+  unique_ptr<LineReader> line_reader = io_delegate.GetLineReader(batch_file);
+  if (!line_reader) {
+    LOG(ERROR) << "cannot open batch file: " << batch_file;
+    return 1;
+  }
+
+  int ret = 0;
+  vector<unique_ptr<Options>> entries;
+  string line;
+  for (unsigned lineno = 1; line_reader->ReadLine(&line); ++lineno) {
+    if (android::base::Trim(line).empty()) {
+      continue;
+    }
+    unique_ptr<Options> entry = options.ParseBatchEntry(line);
+    if (!entry) {
+      LOG(ERROR) << batch_file << ':' << lineno
+                 << " malformed batch file line: '" << line << "'";
+      ret = 1;
+      continue;
+    }
+    entries.push_back(std::move(entry));
+  }
+
+  if (jobs <= 1 || entries.size() <= 1) {
+    for (const auto& entry : entries) {
+      if (compile(*entry) != 0) {
+        ret = 1;
+      }
+    }
+    return ret;
+  }
+
+  // Every entry writes its own result, so the workers share nothing here.
+  vector<int> results(entries.size(), 0);
+  ThreadPool pool(std::min(jobs, entries.size()));
+  for (size_t i = 0; i < entries.size(); ++i) {
+    pool.Post([&, i]() { results[i] = compile(*entries[i]); });
+  }
+  pool.Wait();
+  for (int result : results) {
+    if (result != 0) {
+      ret = 1;
+    }
+  }
+
+  return ret;
+}
+
+int compile_aidl_to_cpp_batch(const CppOptions& options,
+                              const IoDelegate& io_delegate,
+                              CompileCache* cache) {
+  // Each entry adds its own types to a namespace of its own, so that entries
+  // cannot see each other's types, and can be compiled concurrently.
+  const cpp::TypeNamespace& builtin_types = cache->CppTypes();
+
+  return compile_batch(
+      options, options.BatchFilePath(), options.Jobs(), io_delegate,
+      [&](const CppOptions& entry) {
+        return compile_cpp_entry(entry, io_delegate, builtin_types, cache);
+      });
+}
+
+int compile_aidl_to_java_batch(const JavaOptions& options,
+                               const IoDelegate& io_delegate,
+                               CompileCache* cache) {
+  // Each entry adds its own types to a namespace of its own, so that entries
+  // cannot see each other's types, and can be compiled concurrently.
+  const java::JavaTypeNamespace* builtin_types = nullptr;
+  {
+    // Shared by every entry, so not timed as any of them.
+    TimedInput timed_input(cache->GetTimings(), "");
+    builtin_types = cache->JavaTypes(options.preprocessed_files_);
+  }
+  if (!builtin_types) {
+    return 1;
+  }
+
+  return compile_batch(
+      options, options.batch_file_name_, options.jobs_, io_delegate,
+      [&](const JavaOptions& entry) {
+        return compile_java_entry(entry, io_delegate, builtin_types, cache);
+      });
+}
+
+bool write_report(const IoDelegate& io_delegate, const string& path,
+                  const string& contents) {
+  CodeWriterPtr writer = io_delegate.GetCodeWriter(path);
+  if (!writer || !writer->Append(contents) || !writer->Close()) {
+    LOG(ERROR) << "Could not write " << path;
+    return false;
+  }
+  return true;
+}
+
+// Runs |compile|.  If |timings_file| is given, writes a report of how long
+// each phase of it took there, if |trace_file| is given, writes a trace of
+// it there, and if |mem_stats_file| is given, writes a report of the memory
+// each phase allocated there.
+template <typename CompileFunc>
+int compile_with_reports(const string& timings_file,
+                         const string& trace_file,
+                         const string& mem_stats_file,
+                         const IoDelegate& io_delegate,
+                         CompileCache* cache,
+                         CompileFunc compile) {
+  if (timings_file.empty() && trace_file.empty() && mem_stats_file.empty()) {
+    return compile();
+  }
+
+  Timings timings;
+  if (!timings_file.empty()) {
+    cache->SetTimings(&timings);
+  }
+  if (!trace_file.empty()) {
+    StartTracing();
+  }
+  if (!mem_stats_file.empty()) {
+    StartMemStats();
+  }
+  int ret = compile();
+  const string mem_stats = mem_stats_file.empty() ? "" : StopMemStats();
+  const string trace = trace_file.empty() ? "" : StopTracing();
+  cache->SetTimings(nullptr);
+
+  if (!timings_file.empty() &&
+      !write_report(io_delegate, timings_file,
+                    timings.ToJson(kMaxSlowestInputs))) {
+    ret = 1;
+  }
+  if (!trace_file.empty() && !write_report(io_delegate, trace_file, trace)) {
+    ret = 1;
+  }
+  if (!mem_stats_file.empty() &&
+      !write_report(io_delegate, mem_stats_file, mem_stats)) {
+    ret = 1;
+  }
+  return ret;
+}
+
+int compile_java_outputs(const JavaOptions& options,
+                         const IoDelegate& io_delegate,
+                         CompileCache* cache) {
+  if (options.IsBatch()) {
+    return compile_aidl_to_java_batch(options, io_delegate, cache);
+  }
+
+  // Loading the preprocessed files is left until the outputs turn out not to
+  // be cached.
+  return compile_java_entry(options, io_delegate, nullptr, cache);
+}
+
+}  // namespace
+
+CompileCache::CompileCache(const IoDelegate& io_delegate, bool long_lived)
+    : io_delegate_(io_delegate),
+      import_cache_(io_delegate),
+      long_lived_(long_lived) {}
+
+CompileCache::~CompileCache() = default;
+
+void CompileCache::UseAstCache(const string& dir) {
+  if (dir.empty()) {
+    ast_cache_.reset();
+  } else if (!ast_cache_ || ast_cache_->Dir() != dir) {
+    ast_cache_.reset(new AstCache(io_delegate_, dir));
+  }
+  import_cache_.SetAstCache(ast_cache_.get());
+}
+
+void CompileCache::Revalidate() {
+  import_cache_.Revalidate();
+  for (auto& it : preprocessed_types_) {
+    it.second.needs_check = true;
+  }
+}
+
+void CompileCache::UseOutputCache(const string& dir) {
+  if (dir.empty()) {
+    output_cache_.reset();
+  } else if (!output_cache_ || output_cache_->Dir() != dir) {
+    output_cache_.reset(new OutputCache(io_delegate_, dir));
+  }
+}
+
+const cpp::TypeNamespace& CompileCache::CppTypes() {
+  if (!cpp_types_) {
+    PhaseTimer timer(Phase::INIT_TYPES);
+    cpp_types_.reset(new cpp::TypeNamespace());
+    cpp_types_->Init();
+  }
+  return *cpp_types_;
+}
+
+const java::JavaTypeNamespace* CompileCache::JavaTypes(
+    const vector<string>& preprocessed_files) {
+  if (!java_types_) {
+    PhaseTimer timer(Phase::INIT_TYPES);
+    java_types_.reset(new java::JavaTypeNamespace());
+    java_types_->Init();
+  }
+  if (preprocessed_files.empty()) {
+    return java_types_.get();
+  }
+
+  // Files are looked at again only once the cache is told they may have
+  // changed, so that every compilation after the first costs a lookup.
+  PreprocessedTypes& entry =
+      preprocessed_types_[Join(preprocessed_files, '\0')];
+  if (entry.types && entry.needs_check) {
+    entry.needs_check = false;
+    for (size_t i = 0; i < preprocessed_files.size(); ++i) {
+      if (!entry.files[i].IsUnchanged(io_delegate_, preprocessed_files[i])) {
+        entry.types.reset();
+        break;
+      }
+    }
+  }
+  if (entry.types) {
+    return entry.types.get();
+  }
+
+  PhaseTimer timer(Phase::LOAD_PREPROCESSED);
+  unique_ptr<java::JavaTypeNamespace> types(new java::JavaTypeNamespace());
+  types->InitFromParent(*java_types_);
+  entry.files.clear();
+  for (const string& filename : preprocessed_files) {
+    FileState state;
+    if (!internals::parse_preprocessed_file(io_delegate_, filename,
+                                            types.get(),
+                                            long_lived_ ? &state : nullptr)) {
+      preprocessed_types_.erase(Join(preprocessed_files, '\0'));
+      return nullptr;
+    }
+    entry.files.push_back(state);
+  }
+  entry.types = std::move(types);
+  return entry.types.get();
+}
+
+int compile_aidl_to_cpp(const CppOptions& options,
+                        const IoDelegate& io_delegate) {
+  CompileCache cache(io_delegate);
+  return compile_aidl_to_cpp(options, io_delegate, &cache);
+}
+
+int compile_aidl_to_java(const JavaOptions& options,
+                         const IoDelegate& io_delegate) {
+  CompileCache cache(io_delegate);
+  return compile_aidl_to_java(options, io_delegate, &cache);
+}
+
+int compile_aidl_to_cpp(const CppOptions& options,
+                        const IoDelegate& io_delegate,
+                        CompileCache* cache) {
+  cache->UseAstCache(options.AstCacheDir());
+  cache->UseOutputCache(options.OutputCacheDir());
+  cache->Imports()->SetIndexImportRoots(options.IndexImportRoots());
+  return compile_with_reports(
+      options.TimingsFile(), options.TraceFile(), options.MemStatsFile(),
+      io_delegate, cache, [&]() {
+        if (options.IsBatch()) {
+          return compile_aidl_to_cpp_batch(options, io_delegate, cache);
+        }
+        return compile_cpp_entry(options, io_delegate, cache->CppTypes(),
+                                 cache);
+      });
+}
+
+int compile_aidl_to_java(const JavaOptions& options,
+                         const IoDelegate& io_delegate,
+                         CompileCache* cache) {
+  cache->UseAstCache(options.ast_cache_dir_);
+  cache->UseOutputCache(options.output_cache_dir_);
+  cache->Imports()->SetIndexImportRoots(options.index_import_roots_);
+  return compile_with_reports(
+      options.timings_file_, options.trace_file_, options.mem_stats_file_,
+      io_delegate, cache, [&]() {
+        if (options.srcjar_file_.empty()) {
+          return compile_java_outputs(options, io_delegate, cache);
+        }
+        SrcjarWriter srcjar(io_delegate, options.srcjar_file_);
+        int ret = compile_java_outputs(options, srcjar, cache);
+        TimedInput timed_input(cache->GetTimings(), "");
+        PhaseTimer timer(Phase::WRITE_OUTPUT);
+        if (ret != 0) {
+          // Never leave an archive that is missing files behind.
+          io_delegate.RemovePath(options.srcjar_file_);
+        } else if (!srcjar.Finish()) {
+          ret = 1;
+        }
+        return ret;
+      });
 }
 
 bool preprocess_aidl(const JavaOptions& options,
                      const IoDelegate& io_delegate) {
   unique_ptr<CodeWriter> writer =
       io_delegate.GetCodeWriter(options.output_file_name_);
+  BinaryPreprocessedWriter binary;
 
   for (const auto& file : options.files_to_preprocess_) {
     Parser p{io_delegate};
@@ -764,20 +1263,33 @@ bool preprocess_aidl(const JavaOptions& options,
 
     const AidlInterface* interface = doc->GetInterface();
 
-    if (interface != nullptr &&
-        !writer->Write("interface %s;\n",
-                       interface->GetCanonicalName().c_str())) {
-      return false;
+    if (interface != nullptr) {
+      if (options.preprocess_binary_) {
+        binary.Add(PreprocessedKind::INTERFACE,
+                   interface->GetCanonicalName());
+      } else if (!writer->Write("interface %s;\n",
+                                interface->GetCanonicalName().c_str())) {
+        return false;
+      }
     }
 
     for (const auto& parcelable : doc->GetParcelables()) {
-      if (!writer->Write("parcelable %s;\n",
-                         parcelable->GetCanonicalName().c_str())) {
+      if (options.preprocess_binary_) {
+        binary.Add(PreprocessedKind::PARCELABLE,
+                   parcelable->GetCanonicalName());
+      } else if (!writer->Write("parcelable %s;\n",
+                                parcelable->GetCanonicalName().c_str())) {
         return false;
       }
     }
   }
 
+  if (options.preprocess_binary_) {
+    string contents;
+    if (!binary.Finish(&contents) || !writer->Append(contents)) {
+      return false;
+    }
+  }
   return writer->Close();
 }
 
@@ -18,13 +18,20 @@
 #define AIDL_AIDL_H_
 
 #include <limits>
+#include <map>
 #include <memory>
 #include <string>
 #include <vector>
 
+#include <android-base/macros.h>
+
 #include "aidl_language.h"
+#include "ast_cache.h"
+#include "import_resolver.h"
 #include "io_delegate.h"
 #include "options.h"
+#include "output_cache.h"
+#include "timings.h"
 #include "type_namespace.h"
 
 namespace android {
@@ -45,15 +52,95 @@ enum class AidlError {
   OK = 0,
 };
 
+namespace cpp {
+class TypeNamespace;
+}  // namespace cpp
+
+namespace java {
+class JavaTypeNamespace;
+}  // namespace java
+
+// Types and parsed imports shared between compilations, such as the entries
+// of a batch or the requests handled by a compile server.  Compilations only
+// add types to namespaces of their own, on top of the ones returned here.
+// Not thread safe, except for the ImportCache.
+class CompileCache {
+ public:
+  // A |long_lived| cache outlives single compilations, as in a compile
+  // server, so it remembers enough about the files it loaded to tell later
+  // whether they changed.
+  explicit CompileCache(const IoDelegate& io_delegate,
+                        bool long_lived = false);
+  ~CompileCache();
+
+  // Returns the built in C++ types.
+  const cpp::TypeNamespace& CppTypes();
+  // Returns the built in Java types along with the types declared by
+  // |preprocessed_files|, or nullptr if those cannot be loaded.  Only the
+  // types loaded last are kept for each list of preprocessed files.
+  const java::JavaTypeNamespace* JavaTypes(
+      const std::vector<std::string>& preprocessed_files);
+
+  ImportCache* Imports() { return &import_cache_; }
+  // Makes documents be loaded from and stored to the AstCache in |dir|, or
+  // stops using one if |dir| is empty.
+  void UseAstCache(const std::string& dir);
+  // Makes outputs be restored from and stored to the OutputCache in |dir|,
+  // or stops using one if |dir| is empty.
+  void UseOutputCache(const std::string& dir);
+  const OutputCache* Outputs() const { return output_cache_.get(); }
+  // Makes cached imports and preprocessed types be checked for changes
+  // before their next use.
+  void Revalidate();
+  // Makes compilations record how long their phases take into |timings|,
+  // or stops timing them if it is nullptr.
+  void SetTimings(Timings* timings) { timings_ = timings; }
+  Timings* GetTimings() const { return timings_; }
+
+ private:
+  const IoDelegate& io_delegate_;
+  std::unique_ptr<AstCache> ast_cache_;
+  ImportCache import_cache_;
+  std::unique_ptr<OutputCache> output_cache_;
+  std::unique_ptr<cpp::TypeNamespace> cpp_types_;
+  std::unique_ptr<java::JavaTypeNamespace> java_types_;
+
+  // The types loaded from a list of preprocessed files.
+  struct PreprocessedTypes {
+    std::unique_ptr<java::JavaTypeNamespace> types;
+    // What the files looked like when the types were loaded.  Only recorded
+    // by long lived caches.
+    std::vector<FileState> files;
+    bool needs_check = false;
+  };
+
+  const bool long_lived_;
+  // Keyed by the names of the preprocessed files.
+  std::map<std::string, PreprocessedTypes> preprocessed_types_;
+  Timings* timings_ = nullptr;
+
+  DISALLOW_COPY_AND_ASSIGN(CompileCache);
+};
+
 int compile_aidl_to_cpp(const CppOptions& options,
                         const IoDelegate& io_delegate);
 int compile_aidl_to_java(const JavaOptions& options,
                          const IoDelegate& io_delegate);
+// As above, but reusing the types and imports in |cache|.
+int compile_aidl_to_cpp(const CppOptions& options,
+                        const IoDelegate& io_delegate,
+                        CompileCache* cache);
+int compile_aidl_to_java(const JavaOptions& options,
+                         const IoDelegate& io_delegate,
+                         CompileCache* cache);
 bool preprocess_aidl(const JavaOptions& options,
                      const IoDelegate& io_delegate);
 
 namespace internals {
 
+// If |import_cache| is given, imports are parsed through it, so that they are
+// only parsed once across all the compilations sharing the cache, and all
+// files are parsed through its AstCache.
 AidlError load_and_validate_aidl(
     const std::vector<std::string>& preprocessed_files,
     const std::vector<std::string>& import_paths,
@@ -62,10 +149,14 @@ AidlError load_and_validate_aidl(
     const IoDelegate& io_delegate,
     TypeNamespace* types,
     std::unique_ptr<AidlInterface>* returned_interface,
-    std::vector<std::unique_ptr<AidlImport>>* returned_imports);
+    std::vector<std::unique_ptr<AidlImport>>* returned_imports,
+    ImportCache* import_cache = nullptr);
 
+// Records what the file looked like to |*state| unless it is nullptr, from
+// the very contents loaded.
 bool parse_preprocessed_file(const IoDelegate& io_delegate,
-                             const std::string& filename, TypeNamespace* types);
+                             const std::string& filename, TypeNamespace* types,
+                             FileState* state = nullptr);
 
 } // namespace internals
 
@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2018, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "aidl.h"
+#include "options.h"
+#include "tests/benchmark_util.h"
+#include "tests/corpus_generator.h"
+#include "tests/fake_io_delegate.h"
+#include "type_cpp.h"
+#include "type_java.h"
+
+using android::aidl::test::AddBenchmarkInterface;
+using android::aidl::test::Corpus;
+using android::aidl::test::CorpusShape;
+using android::aidl::test::FakeIoDelegate;
+using android::aidl::test::GenerateCorpus;
+using android::aidl::test::GetInputSize;
+using android::aidl::test::InputSizes;
+using android::aidl::test::MakePreprocessedFile;
+using android::aidl::test::kBenchmarkInterface;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+namespace android {
+namespace aidl {
+namespace {
+
+const char kPreprocessedFile[] = "preprocessed";
+
+// Loads a preprocessed file of |state.range(0)| parcelables into a fresh
+// namespace, in the format selected by |binary|.
+void LoadPreprocessedFile(benchmark::State& state, bool binary) {
+  FakeIoDelegate io_delegate;
+  const int count = state.range(0);
+  const string contents = MakePreprocessedFile(count, binary);
+  io_delegate.SetFileContents(kPreprocessedFile, contents);
+  while (state.KeepRunning()) {
+    java::JavaTypeNamespace types;
+    types.Init();
+    if (!internals::parse_preprocessed_file(io_delegate, kPreprocessedFile,
+                                            &types)) {
+      state.SkipWithError("cannot load preprocessed file");
+      break;
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * contents.size());
+  state.SetItemsProcessed(state.iterations() * count);
+}
+
+void BM_LoadTextPreprocessedFile(benchmark::State& state) {
+  LoadPreprocessedFile(state, false);
+}
+BENCHMARK(BM_LoadTextPreprocessedFile)->RangeMultiplier(8)->Range(8, 32768);
+
+void BM_LoadBinaryPreprocessedFile(benchmark::State& state) {
+  LoadPreprocessedFile(state, true);
+}
+BENCHMARK(BM_LoadBinaryPreprocessedFile)->RangeMultiplier(8)->Range(8, 32768);
+
+// Parses the benchmark interface along with its imports and type checks it
+// against a fresh |T| namespace, which is where check_types() spends its time.
+template <typename T>
+void LoadAndValidate(benchmark::State& state) {
+  FakeIoDelegate io_delegate;
+  AddBenchmarkInterface(GetInputSize(state), &io_delegate);
+  while (state.KeepRunning()) {
+    T types;
+    types.Init();
+    unique_ptr<AidlInterface> interface;
+    vector<unique_ptr<AidlImport>> imports;
+    if (internals::load_and_validate_aidl(
+            {}, {"."}, kBenchmarkInterface, false, io_delegate, &types,
+            &interface, &imports) != AidlError::OK) {
+      state.SkipWithError("cannot load interface");
+      break;
+    }
+  }
+}
+
+void BM_LoadAndValidateJava(benchmark::State& state) {
+  LoadAndValidate<java::JavaTypeNamespace>(state);
+}
+BENCHMARK(BM_LoadAndValidateJava)->Apply(InputSizes);
+
+void BM_LoadAndValidateCpp(benchmark::State& state) {
+  LoadAndValidate<cpp::TypeNamespace>(state);
+}
+BENCHMARK(BM_LoadAndValidateCpp)->Apply(InputSizes);
+
+// Compiles every interface of a generated corpus of |state.range(0)|
+// interfaces, whose imports chain |state.range(1)| interfaces deep, to Java
+// the way a batch does, sharing the preprocessed types and parsed imports.
+void BM_CompileCorpusToJava(benchmark::State& state) {
+  CorpusShape shape;
+  shape.interfaces = state.range(0);
+  shape.import_depth = state.range(1);
+  shape.preprocessed_entries = 50000;
+  Corpus corpus;
+  GenerateCorpus(shape, &corpus);
+  FakeIoDelegate io_delegate;
+  for (const auto& file : corpus.files) {
+    io_delegate.SetFileContents(file.first, file.second);
+  }
+  vector<unique_ptr<JavaOptions>> options;
+  for (const string& interface : corpus.interfaces) {
+    vector<string> args = {"aidl", "-p" + corpus.binary_preprocessed_file,
+                           "-oout"};
+    for (const string& root : corpus.import_roots) {
+      args.push_back("-I" + root);
+    }
+    args.push_back(interface);
+    vector<const char*> argv;
+    for (const string& arg : args) {
+      argv.push_back(arg.c_str());
+    }
+    options.push_back(JavaOptions::Parse(argv.size(), argv.data()));
+  }
+  while (state.KeepRunning()) {
+    CompileCache cache(io_delegate);
+    for (const auto& entry : options) {
+      if (!entry || compile_aidl_to_java(*entry, io_delegate, &cache) != 0) {
+        state.SkipWithError("cannot compile corpus");
+        return;
+      }
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * corpus.interfaces.size());
+}
+BENCHMARK(BM_CompileCorpusToJava)
+    ->ArgNames({"interfaces", "depth"})
+    ->Args({64, 1})
+    ->Args({64, 8})
+    ->Args({256, 4})
+    ->Args({1024, 4})
+    ->Unit(benchmark::kMillisecond);
+
+}  // namespace
+}  // namespace aidl
+}  // namespace android
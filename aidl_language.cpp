@@ -1,16 +1,21 @@
 #include "aidl_language.h"
 
+#include <algorithm>
 #include <iostream>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <string>
 
+#include <ctype.h>
+
 #include <android-base/parseint.h>
 #include <android-base/strings.h>
 
 #include "aidl_language_y.h"
+#include "ast_cache.h"
 #include "logging.h"
+#include "trace.h"
 
 #ifdef _WIN32
 int isatty(int  fd)
@@ -19,13 +24,17 @@ int isatty(int  fd)
 }
 #endif
 
+using android::aidl::AstCache;
 using android::aidl::IoDelegate;
+using android::aidl::SourceBuffer;
+using android::aidl::TraceSpan;
 using android::base::Join;
 using android::base::Split;
 using std::cerr;
 using std::endl;
 using std::string;
 using std::unique_ptr;
+using std::vector;
 
 void yylex_init(void **);
 void yylex_destroy(void *);
@@ -34,9 +43,68 @@ int yyparse(Parser*);
 YY_BUFFER_STATE yy_scan_buffer(char *, size_t, void *);
 void yy_delete_buffer(YY_BUFFER_STATE, void *);
 
-AidlToken::AidlToken(const std::string& text, const std::string& comments)
-    : text_(text),
-      comments_(comments) {}
+AidlToken AidlToken::Make(const char* text, size_t length,
+                          const char* comments_begin,
+                          const char* comments_end) {
+  AidlToken token;
+  token.text_ = text;
+  token.length_ = length;
+  token.comments_begin_ = comments_begin;
+  token.comments_end_ = comments_end;
+  return token;
+}
+
+string AidlToken::GetText() const {
+  // The parser hands out an unset token for the error symbol.
+  if (text_ == nullptr) {
+    return string();
+  }
+  return string(text_, length_);
+}
+
+string AidlToken::GetComments() const {
+  // The lexer only lets whitespace through between the comments of a token,
+  // and drops it, so walk the comments the way it does.
+  string comments;
+  const char* p = comments_begin_;
+  const char* const end = comments_end_;
+  while (p != nullptr && p < end) {
+    const size_t left = end - p;
+    if (left >= 2 && p[0] == '/' && p[1] == '*') {
+      static const char kClose[] = "*/";
+      const char* close = std::search(p + 2, end, kClose, kClose + 2);
+      const char* next = (close == end) ? end : close + 2;
+      comments.append(p, next);
+      p = next;
+    } else if (left >= 2 && p[0] == '/' && p[1] == '/') {
+      const char* next = std::find(p, end, '\n');
+      next = (next == end) ? end : next + 1;
+      comments.append(p, next);
+      p = next;
+    } else if (left >= 3 && strncmp(p, "%%{", 3) == 0) {
+      // %%{ ... }%% blocks become javadoc.  The block only ends at a line
+      // that is exactly }%%, anything else is copied a line at a time.
+      comments += "/**";
+      p += 3;
+      while (p < end) {
+        if (end - p >= 3 && strncmp(p, "}%%", 3) == 0 &&
+            (end - p == 3 || p[3] == '\n')) {
+          comments += "**/";
+          p += 3;
+          break;
+        }
+        const char* eol = std::find(p, end, '\n');
+        const char* next = std::find_if(eol, end,
+                                        [](char c) { return c != '\n'; });
+        comments.append(p, next);
+        p = next;
+      }
+    } else {
+      ++p;
+    }
+  }
+  return comments;
+}
 
 AidlType::AidlType(const std::string& name, unsigned line,
                    const std::string& comments, bool is_array)
@@ -154,8 +222,9 @@ AidlMethod::AidlMethod(bool oneway, AidlType* type, std::string name,
   has_id_ = false;
 }
 
-Parser::Parser(const IoDelegate& io_delegate)
-    : io_delegate_(io_delegate) {
+Parser::Parser(const IoDelegate& io_delegate, const AstCache* ast_cache)
+    : io_delegate_(io_delegate),
+      ast_cache_(ast_cache) {
   yylex_init(&scanner_);
 }
 
@@ -250,6 +319,258 @@ AidlImport::AidlImport(const std::string& from,
       needed_class_(needed_class),
       line_(line) {}
 
+namespace {
+
+// Reads the declarations of a document while skipping the bodies of
+// interfaces.  Anything the grammar would not accept, or would lex
+// differently, makes Skim() fail, so that the caller can parse the file fully
+// and report the error exactly as usual.
+class DeclarationSkimmer {
+ public:
+  explicit DeclarationSkimmer(const string& contents) : data_(contents) {}
+
+  bool Skim(const string& filename,
+            unique_ptr<AidlDocument>* document,
+            vector<string>* package,
+            vector<unique_ptr<AidlImport>>* imports) {
+    Next();
+    if (IsWord("package")) {
+      Next();
+      if (!ReadQualifiedName(package) || !Expect(";")) {
+        return false;
+      }
+    }
+    while (IsWord("import")) {
+      const unsigned line = line_;
+      Next();
+      vector<string> name;
+      if (!ReadQualifiedName(&name) || !Expect(";")) {
+        return false;
+      }
+      imports->emplace_back(new AidlImport(filename, Join(name, '.'), line));
+    }
+
+    if (IsWord("parcelable") || kind_ == kEnd) {
+      document->reset(new AidlDocument());
+      while (IsWord("parcelable")) {
+        Next();
+        const unsigned line = line_;
+        vector<string> name;
+        if (!ReadQualifiedName(&name)) {
+          return false;
+        }
+        string cpp_header;
+        if (IsWord("cpp_header")) {
+          Next();
+          if (kind_ != kString) {
+            return false;
+          }
+          cpp_header = text_;
+          Next();
+        }
+        if (!Expect(";")) {
+          return false;
+        }
+        (*document)->AddParcelable(new AidlParcelable(
+            new AidlQualifiedName(Join(name, '.'), ""), line, *package,
+            cpp_header));
+      }
+      return kind_ == kEnd;
+    }
+
+    uint32_t annotations = AidlAnnotatable::AnnotationNone;
+    for (; kind_ == kAnnotation; Next()) {
+      if (text_ == "@nullable") {
+        annotations |= AidlAnnotatable::AnnotationNullable;
+      } else if (text_ == "@utf8") {
+        annotations |= AidlAnnotatable::AnnotationUtf8;
+      } else {
+        annotations |= AidlAnnotatable::AnnotationUtf8InCpp;
+      }
+    }
+    const bool oneway = IsWord("oneway");
+    if (oneway) {
+      Next();
+    }
+    if (!IsWord("interface")) {
+      return false;
+    }
+    // The grammar places oneway interfaces on the line of their name.
+    unsigned line = line_;
+    Next();
+    if (oneway) {
+      line = line_;
+    }
+    string name;
+    if (!ReadIdentifier(&name) || !Expect("{")) {
+      return false;
+    }
+    for (int depth = 1; depth > 0; Next()) {
+      if (kind_ == kEnd || kind_ == kUnknown) {
+        return false;
+      }
+      if (IsSymbol("{")) ++depth;
+      if (IsSymbol("}")) --depth;
+    }
+    if (kind_ != kEnd) {
+      return false;
+    }
+    AidlInterface* interface = new AidlInterface(
+        name, line, "", oneway, new vector<unique_ptr<AidlMember>>(),
+        *package);
+    for (AidlAnnotatable::Annotation annotation :
+         {AidlAnnotatable::AnnotationNullable, AidlAnnotatable::AnnotationUtf8,
+          AidlAnnotatable::AnnotationUtf8InCpp}) {
+      if (annotations & annotation) {
+        interface->Annotate(annotation);
+      }
+    }
+    document->reset(new AidlDocument(interface));
+    return true;
+  }
+
+ private:
+  enum Kind { kEnd, kWord, kString, kNumber, kAnnotation, kSymbol, kUnknown };
+
+  bool IsWord(const char* word) const { return kind_ == kWord && text_ == word; }
+  bool IsSymbol(const char* symbol) const {
+    return kind_ == kSymbol && text_ == symbol;
+  }
+  bool Expect(const char* symbol) {
+    if (!IsSymbol(symbol)) {
+      return false;
+    }
+    Next();
+    return true;
+  }
+
+  // Reads what the grammar calls an identifier, where a few keywords are
+  // allowed as well.
+  bool ReadIdentifier(string* identifier) {
+    static const char* const kKeywords[] = {
+        "parcelable", "import", "package", "in", "out", "inout", "const",
+        "interface", "oneway"};
+    if (kind_ != kWord) {
+      return false;
+    }
+    for (const char* keyword : kKeywords) {
+      if (text_ == keyword) {
+        return false;
+      }
+    }
+    *identifier = text_;
+    Next();
+    return true;
+  }
+
+  bool ReadQualifiedName(vector<string>* terms) {
+    string term;
+    if (!ReadIdentifier(&term)) {
+      return false;
+    }
+    terms->push_back(term);
+    while (IsSymbol(".")) {
+      Next();
+      if (!ReadIdentifier(&term)) {
+        return false;
+      }
+      terms->push_back(term);
+    }
+    return true;
+  }
+
+  // Moves to the next token, counting lines as the lexer does.
+  void Next() {
+    while (pos_ < data_.size()) {
+      const char c = data_[pos_];
+      if (c == '\n') {
+        ++line_;
+        ++pos_;
+      } else if (c == ' ' || c == '\t' || c == '\r') {
+        ++pos_;
+      } else if (data_.compare(pos_, 2, "//") == 0) {
+        // The lexer only knows comments ended by a new line.
+        const size_t end = data_.find('\n', pos_);
+        if (end == string::npos) {
+          kind_ = kUnknown;
+          return;
+        }
+        pos_ = end;
+      } else if (data_.compare(pos_, 2, "/*") == 0) {
+        const size_t end = data_.find("*/", pos_ + 2);
+        if (end == string::npos) {
+          kind_ = kUnknown;
+          return;
+        }
+        for (; pos_ < end; ++pos_) {
+          if (data_[pos_] == '\n') ++line_;
+        }
+        pos_ = end + 2;
+      } else {
+        break;
+      }
+    }
+    if (pos_ >= data_.size()) {
+      kind_ = kEnd;
+      return;
+    }
+
+    const size_t start = pos_;
+    const char c = data_[pos_];
+    if (isalpha(static_cast<unsigned char>(c)) || c == '_') {
+      kind_ = kWord;
+      pos_ = EndOfWord(pos_);
+    } else if (isdigit(static_cast<unsigned char>(c)) ||
+               ((c == '-' || c == '+') && pos_ + 1 < data_.size() &&
+                isdigit(static_cast<unsigned char>(data_[pos_ + 1])))) {
+      kind_ = kNumber;
+      pos_ = EndOfWord(pos_ + 1);
+    } else if (c == '"') {
+      // Like the lexer, do not count the lines of multi-line strings.
+      const size_t end = data_.find('"', pos_ + 1);
+      if (end == string::npos) {
+        kind_ = kUnknown;
+        return;
+      }
+      kind_ = kString;
+      pos_ = end + 1;
+    } else if (c == '@') {
+      pos_ = EndOfWord(pos_ + 1);
+      const string annotation = data_.substr(start, pos_ - start);
+      kind_ = (annotation == "@nullable" || annotation == "@utf8" ||
+               annotation == "@utf8InCpp")
+                  ? kAnnotation
+                  : kUnknown;
+    } else if (strchr(";{}=,.()[]<>", c) != nullptr) {
+      kind_ = kSymbol;
+      ++pos_;
+    } else {
+      // Including the %%{ }%% blocks, which are rare enough to leave to the
+      // full parse.
+      kind_ = kUnknown;
+      ++pos_;
+    }
+    text_ = data_.substr(start, pos_ - start);
+  }
+
+  size_t EndOfWord(size_t pos) const {
+    while (pos < data_.size() &&
+           (isalnum(static_cast<unsigned char>(data_[pos])) ||
+            data_[pos] == '_')) {
+      ++pos;
+    }
+    return pos;
+  }
+
+  const string& data_;
+  size_t pos_ = 0;
+  unsigned line_ = 1;
+  Kind kind_ = kEnd;
+  string text_;
+};
+
+}  // namespace
+
 Parser::~Parser() {
   if (raw_buffer_) {
     yy_delete_buffer(buffer_, scanner_);
@@ -259,8 +580,9 @@ Parser::~Parser() {
 }
 
 bool Parser::ParseFile(const string& filename) {
+  TraceSpan span("ParseFile", filename);
   // Make sure we can read the file first, before trashing previous state.
-  unique_ptr<string> new_buffer = io_delegate_.GetFileContents(filename);
+  unique_ptr<SourceBuffer> new_buffer = io_delegate_.GetSourceBuffer(filename);
   if (!new_buffer) {
     LOG(ERROR) << "Error while opening file for parsing: '" << filename << "'";
     return false;
@@ -272,30 +594,114 @@ bool Parser::ParseFile(const string& filename) {
     raw_buffer_.reset();
   }
 
-  raw_buffer_ = std::move(new_buffer);
-  // We're going to scan this buffer in place, and yacc demands we put two
-  // nulls at the end.
-  raw_buffer_->append(2u, '\0');
   filename_ = filename;
   package_.reset();
   error_ = 0;
   document_.reset();
+  last_token_ = AidlToken::Make(nullptr, 0);
+  lookahead_location_ = nullptr;
+  tokens_kept_ = 0;
+  recovery_reported_ = false;
+  error_token_tokens_kept_ = 0;
+
+  // The scanner works on the buffer in place, so keep the original contents
+  // aside to key the cache with.
+  string contents;
+  if (ast_cache_) {
+    contents.assign(new_buffer->data(), new_buffer->size());
+    if (ast_cache_->Load(contents, filename, &document_, &imports_)) {
+      return true;
+    }
+  }
 
-  buffer_ = yy_scan_buffer(&(*raw_buffer_)[0], raw_buffer_->length(), scanner_);
+  raw_buffer_ = std::move(new_buffer);
+  // The buffer ends in the two nulls yacc demands of buffers it scans in
+  // place.
+  buffer_ = yy_scan_buffer(raw_buffer_->data(), raw_buffer_->size() + 2,
+                           scanner_);
 
   if (yy::parser(this).parse() != 0 || error_ != 0) {
     return false;}
 
-  if (document_.get() != nullptr)
+  if (document_.get() != nullptr) {
+    if (ast_cache_) {
+      ast_cache_->Store(contents, *document_, imports_);
+    }
     return true;
+  }
 
   LOG(ERROR) << "Parser succeeded but yielded no document!";
   return false;
 }
 
+bool Parser::SkimFile(const string& filename) {
+  unique_ptr<string> contents = io_delegate_.GetFileContents(filename);
+  if (!contents) {
+    return ParseFile(filename);
+  }
+  return SkimFile(filename, *contents);
+}
+
+bool Parser::SkimFile(const string& filename, const string& contents) {
+  filename_ = filename;
+  package_.reset();
+  error_ = 0;
+  document_.reset();
+  imports_.clear();
+
+  if (ast_cache_ &&
+      ast_cache_->Load(contents, filename, &document_, &imports_)) {
+    return true;
+  }
+
+  vector<string> package;
+  if (!DeclarationSkimmer(contents).Skim(filename, &document_, &package,
+                                          &imports_)) {
+    imports_.clear();
+    return ParseFile(filename);
+  }
+  if (!package.empty()) {
+    package_.reset(new AidlQualifiedName(Join(package, '.'), ""));
+  }
+  return true;
+}
+
 void Parser::ReportError(const string& err, unsigned line) {
   cerr << filename_ << ":" << line << ": " << err << endl;
   error_ = 1;
+  recovery_reported_ = false;
+}
+
+void Parser::ReportRecovery(const string& explanation) {
+  if (recovery_reported_ && tokens_kept_ <= last_recovery_tokens_kept_) {
+    return;
+  }
+  recovery_reported_ = true;
+  last_recovery_tokens_kept_ = tokens_kept_;
+  cerr << explanation;
+}
+
+const AidlToken& Parser::ErrorTokenValue() {
+  if (tokens_kept_ > error_token_tokens_kept_) {
+    error_token_ = last_token_;
+    error_token_tokens_kept_ = tokens_kept_;
+  }
+  return error_token_;
+}
+
+void Parser::NoteToken(const AidlToken* value, const void* location) {
+  ++tokens_kept_;
+  lookahead_location_ = location;
+  if (value != nullptr) {
+    last_token_ = *value;
+  }
+}
+
+void Parser::NoteDiscarded(const void* location) {
+  // Symbols popped off the stack have locations of their own.
+  if (location == lookahead_location_) {
+    --tokens_kept_;
+  }
 }
 
 std::vector<std::string> Parser::Package() const {
@@ -13,18 +13,28 @@
 struct yy_buffer_state;
 typedef yy_buffer_state* YY_BUFFER_STATE;
 
+// A token of the source buffer of the Parser that produced it.  Tokens point
+// into that buffer instead of copying out of it, which keeps them plain values
+// the lexer can hand out without allocating.  They are only valid until the
+// Parser moves on to another file.
 class AidlToken {
  public:
-  AidlToken(const std::string& text, const std::string& comments);
+  // |comments_begin| and |comments_end| delimit the comments preceding the
+  // token in the source, if there are any.
+  static AidlToken Make(const char* text, size_t length,
+                        const char* comments_begin = nullptr,
+                        const char* comments_end = nullptr);
 
-  const std::string& GetText() const { return text_; }
-  const std::string& GetComments() const { return comments_; }
+  std::string GetText() const;
+  // The comments preceding the token, concatenated as they were written.
+  // These are built on every call, so only ask for comments that are kept.
+  std::string GetComments() const;
 
  private:
-  std::string text_;
-  std::string comments_;
-
-  DISALLOW_COPY_AND_ASSIGN(AidlToken);
+  const char* text_;
+  size_t length_;
+  const char* comments_begin_;
+  const char* comments_end_;
 };
 
 class AidlNode {
@@ -39,6 +49,7 @@ class AidlNode {
 namespace android {
 namespace aidl {
 
+class AstCache;
 class ValidatableType;
 
 }  // namespace aidl
@@ -213,7 +224,7 @@ class AidlMethod : public AidlMember {
   const std::string& GetName() const { return name_; }
   unsigned GetLine() const { return line_; }
   bool HasId() const { return has_id_; }
-  int GetId() { return id_; }
+  int GetId() const { return id_; }
   void SetId(unsigned id) { id_ = id; }
 
   const std::vector<std::unique_ptr<AidlArgument>>& GetArguments() const {
@@ -393,13 +404,40 @@ class AidlImport : public AidlNode {
 
 class Parser {
  public:
-  explicit Parser(const android::aidl::IoDelegate& io_delegate);
+  // If |ast_cache| is given, documents are loaded from it when possible, and
+  // stored to it after parsing.
+  explicit Parser(const android::aidl::IoDelegate& io_delegate,
+                  const android::aidl::AstCache* ast_cache = nullptr);
   ~Parser();
 
   // Parse contents of file |filename|.
   bool ParseFile(const std::string& filename);
 
+  // As ParseFile(), but only reads the package, the imports and the
+  // declarations: interfaces come without their methods and constants, which
+  // are not checked at all.  That is all it takes to use |filename| as an
+  // import.  Falls back to ParseFile() for anything unusual, including
+  // errors.
+  bool SkimFile(const std::string& filename);
+  // As SkimFile(), with the |contents| of |filename| already read.
+  bool SkimFile(const std::string& filename, const std::string& contents);
+
   void ReportError(const std::string& err, unsigned line);
+  // Error rules of the grammar explain the last syntax error through this.
+  // LALR recovery may reduce an error rule again for every token it throws
+  // away, so nothing more is explained until a token has been kept.
+  void ReportRecovery(const std::string& explanation);
+
+  // The grammar notes every token it reads, with its value if it has one and
+  // the address of the lookahead location it was read into.
+  void NoteToken(const AidlToken* value, const void* location);
+  // The grammar notes every symbol error recovery throws away, by the address
+  // of its location.
+  void NoteDiscarded(const void* location);
+  // The value of the error token recovery just shifted: the last token with
+  // a value that was read when it was first shifted.  Recovery may pop it and
+  // shift it again while it throws tokens away, but that keeps its value.
+  const AidlToken& ErrorTokenValue();
 
   bool FoundNoErrors() const { return error_ == 0; }
   const std::string& FileName() const { return filename_; }
@@ -425,14 +463,23 @@ class Parser {
 
  private:
   const android::aidl::IoDelegate& io_delegate_;
+  const android::aidl::AstCache* ast_cache_;
   int error_ = 0;
   std::string filename_;
   std::unique_ptr<AidlQualifiedName> package_;
   void* scanner_ = nullptr;
   std::unique_ptr<AidlDocument> document_;
   std::vector<std::unique_ptr<AidlImport>> imports_;
-  std::unique_ptr<std::string> raw_buffer_;
+  std::unique_ptr<android::aidl::SourceBuffer> raw_buffer_;
   YY_BUFFER_STATE buffer_;
+  AidlToken last_token_ = AidlToken::Make(nullptr, 0);
+  const void* lookahead_location_ = nullptr;
+  // Tokens read, less the lookaheads error recovery threw away.
+  size_t tokens_kept_ = 0;
+  bool recovery_reported_ = false;
+  size_t last_recovery_tokens_kept_ = 0;
+  AidlToken error_token_ = AidlToken::Make(nullptr, 0);
+  size_t error_token_tokens_kept_ = 0;
 
   DISALLOW_COPY_AND_ASSIGN(Parser);
 };
@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2018, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <string>
+
+#include <benchmark/benchmark.h>
+
+#include "aidl_language.h"
+#include "tests/benchmark_util.h"
+#include "tests/fake_io_delegate.h"
+
+using android::aidl::test::FakeIoDelegate;
+using android::aidl::test::GetInputSize;
+using android::aidl::test::InputSizes;
+using android::aidl::test::MakeInterface;
+using android::aidl::test::kBenchmarkInterface;
+using std::string;
+
+namespace android {
+namespace aidl {
+namespace {
+
+// Reports bytes per second, i.e. parse throughput.
+void BM_ParseFile(benchmark::State& state) {
+  FakeIoDelegate io_delegate;
+  const string contents = MakeInterface(GetInputSize(state));
+  io_delegate.SetFileContents(kBenchmarkInterface, contents);
+  while (state.KeepRunning()) {
+    Parser p(io_delegate);
+    if (!p.ParseFile(kBenchmarkInterface)) {
+      state.SkipWithError("parse failed");
+      break;
+    }
+    benchmark::DoNotOptimize(p.GetDocument());
+  }
+  state.SetBytesProcessed(state.iterations() * contents.size());
+}
+BENCHMARK(BM_ParseFile)->Apply(InputSizes);
+
+}  // namespace
+}  // namespace aidl
+}  // namespace android
@@ -6,6 +6,19 @@
 #include "aidl_language_y.h"
 
 #define YY_USER_ACTION yylloc->columns(yyleng);
+
+// Comments are not copied anywhere: tokens just remember where the comments
+// before them start and end in the buffer being scanned.
+#define EXTEND_COMMENTS()                       \
+  do {                                          \
+    if (comments_begin == nullptr) {            \
+      comments_begin = yytext;                  \
+    }                                           \
+    comments_end = yytext + yyleng;             \
+  } while (0)
+
+#define MAKE_TOKEN() \
+  AidlToken::Make(yytext, yyleng, comments_begin, comments_end)
 %}
 
 %option yylineno
@@ -24,26 +37,27 @@ hexvalue    0[x|X][0-9a-fA-F]+
 %%
 %{
   /* This happens at every call to yylex (every time we receive one token) */
-  std::string extra_text;
+  const char* comments_begin = nullptr;
+  const char* comments_end = nullptr;
   yylloc->step();
 %}
 
 
-\%\%\{                { extra_text += "/**"; BEGIN(COPYING); }
-<COPYING>\}\%\%       { extra_text += "**/"; yylloc->step(); BEGIN(INITIAL); }
-<COPYING>.*           { extra_text += yytext; }
-<COPYING>\n+          { extra_text += yytext; yylloc->lines(yyleng); }
+\%\%\{                { EXTEND_COMMENTS(); BEGIN(COPYING); }
+<COPYING>\}\%\%       { EXTEND_COMMENTS(); yylloc->step(); BEGIN(INITIAL); }
+<COPYING>.*           { EXTEND_COMMENTS(); }
+<COPYING>\n+          { EXTEND_COMMENTS(); yylloc->lines(yyleng); }
 
-\/\*                  { extra_text += yytext; BEGIN(LONG_COMMENT); }
-<LONG_COMMENT>\*+\/   { extra_text += yytext; yylloc->step(); BEGIN(INITIAL);  }
-<LONG_COMMENT>\*+     { extra_text += yytext; }
-<LONG_COMMENT>\n+     { extra_text += yytext; yylloc->lines(yyleng); }
-<LONG_COMMENT>[^*\n]+ { extra_text += yytext; }
+\/\*                  { EXTEND_COMMENTS(); BEGIN(LONG_COMMENT); }
+<LONG_COMMENT>\*+\/   { EXTEND_COMMENTS(); yylloc->step(); BEGIN(INITIAL);  }
+<LONG_COMMENT>\*+     { EXTEND_COMMENTS(); }
+<LONG_COMMENT>\n+     { EXTEND_COMMENTS(); yylloc->lines(yyleng); }
+<LONG_COMMENT>[^*\n]+ { EXTEND_COMMENTS(); }
 
-\"[^\"]*\"            { yylval->token = new AidlToken(yytext, extra_text);
+\"[^\"]*\"            { yylval->token = MAKE_TOKEN();
                         return yy::parser::token::C_STR; }
 
-\/\/.*\n              { extra_text += yytext; yylloc->lines(1); yylloc->step(); }
+\/\/.*\n              { EXTEND_COMMENTS(); yylloc->lines(1); yylloc->step(); }
 
 \n+                   { yylloc->lines(yyleng); yylloc->step(); }
 {whitespace}          {}
@@ -78,25 +92,25 @@ const                 { return yy::parser::token::CONST; }
 @utf8                 { return yy::parser::token::ANNOTATION_UTF8; }
 @utf8InCpp            { return yy::parser::token::ANNOTATION_UTF8_CPP; }
 
-interface             { yylval->token = new AidlToken("interface", extra_text);
+interface             { yylval->token = MAKE_TOKEN();
                         return yy::parser::token::INTERFACE;
                       }
-oneway                { yylval->token = new AidlToken("oneway", extra_text);
+oneway                { yylval->token = MAKE_TOKEN();
                         return yy::parser::token::ONEWAY;
                       }
 
     /* scalars */
-{identifier}          { yylval->token = new AidlToken(yytext, extra_text);
+{identifier}          { yylval->token = MAKE_TOKEN();
                         return yy::parser::token::IDENTIFIER;
                       }
 {intvalue}            { yylval->integer = std::stoi(yytext);
                         return yy::parser::token::INTVALUE; }
-{hexvalue}            { yylval->token = new AidlToken(yytext, extra_text);
+{hexvalue}            { yylval->token = MAKE_TOKEN();
                         return yy::parser::token::HEXVALUE; }
 
     /* syntax error! */
 .                     { printf("UNKNOWN(%s)", yytext);
-                        yylval->token = new AidlToken(yytext, extra_text);
+                        yylval->token = MAKE_TOKEN();
                         return yy::parser::token::IDENTIFIER;
                       }
 
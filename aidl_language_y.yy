@@ -1,24 +1,41 @@
 %{
 #include "aidl_language.h"
 #include "aidl_language_y.h"
+#include <android-base/stringprintf.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 int yylex(yy::parser::semantic_type *, yy::parser::location_type *, void *);
 
-#define lex_scanner ps->Scanner()
+// Reads a token from the scanner of |ps|, and lets |ps| note it.
+static int yylex(yy::parser::semantic_type* lval,
+                 yy::parser::location_type* loc, Parser* ps) {
+  int token = yylex(lval, loc, ps->Scanner());
+  switch (token) {
+    case yy::parser::token::IDENTIFIER:
+    case yy::parser::token::INTERFACE:
+    case yy::parser::token::ONEWAY:
+    case yy::parser::token::C_STR:
+    case yy::parser::token::HEXVALUE:
+      ps->NoteToken(&lval->token, loc);
+      break;
+    default:
+      ps->NoteToken(nullptr, loc);
+      break;
+  }
+  return token;
+}
 
 %}
 
 %parse-param { Parser* ps }
-%lex-param { void *lex_scanner }
+%lex-param { Parser* ps }
 
-%pure-parser
-%skeleton "glr.cc"
+%skeleton "lalr1.cc"
 
 %union {
-    AidlToken* token;
+    AidlToken token;
     int integer;
     std::string *str;
     AidlType::Annotation annotation;
@@ -60,7 +77,10 @@ int yylex(yy::parser::semantic_type *, yy::parser::location_type *, void *);
 %type<str> generic_list
 %type<qname> qualified_name
 
-%type<token> identifier error
+%type<token> identifier error_token
+
+/* Error recovery throws symbols away through their destructors. */
+%destructor { ps->NoteDiscarded(&@$); } <> <*>
 %%
 document
  : package imports parcelable_decls
@@ -77,11 +97,19 @@ identifier
  : IDENTIFIER
   { $$ = $1; }
  | CPP_HEADER
-  { $$ = new AidlToken("cpp_header", ""); }
+  { $$ = AidlToken::Make("cpp_header", 10); }
  | INT
-  { $$ = new AidlToken("int", ""); }
+  { $$ = AidlToken::Make("int", 3); }
  | STRING
-  { $$ = new AidlToken("String", ""); }
+  { $$ = AidlToken::Make("String", 6); }
+ ;
+
+/* The error token, valued with the token that was last read when it was
+ * shifted.  That is what error messages report having seen.
+ */
+error_token
+ : error
+  { $$ = ps->ErrorTokenValue(); }
  ;
 
 package
@@ -99,13 +127,11 @@ import
 
 qualified_name
  : identifier {
-    $$ = new AidlQualifiedName($1->GetText(), $1->GetComments());
-    delete $1;
+    $$ = new AidlQualifiedName($1.GetText(), $1.GetComments());
   }
  | qualified_name '.' identifier
   { $$ = $1;
-    $$->AddTerm($3->GetText());
-    delete $3;
+    $$->AddTerm($3.GetText());
   };
 
 parcelable_decls
@@ -115,10 +141,11 @@ parcelable_decls
    $$ = $1;
    $$->AddParcelable($2);
   }
- | parcelable_decls error {
-    fprintf(stderr, "%s:%d: syntax error don't know what to do with \"%s\"\n",
-            ps->FileName().c_str(),
-            @2.begin.line, $2->GetText().c_str());
+ | parcelable_decls error_token {
+    ps->ReportRecovery(android::base::StringPrintf(
+        "%s:%d: syntax error don't know what to do with \"%s\"\n",
+        ps->FileName().c_str(), @2.begin.line,
+        $2.GetText().c_str()));
     $$ = $1;
   };
 
@@ -127,51 +154,48 @@ parcelable_decl
     $$ = new AidlParcelable($2, @2.begin.line, ps->Package());
   }
  | PARCELABLE qualified_name CPP_HEADER C_STR ';' {
-    $$ = new AidlParcelable($2, @2.begin.line, ps->Package(), $4->GetText());
+    $$ = new AidlParcelable($2, @2.begin.line, ps->Package(), $4.GetText());
   }
  | PARCELABLE ';' {
     fprintf(stderr, "%s:%d syntax error in parcelable declaration. Expected type name.\n",
             ps->FileName().c_str(), @1.begin.line);
     $$ = NULL;
   }
- | PARCELABLE error ';' {
-    fprintf(stderr, "%s:%d syntax error in parcelable declaration. Expected type name, saw \"%s\".\n",
-            ps->FileName().c_str(), @2.begin.line, $2->GetText().c_str());
+ | PARCELABLE error_token ';' {
+    ps->ReportRecovery(android::base::StringPrintf(
+        "%s:%d syntax error in parcelable declaration. Expected type name, saw \"%s\".\n",
+        ps->FileName().c_str(), @2.begin.line,
+        $2.GetText().c_str()));
     $$ = NULL;
   };
 
 interface_decl
  : annotation_list INTERFACE identifier '{' members '}' {
-    $$ = new AidlInterface($3->GetText(), @2.begin.line, $2->GetComments(),
+    $$ = new AidlInterface($3.GetText(), @2.begin.line, $2.GetComments(),
                            false, $5, ps->Package());
     $$->Annotate($1);
-    delete $2;
-    delete $3;
   }
  | annotation_list ONEWAY INTERFACE identifier '{' members '}' {
-    $$ = new AidlInterface($4->GetText(), @4.begin.line, $2->GetComments(),
+    $$ = new AidlInterface($4.GetText(), @4.begin.line, $2.GetComments(),
                            true, $6, ps->Package());
     $$->Annotate($1);
-    delete $2;
-    delete $3;
-    delete $4;
   }
- | annotation_list INTERFACE error '{' members '}' {
-    fprintf(stderr, "%s:%d: syntax error in interface declaration.  Expected "
-                    "type name, saw \"%s\"\n",
-            ps->FileName().c_str(), @3.begin.line, $3->GetText().c_str());
+ | annotation_list INTERFACE error_token '{' members '}' {
+    ps->ReportRecovery(android::base::StringPrintf(
+        "%s:%d: syntax error in interface declaration.  Expected "
+        "type name, saw \"%s\"\n",
+        ps->FileName().c_str(), @3.begin.line,
+        $3.GetText().c_str()));
     $$ = NULL;
-    delete $2;
-    delete $3;
     delete $5;
   }
- | annotation_list INTERFACE error '}' {
-    fprintf(stderr, "%s:%d: syntax error in interface declaration.  Expected "
-                    "type name, saw \"%s\"\n",
-            ps->FileName().c_str(), @3.begin.line, $3->GetText().c_str());
+ | annotation_list INTERFACE error_token '}' {
+    ps->ReportRecovery(android::base::StringPrintf(
+        "%s:%d: syntax error in interface declaration.  Expected "
+        "type name, saw \"%s\"\n",
+        ps->FileName().c_str(), @3.begin.line,
+        $3.GetText().c_str()));
     $$ = NULL;
-    delete $2;
-    delete $3;
   };
 
 members
@@ -182,50 +206,41 @@ members
  | members constant_decl
   { $1->push_back(std::unique_ptr<AidlMember>($2)); }
  | members error ';' {
-    fprintf(stderr, "%s:%d: syntax error before ';' "
-                    "(expected method or constant declaration)\n",
-            ps->FileName().c_str(), @3.begin.line);
+    ps->ReportRecovery(android::base::StringPrintf(
+        "%s:%d: syntax error before ';' "
+        "(expected method or constant declaration)\n",
+        ps->FileName().c_str(), @3.begin.line));
     $$ = $1;
   };
 
 constant_decl
  : CONST INT identifier '=' INTVALUE ';' {
-    $$ = new AidlIntConstant($3->GetText(), $5);
-    delete $3;
+    $$ = new AidlIntConstant($3.GetText(), $5);
    }
  | CONST INT identifier '=' HEXVALUE ';' {
-    $$ = new AidlIntConstant($3->GetText(), $5->GetText(), @5.begin.line);
-    delete $3;
+    $$ = new AidlIntConstant($3.GetText(), $5.GetText(), @5.begin.line);
    }
  | CONST STRING identifier '=' C_STR ';' {
-    $$ = new AidlStringConstant($3->GetText(), $5->GetText(), @5.begin.line);
-    delete $3;
-    delete $5;
+    $$ = new AidlStringConstant($3.GetText(), $5.GetText(), @5.begin.line);
    }
  ;
 
 method_decl
  : type identifier '(' arg_list ')' ';' {
-    $$ = new AidlMethod(false, $1, $2->GetText(), $4, @2.begin.line,
+    $$ = new AidlMethod(false, $1, $2.GetText(), $4, @2.begin.line,
                         $1->GetComments());
-    delete $2;
   }
  | ONEWAY type identifier '(' arg_list ')' ';' {
-    $$ = new AidlMethod(true, $2, $3->GetText(), $5, @3.begin.line,
-                        $1->GetComments());
-    delete $1;
-    delete $3;
+    $$ = new AidlMethod(true, $2, $3.GetText(), $5, @3.begin.line,
+                        $1.GetComments());
   }
  | type identifier '(' arg_list ')' '=' INTVALUE ';' {
-    $$ = new AidlMethod(false, $1, $2->GetText(), $4, @2.begin.line,
+    $$ = new AidlMethod(false, $1, $2.GetText(), $4, @2.begin.line,
                         $1->GetComments(), $7);
-    delete $2;
   }
  | ONEWAY type identifier '(' arg_list ')' '=' INTVALUE ';' {
-    $$ = new AidlMethod(true, $2, $3->GetText(), $5, @3.begin.line,
-                        $1->GetComments(), $8);
-    delete $1;
-    delete $3;
+    $$ = new AidlMethod(true, $2, $3.GetText(), $5, @3.begin.line,
+                        $1.GetComments(), $8);
   };
 
 arg_list
@@ -240,19 +255,18 @@ arg_list
     $$->push_back(std::unique_ptr<AidlArgument>($3));
   }
  | error {
-    fprintf(stderr, "%s:%d: syntax error in parameter list\n",
-            ps->FileName().c_str(), @1.begin.line);
+    ps->ReportRecovery(android::base::StringPrintf(
+        "%s:%d: syntax error in parameter list\n",
+        ps->FileName().c_str(), @1.begin.line));
     $$ = new std::vector<std::unique_ptr<AidlArgument>>();
   };
 
 arg
  : direction type identifier {
-    $$ = new AidlArgument($1, $2, $3->GetText(), @3.begin.line);
-    delete $3;
+    $$ = new AidlArgument($1, $2, $3.GetText(), @3.begin.line);
   };
  | type identifier {
-    $$ = new AidlArgument($1, $2->GetText(), @2.begin.line);
-    delete $2;
+    $$ = new AidlArgument($1, $2.GetText(), @2.begin.line);
   };
 
 unannotated_type
@@ -17,6 +17,7 @@
 #include <memory>
 #include <set>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <android-base/stringprintf.h>
@@ -24,12 +25,20 @@
 
 #include "aidl.h"
 #include "aidl_language.h"
+#include "archive_io_delegate.h"
+#include "preprocessed_file.h"
+#include "tests/corpus_generator.h"
 #include "tests/fake_io_delegate.h"
 #include "type_cpp.h"
 #include "type_java.h"
 #include "type_namespace.h"
+#include "zip_file.h"
 
+using android::aidl::test::Corpus;
+using android::aidl::test::CorpusShape;
 using android::aidl::test::FakeIoDelegate;
+using android::aidl::test::GenerateCorpus;
+using android::base::StringAppendF;
 using android::base::StringPrintf;
 using std::set;
 using std::string;
@@ -181,6 +190,88 @@ TEST_F(AidlTest, AcceptsOneway) {
   EXPECT_NE(nullptr, Parse("a/IBar.aidl", oneway_interface, &java_types_));
 }
 
+TEST_F(AidlTest, RecoversFromCascadingSyntaxErrors) {
+  const vector<std::pair<string, string>> cases = {
+      {"package a;\n"
+       "interface IFoo 5\n"
+       "const int X = 3;\n"
+       "void f();\n"
+       "}\n",
+       "a/IFoo.aidl:2: syntax error\n"
+       "a/IFoo.aidl:2: syntax error in interface declaration.  Expected type "
+       "name, saw \"IFoo\"\n"},
+      {"package a;\n"
+       "parcelable IFoo {\n"
+       "  const int X = 3;\n"
+       "  void (int a);\n"
+       "}\n",
+       "a/IFoo.aidl:2: syntax error\n"
+       "a/IFoo.aidl:2 syntax error in parcelable declaration. Expected type "
+       "name, saw \"IFoo\".\n"
+       "a/IFoo.aidl:4: syntax error don't know what to do with \"void\"\n"},
+      {"package a;\n"
+       "interface IFoo {\n"
+       "  void f(int a b) c, d e);\n"
+       "  void g();\n"
+       "}\n",
+       "a/IFoo.aidl:3: syntax error\n"
+       "a/IFoo.aidl:3: syntax error in parameter list\n"
+       "a/IFoo.aidl:3: syntax error in parameter list\n"},
+      {"package a;\n"
+       "parcelable Foo cpp_header;\n",
+       "a/IFoo.aidl:2: syntax error\n"
+       "a/IFoo.aidl:2 syntax error in parcelable declaration. Expected type "
+       "name, saw \"Foo\".\n"},
+      {"package a;\n"
+       "interface IFoo {\n"
+       "  void f(int a,);\n"
+       "  int 3 g();\n"
+       "  void h(in);\n"
+       "}\n",
+       "a/IFoo.aidl:3: syntax error\n"
+       "a/IFoo.aidl:3: syntax error in parameter list\n"
+       "a/IFoo.aidl:4: syntax error\n"
+       "a/IFoo.aidl:4: syntax error before ';' (expected method or constant "
+       "declaration)\n"
+       "a/IFoo.aidl:5: syntax error\n"
+       "a/IFoo.aidl:5: syntax error in parameter list\n"},
+  };
+  for (const auto& c : cases) {
+    testing::internal::CaptureStderr();
+    EXPECT_EQ(nullptr, Parse("a/IFoo.aidl", c.first, &java_types_))
+        << c.first;
+    EXPECT_EQ(c.second, testing::internal::GetCapturedStderr()) << c.first;
+  }
+}
+
+TEST_F(AidlTest, KeepsCommentsBeforeDeclarations) {
+  const string contents =
+      "package a;\n"
+      "/** Interface docs. */\n"
+      "// More docs.\n"
+      "interface IFoo {\n"
+      "  /* Method\n"
+      "   * docs. */\n"
+      "  %%{\n"
+      "copied\n"
+      "}%%\n"
+      "  void f();\n"
+      "  // Oneway docs.\n"
+      "  oneway void g();\n"
+      "  void h(); /* Not attached to anything. */\n"
+      "}\n";
+  auto parse_result = Parse("a/IFoo.aidl", contents, &java_types_);
+  ASSERT_NE(nullptr, parse_result);
+  EXPECT_EQ("/** Interface docs. */// More docs.\n",
+            parse_result->GetComments());
+  const auto& methods = parse_result->GetMethods();
+  ASSERT_EQ(3u, methods.size());
+  EXPECT_EQ("/* Method\n   * docs. *//**\ncopied\n**/",
+            methods[0]->GetComments());
+  EXPECT_EQ("// Oneway docs.\n", methods[1]->GetComments());
+  EXPECT_EQ("", methods[2]->GetComments());
+}
+
 TEST_F(AidlTest, ParsesPreprocessedFile) {
   string simple_content = "parcelable a.Foo;\ninterface b.IBar;";
   io_delegate_.SetFileContents("path", simple_content);
@@ -199,6 +290,24 @@ TEST_F(AidlTest, ParsesPreprocessedFileWithWhitespace) {
   EXPECT_TRUE(java_types_.HasTypeByCanonicalName("b.IBar"));
 }
 
+TEST_F(AidlTest, ParsesPreprocessedFileWithCommentsAndBlankLines) {
+  io_delegate_.SetFileContents(
+      "path", "// generated\n\nparcelable a.Foo;\n\ninterface b.IBar;\n");
+  EXPECT_TRUE(parse_preprocessed_file(io_delegate_, "path", &java_types_));
+  EXPECT_TRUE(java_types_.HasTypeByCanonicalName("a.Foo"));
+  EXPECT_TRUE(java_types_.HasTypeByCanonicalName("b.IBar"));
+}
+
+TEST_F(AidlTest, RejectsMalformedPreprocessedFile) {
+  io_delegate_.SetFileContents("path", "parcelable a.Foo;\nparcelable a.B c;");
+  EXPECT_FALSE(parse_preprocessed_file(io_delegate_, "path", &java_types_));
+  io_delegate_.SetFileContents("path", "parcelable a.Foo; b.Bar;");
+  EXPECT_FALSE(parse_preprocessed_file(io_delegate_, "path", &java_types_));
+  io_delegate_.SetFileContents("path", "enum a.Foo;");
+  EXPECT_FALSE(parse_preprocessed_file(io_delegate_, "path", &java_types_));
+  EXPECT_FALSE(parse_preprocessed_file(io_delegate_, "missing", &java_types_));
+}
+
 TEST_F(AidlTest, PreferImportToPreprocessed) {
   io_delegate_.SetFileContents("preprocessed", "interface another.IBar;");
   io_delegate_.SetFileContents("one/IBar.aidl", "package one; "
@@ -237,6 +346,63 @@ TEST_F(AidlTest, WritePreprocessedFile) {
   EXPECT_EQ("parcelable p.Outer.Inner;\ninterface one.IBar;\n", output);
 }
 
+TEST_F(AidlTest, WritesAndParsesBinaryPreprocessedFile) {
+  io_delegate_.SetFileContents("p/Outer.aidl",
+                               "package p; parcelable Outer.Inner;");
+  io_delegate_.SetFileContents("one/IBar.aidl", "package one; import p.Outer;"
+                                                "interface IBar {}");
+  const char* argv[] = {"aidl", "--preprocess", "--binary", "preprocessed",
+                        "p/Outer.aidl", "one/IBar.aidl"};
+  unique_ptr<JavaOptions> options = JavaOptions::Parse(6, argv);
+  ASSERT_NE(nullptr, options);
+  EXPECT_TRUE(::android::aidl::preprocess_aidl(*options, io_delegate_));
+
+  string output;
+  ASSERT_TRUE(io_delegate_.GetWrittenContents("preprocessed", &output));
+  io_delegate_.SetFileContents("path", output);
+  EXPECT_TRUE(parse_preprocessed_file(io_delegate_, "path", &java_types_));
+  EXPECT_TRUE(java_types_.HasTypeByCanonicalName("p.Outer.Inner"));
+  EXPECT_TRUE(java_types_.HasTypeByCanonicalName("one.IBar"));
+
+  // Damage is caught rather than read past.
+  io_delegate_.SetFileContents("path", output.substr(0, output.size() - 1));
+  EXPECT_FALSE(parse_preprocessed_file(io_delegate_, "path", &java_types_));
+}
+
+TEST_F(AidlTest, LoadsBinaryPreprocessedTypesAsTheyAreLookedUp) {
+  BinaryPreprocessedWriter writer;
+  writer.Add(PreprocessedKind::PARCELABLE, "a.Foo");
+  writer.Add(PreprocessedKind::INTERFACE, "b.IBar");
+  writer.Add(PreprocessedKind::PARCELABLE, "c.Foo");
+  writer.Add(PreprocessedKind::PARCELABLE, "java.lang.String");
+  string contents;
+  ASSERT_TRUE(writer.Finish(&contents));
+  io_delegate_.SetFileContents("path", contents);
+  ASSERT_TRUE(parse_preprocessed_file(io_delegate_, "path", &java_types_));
+
+  // Types are loaded into the namespace they are looked up through, leaving
+  // the shared one as it is.
+  java::JavaTypeNamespace types;
+  types.InitFromParent(java_types_);
+  const java::Type* foo = types.FindTypeByCanonicalName("a.Foo");
+  ASSERT_NE(nullptr, foo);
+  EXPECT_EQ("path", foo->DeclFile());
+  EXPECT_EQ(1, foo->DeclLine());
+  const java::Type* bar = types.FindTypeByCanonicalName("b.IBar");
+  ASSERT_NE(nullptr, bar);
+  EXPECT_EQ(2, bar->DeclLine());
+  EXPECT_EQ(bar, types.FindTypeByCanonicalName("b.IBar"));
+  EXPECT_EQ(nullptr, types.FindTypeByCanonicalName("a.Missing"));
+
+  // The last declaration of a short name is found, whatever was loaded first.
+  const java::Type* short_foo = types.FindTypeByCanonicalName("Foo");
+  ASSERT_NE(nullptr, short_foo);
+  EXPECT_EQ("c.Foo", short_foo->CanonicalName());
+  // Built in types cannot be redefined.
+  EXPECT_EQ(java_types_.StringType(),
+            types.FindTypeByCanonicalName("java.lang.String"));
+}
+
 TEST_F(AidlTest, RequireOuterClass) {
   io_delegate_.SetFileContents("p/Outer.aidl",
                                "package p; parcelable Outer.Inner;");
@@ -382,6 +548,60 @@ TEST_F(AidlTest, UnderstandsNativeParcelables) {
   EXPECT_EQ("p.Bar", java_type->InstantiableName());
 }
 
+TEST_F(AidlTest, SkimsDeclarationsLikeFullParse) {
+  // Summarizes what imports are used for.
+  auto describe = [](Parser* p) {
+    string out;
+    for (const auto& import : p->GetImports()) {
+      out += "import " + import->GetNeededClass() + ":" +
+             std::to_string(import->GetLine()) + "\n";
+    }
+    const AidlInterface* interface = p->GetDocument()->GetInterface();
+    if (interface) {
+      out += interface->GetCanonicalName() + ":" +
+             std::to_string(interface->GetLine()) +
+             (interface->IsOneway() ? " oneway" : "") +
+             (interface->IsUtf8InCpp() ? " utf8InCpp" : "") + "\n";
+    }
+    for (const auto& parcelable : p->GetDocument()->GetParcelables()) {
+      out += parcelable->GetCanonicalName() + ":" +
+             std::to_string(parcelable->GetLine()) + " " +
+             parcelable->GetCppHeader() + "\n";
+    }
+    return out;
+  };
+  const char* sources[] = {
+      "package a.b;\nimport c.D;\n/* x\n y */ import e.F;\n"
+      "interface IFoo {\n  void f(in D d, out F[] f) = 3;\n"
+      "  const String S = \"{\";\n  const int I = -1; // }\n}\n",
+      "package a;\n\n@utf8InCpp oneway\ninterface\nIFoo { }",
+      "package a;\nparcelable Foo;\nparcelable Bar.Baz cpp_header \"a/Bar.h\";\n",
+      "parcelable Foo;",
+      "package a;",
+  };
+  for (const char* source : sources) {
+    io_delegate_.SetFileContents("src.aidl", source);
+    Parser full{io_delegate_};
+    ASSERT_TRUE(full.ParseFile("src.aidl")) << source;
+    Parser skim{io_delegate_};
+    ASSERT_TRUE(skim.SkimFile("src.aidl")) << source;
+    EXPECT_EQ(describe(&full), describe(&skim)) << source;
+  }
+
+  // Bodies are not even looked at...
+  io_delegate_.SetFileContents("src.aidl",
+                               "package a; interface IFoo { void f(; }");
+  Parser skim{io_delegate_};
+  EXPECT_TRUE(skim.SkimFile("src.aidl"));
+  // ...but other errors are reported as usual.
+  for (const char* source : {"package a; import ;",
+                             "package a; interface IFoo {"}) {
+    io_delegate_.SetFileContents("src.aidl", source);
+    Parser p{io_delegate_};
+    EXPECT_FALSE(p.SkimFile("src.aidl")) << source;
+  }
+}
+
 TEST_F(AidlTest, WritesCorrectDependencyFile) {
   // While the in tree build system always gives us an output file name,
   // other android tools take advantage of our ability to infer the intended
@@ -436,5 +656,397 @@ TEST_F(AidlTest, WritesTrivialDependencyFileForParcelable) {
   EXPECT_EQ(actual_dep_file_contents, kExpectedParcelableDepFileContents);
 }
 
+TEST_F(AidlTest, CompilesJavaBatch) {
+  io_delegate_.SetFileContents("preprocessed", "parcelable a.Foo;\n");
+  io_delegate_.SetFileContents("p/IBar.aidl", "package p; interface IBar {}");
+  io_delegate_.SetFileContents(
+      "p/IFoo.aidl",
+      "package p; import a.Foo; import p.IBar;"
+      "interface IFoo { IBar bar(in Foo f); }");
+  io_delegate_.SetFileContents(
+      "batch",
+      "-dout/IBar.d p/IBar.aidl\n"
+      "p/IFoo.aidl out/IFoo.java -dout/IFoo.d\n");
+  const char* argv[] = {
+      "aidl", "-I.", "-ppreprocessed", "-oout", "-ninja", "--batch=batch"};
+  unique_ptr<JavaOptions> options = JavaOptions::Parse(6, argv);
+  ASSERT_NE(nullptr, options);
+  EXPECT_EQ(0, ::android::aidl::compile_aidl_to_java(*options, io_delegate_));
+
+  EXPECT_TRUE(io_delegate_.GetWrittenContents("out/p/IBar.java", nullptr));
+  EXPECT_TRUE(io_delegate_.GetWrittenContents("out/IFoo.java", nullptr));
+  string dep_file;
+  EXPECT_TRUE(io_delegate_.GetWrittenContents("out/IBar.d", &dep_file));
+  EXPECT_EQ("out/p/IBar.java : \\\n"
+            "  p/IBar.aidl\n", dep_file);
+  EXPECT_TRUE(io_delegate_.GetWrittenContents("out/IFoo.d", &dep_file));
+  EXPECT_EQ("out/IFoo.java : \\\n"
+            "  p/IFoo.aidl \\\n"
+            "  ./p/IBar.aidl\n", dep_file);
+}
+
+TEST_F(AidlTest, CompilesJavaBatchToSrcjar) {
+  io_delegate_.SetFileContents("p/IBar.aidl", "package p; interface IBar {}");
+  io_delegate_.SetFileContents(
+      "p/IFoo.aidl",
+      "package p; import p.IBar; interface IFoo { IBar bar(); }");
+  io_delegate_.SetFileContents("batch",
+                               "p/IFoo.aidl -dout/IFoo.d\n"
+                               "p/IBar.aidl\n");
+  const char* argv[] = {
+      "aidl", "-I.", "-ninja", "--srcjar=out/gen.srcjar", "--batch=batch"};
+  unique_ptr<JavaOptions> options = JavaOptions::Parse(5, argv);
+  ASSERT_NE(nullptr, options);
+  EXPECT_EQ(0, ::android::aidl::compile_aidl_to_java(*options, io_delegate_));
+
+  string srcjar;
+  ASSERT_TRUE(io_delegate_.GetWrittenContents("out/gen.srcjar", &srcjar));
+  EXPECT_EQ(0u, srcjar.find("PK\x03\x04"));
+  // Entries are sorted by name, whatever order they were generated in.
+  const size_t bar = srcjar.find("p/IBar.java");
+  const size_t foo = srcjar.find("p/IFoo.java");
+  ASSERT_NE(string::npos, bar);
+  ASSERT_NE(string::npos, foo);
+  EXPECT_LT(bar, foo);
+  EXPECT_FALSE(io_delegate_.GetWrittenContents("out/gen.srcjar/p/IFoo.java",
+                                               nullptr));
+  string dep_file;
+  EXPECT_TRUE(io_delegate_.GetWrittenContents("out/IFoo.d", &dep_file));
+  EXPECT_EQ("out/gen.srcjar : \\\n"
+            "  p/IFoo.aidl \\\n"
+            "  ./p/IBar.aidl\n", dep_file);
+
+  // An archive missing any file is never left behind.
+  io_delegate_.SetFileContents("p/IBar.aidl", "package p; interface IBar {");
+  EXPECT_NE(0, ::android::aidl::compile_aidl_to_java(*options, io_delegate_));
+  EXPECT_TRUE(io_delegate_.PathWasRemoved("out/gen.srcjar"));
+}
+
+TEST_F(AidlTest, WritesTimingsOfBatch) {
+  io_delegate_.SetFileContents("preprocessed", "parcelable a.Foo;\n");
+  io_delegate_.SetFileContents("p/IBar.aidl", "package p; interface IBar {}");
+  io_delegate_.SetFileContents(
+      "p/IFoo.aidl",
+      "package p; import a.Foo; import p.IBar;"
+      "interface IFoo { IBar bar(in Foo f); }");
+  io_delegate_.SetFileContents("batch", "p/IBar.aidl\np/IFoo.aidl\n");
+  const char* argv[] = {"aidl", "-I.", "-ppreprocessed", "-oout",
+                        "--timings=out/timings.json", "--batch=batch"};
+  unique_ptr<JavaOptions> options = JavaOptions::Parse(6, argv);
+  ASSERT_NE(nullptr, options);
+  EXPECT_EQ(0, ::android::aidl::compile_aidl_to_java(*options, io_delegate_));
+
+  string report;
+  ASSERT_TRUE(io_delegate_.GetWrittenContents("out/timings.json", &report));
+  EXPECT_NE(string::npos, report.find("\"inputs\": 2,"));
+  EXPECT_NE(string::npos, report.find("\"input\": \"p/IFoo.aidl\""));
+  EXPECT_NE(string::npos, report.find("\"input\": \"p/IBar.aidl\""));
+  for (const char* phase : {"load_preprocessed", "parse_input",
+                            "resolve_imports", "build_ast", "write_output"}) {
+    EXPECT_NE(string::npos, report.find(StringPrintf("\"%s\"", phase)));
+  }
+}
+
+TEST_F(AidlTest, WritesTraceOfBatch) {
+  io_delegate_.SetFileContents("p/IBar.aidl", "package p; interface IBar {}");
+  io_delegate_.SetFileContents(
+      "p/IFoo.aidl",
+      "package p; import p.IBar; interface IFoo { IBar bar(); }");
+  io_delegate_.SetFileContents("batch", "p/IBar.aidl\np/IFoo.aidl\n");
+  const char* argv[] = {"aidl", "-I.", "-oout", "-j2", "--trace-out=trace.json",
+                        "--batch=batch"};
+  unique_ptr<JavaOptions> options = JavaOptions::Parse(6, argv);
+  ASSERT_NE(nullptr, options);
+  EXPECT_EQ(0, ::android::aidl::compile_aidl_to_java(*options, io_delegate_));
+
+  string trace;
+  ASSERT_TRUE(io_delegate_.GetWrittenContents("trace.json", &trace));
+  EXPECT_NE(string::npos, trace.find("\"traceEvents\""));
+  EXPECT_NE(string::npos, trace.find("\"name\": \"compile\""));
+  EXPECT_NE(string::npos, trace.find("\"name\": \"ParseFile\""));
+  EXPECT_NE(string::npos, trace.find("\"name\": \"FindImportFile\""));
+  EXPECT_NE(string::npos, trace.find("\"name\": \"build_ast\""));
+  EXPECT_NE(string::npos, trace.find("\"detail\": \"p/IFoo.aidl\""));
+}
+
+TEST_F(AidlTest, WritesMemStatsOfBatch) {
+  io_delegate_.SetFileContents("p/IBar.aidl", "package p; interface IBar {}");
+  io_delegate_.SetFileContents(
+      "p/IFoo.aidl",
+      "package p; import p.IBar; interface IFoo { IBar bar(); }");
+  io_delegate_.SetFileContents("batch", "p/IBar.aidl\np/IFoo.aidl\n");
+  const char* argv[] = {"aidl", "-I.", "-oout", "-j2",
+                        "--mem-stats=out/mem.json", "--batch=batch"};
+  unique_ptr<JavaOptions> options = JavaOptions::Parse(6, argv);
+  ASSERT_NE(nullptr, options);
+  EXPECT_EQ(0, ::android::aidl::compile_aidl_to_java(*options, io_delegate_));
+
+  // The tests keep the standard allocator, so nothing is counted, but every
+  // phase is reported.
+  string report;
+  ASSERT_TRUE(io_delegate_.GetWrittenContents("out/mem.json", &report));
+  EXPECT_NE(string::npos, report.find("\"peak_live_bytes\": "));
+  for (const char* phase : {"init_types", "parse_input", "gather_types",
+                            "build_ast", "write_output", "other"}) {
+    const size_t start = report.find(StringPrintf("\"%s\": {", phase));
+    ASSERT_NE(string::npos, start) << phase;
+    long long allocations = -1;
+    ASSERT_EQ(1, sscanf(report.c_str() + start + strlen(phase) + 4,
+                        "{\"allocations\": %lld", &allocations));
+    EXPECT_EQ(0, allocations) << phase;
+  }
+}
+
+TEST_F(AidlTest, ImportsFromArchives) {
+  ZipWriter zip;
+  zip.AddFile("p/IBar.aidl", "package p; interface IBar {}");
+  zip.AddFile("p/Baz.aidl", "package p; parcelable Baz;");
+  string archive;
+  ASSERT_TRUE(zip.Finish(&archive));
+  io_delegate_.SetFileContents("sdk.zip", archive);
+  io_delegate_.SetFileContents(
+      "q/IFoo.aidl",
+      "package q; import p.Baz; import p.IBar;"
+      "interface IFoo { IBar bar(in Baz b); }");
+  ArchiveIoDelegate archive_io_delegate(io_delegate_);
+  const char* argv[] = {
+      "aidl", "-I@sdk.zip", "-oout", "-ninja", "-dout/IFoo.d", "q/IFoo.aidl"};
+  unique_ptr<JavaOptions> options = JavaOptions::Parse(6, argv);
+  ASSERT_NE(nullptr, options);
+  EXPECT_EQ(0, ::android::aidl::compile_aidl_to_java(*options,
+                                                     archive_io_delegate));
+
+  EXPECT_TRUE(io_delegate_.GetWrittenContents("out/q/IFoo.java", nullptr));
+  // The build depends on the archive, not on the files inside it.
+  string dep_file;
+  EXPECT_TRUE(io_delegate_.GetWrittenContents("out/IFoo.d", &dep_file));
+  EXPECT_EQ("out/q/IFoo.java : \\\n"
+            "  q/IFoo.aidl \\\n"
+            "  sdk.zip\n", dep_file);
+
+  // Without the archive, the imports are missing.
+  EXPECT_NE(0, ::android::aidl::compile_aidl_to_java(*options, io_delegate_));
+}
+
+TEST_F(AidlTest, ReportsBrokenArchivesUntilTheyChange) {
+  io_delegate_.SetFileContents("sdk.zip", "not an archive");
+  ArchiveIoDelegate archive_io_delegate(io_delegate_);
+  const string path = "@sdk.zip!/p/IBar.aidl";
+  int64_t mtime;
+
+  testing::internal::CaptureStderr();
+  EXPECT_FALSE(archive_io_delegate.FileIsReadable(path));
+  EXPECT_FALSE(archive_io_delegate.FileIsReadable(path));
+  ASSERT_TRUE(archive_io_delegate.GetModificationTime(path, &mtime));
+  EXPECT_FALSE(archive_io_delegate.FileIsReadable(path));
+  const string output = testing::internal::GetCapturedStderr();
+  const string message = "sdk.zip is not a zip archive";
+  const size_t first = output.find(message);
+  EXPECT_NE(string::npos, first) << output;
+  EXPECT_EQ(string::npos, output.find(message, first + 1)) << output;
+
+  ZipWriter zip;
+  zip.AddFile("p/IBar.aidl", "package p; interface IBar {}");
+  string archive;
+  ASSERT_TRUE(zip.Finish(&archive));
+  io_delegate_.SetFileContents("sdk.zip", archive);
+  ASSERT_TRUE(archive_io_delegate.GetModificationTime(path, &mtime));
+  EXPECT_TRUE(archive_io_delegate.FileIsReadable(path));
+}
+
+TEST_F(AidlTest, CompilesGeneratedCorpus) {
+  CorpusShape shape;
+  shape.interfaces = 12;
+  shape.parcelables = 6;
+  shape.packages = 3;
+  shape.max_methods = 8;
+  shape.max_args = 5;
+  shape.import_depth = 3;
+  shape.preprocessed_entries = 200;
+  shape.outlined_interfaces = 3;
+  shape.outline_threshold = 10;
+  Corpus corpus;
+  GenerateCorpus(shape, &corpus);
+  Corpus same_corpus;
+  GenerateCorpus(shape, &same_corpus);
+  EXPECT_EQ(corpus.files, same_corpus.files);
+  ASSERT_EQ(2u, corpus.import_roots.size());
+  ASSERT_EQ(15u, corpus.interfaces.size());
+  for (const auto& file : corpus.files) {
+    io_delegate_.SetFileContents(file.first, file.second);
+  }
+
+  for (const string& interface : corpus.interfaces) {
+    const string root0 = "-I" + corpus.import_roots[0];
+    const string root1 = "-I" + corpus.import_roots[1];
+    const string preprocessed = "-p" + corpus.binary_preprocessed_file;
+    const char* java_argv[] = {"aidl", root0.c_str(), root1.c_str(),
+                               preprocessed.c_str(), "-oout",
+                               interface.c_str()};
+    unique_ptr<JavaOptions> java_options = JavaOptions::Parse(6, java_argv);
+    ASSERT_NE(nullptr, java_options);
+    java_options->onTransact_outline_threshold_ = shape.outline_threshold;
+    java_options->onTransact_non_outline_count_ = shape.outline_threshold / 2;
+    EXPECT_EQ(0, ::android::aidl::compile_aidl_to_java(*java_options,
+                                                       io_delegate_))
+        << interface;
+
+    const char* cpp_argv[] = {"aidl-cpp", root0.c_str(), root1.c_str(),
+                              interface.c_str(), "out/headers", "out/x.cpp"};
+    unique_ptr<CppOptions> cpp_options = CppOptions::Parse(6, cpp_argv);
+    ASSERT_NE(nullptr, cpp_options);
+    EXPECT_EQ(0, ::android::aidl::compile_aidl_to_cpp(*cpp_options,
+                                                      io_delegate_))
+        << interface;
+  }
+
+  // Only the outlined interfaces with more methods than the threshold have
+  // their onTransact cases outlined.
+  string java;
+  ASSERT_TRUE(io_delegate_.GetWrittenContents(
+      "out/corpus/pkg1/IOutlined1.java", &java));
+  EXPECT_EQ(string::npos, java.find("onTransact$"));
+  ASSERT_TRUE(io_delegate_.GetWrittenContents(
+      "out/corpus/pkg2/IOutlined2.java", &java));
+  EXPECT_NE(string::npos, java.find("onTransact$"));
+}
+
+TEST_F(AidlTest, CompilesCppBatch) {
+  io_delegate_.SetFileContents(
+      "p/Bar.aidl", "package p; parcelable Bar cpp_header \"p/Bar.h\";");
+  io_delegate_.SetFileContents(
+      "p/IBar.aidl", "package p; import p.Bar; interface IBar { Bar get(); }");
+  io_delegate_.SetFileContents(
+      "p/IFoo.aidl",
+      "package p; import p.Bar; import p.IBar;"
+      "interface IFoo { IBar bar(in Bar b); }");
+  io_delegate_.SetFileContents(
+      "batch",
+      "p/IBar.aidl out/headers out/IBar.cpp out/IBar.cpp.d\n"
+      "\n"
+      "p/IFoo.aidl out/headers out/IFoo.cpp out/IFoo.cpp.d\n");
+  const char* argv[] = {"aidl-cpp", "-I.", "-ninja", "--batch=batch"};
+  unique_ptr<CppOptions> options = CppOptions::Parse(4, argv);
+  ASSERT_NE(nullptr, options);
+  EXPECT_EQ(0, ::android::aidl::compile_aidl_to_cpp(*options, io_delegate_));
+
+  EXPECT_TRUE(io_delegate_.GetWrittenContents("out/IBar.cpp", nullptr));
+  EXPECT_TRUE(io_delegate_.GetWrittenContents("out/IFoo.cpp", nullptr));
+  // Imports already parsed for the first entry still show up in the
+  // dependencies of the second entry.
+  string dep_file;
+  EXPECT_TRUE(io_delegate_.GetWrittenContents("out/IFoo.cpp.d", &dep_file));
+  EXPECT_EQ("out/IFoo.cpp : \\\n"
+            "  p/IFoo.aidl \\\n"
+            "  ./p/Bar.aidl \\\n"
+            "  ./p/IBar.aidl\n", dep_file);
+}
+
+TEST_F(AidlTest, CppBatchReportsFailingEntries) {
+  io_delegate_.SetFileContents("p/IFoo.aidl", "package p; interface IFoo {}");
+  io_delegate_.SetFileContents("p/IBad.aidl",
+                               "package p; interface IBad { Missing f(); }");
+  io_delegate_.SetFileContents(
+      "batch",
+      "p/IBad.aidl out/headers out/IBad.cpp\n"
+      "p/IFoo.aidl out/headers out/IFoo.cpp\n");
+  const char* argv[] = {"aidl-cpp", "--batch=batch"};
+  unique_ptr<CppOptions> options = CppOptions::Parse(2, argv);
+  ASSERT_NE(nullptr, options);
+  EXPECT_NE(0, ::android::aidl::compile_aidl_to_cpp(*options, io_delegate_));
+  // A failing entry does not stop the rest of the batch.
+  EXPECT_FALSE(io_delegate_.GetWrittenContents("out/IBad.cpp", nullptr));
+  EXPECT_TRUE(io_delegate_.GetWrittenContents("out/IFoo.cpp", nullptr));
+}
+
+TEST_F(AidlTest, IndexedImportRootsResolveLikeProbing) {
+  io_delegate_.SetFileContents("p/IFoo.aidl",
+                               "package p; import q.Bar; import q.Baz;"
+                               "interface IFoo { Bar get(in Baz baz); }");
+  io_delegate_.SetFileContents("first/q/Bar.aidl",
+                               "package q; parcelable Bar cpp_header \"1.h\";");
+  io_delegate_.SetFileContents("second/q/Bar.aidl",
+                               "package q; parcelable Bar cpp_header \"2.h\";");
+  io_delegate_.SetFileContents("second/q/Baz.aidl",
+                               "package q; parcelable Baz cpp_header \"3.h\";");
+
+  string outputs[2];
+  for (string& output : outputs) {
+    const bool indexed = (&output == &outputs[1]);
+    const char* argv[] = {"aidl-cpp", "-Ifirst", "-Isecond",
+                          "--index-import-roots", "p/IFoo.aidl", "h",
+                          "out.cpp"};
+    if (!indexed) {
+      argv[3] = "-Ifirst";
+    }
+    unique_ptr<CppOptions> options = CppOptions::Parse(7, argv);
+    ASSERT_NE(nullptr, options);
+    EXPECT_EQ(indexed, options->IndexImportRoots());
+    ASSERT_EQ(0, ::android::aidl::compile_aidl_to_cpp(*options, io_delegate_));
+    ASSERT_TRUE(io_delegate_.GetWrittenContents("h/p/IFoo.h", &output));
+  }
+  EXPECT_NE(string::npos, outputs[0].find("#include <1.h>"));
+  EXPECT_EQ(outputs[0], outputs[1]);
+
+  io_delegate_.SetFileContents("p/IFoo.aidl",
+                               "package p; import q.Missing; interface IFoo {}");
+  const char* argv[] = {"aidl-cpp", "--index-import-roots", "-Ifirst",
+                        "p/IFoo.aidl", "h", "out.cpp"};
+  unique_ptr<CppOptions> options = CppOptions::Parse(6, argv);
+  ASSERT_NE(nullptr, options);
+  EXPECT_NE(0, ::android::aidl::compile_aidl_to_cpp(*options, io_delegate_));
+}
+
+TEST_F(AidlTest, ParallelBatchMatchesSerialBatch) {
+  const int kNumInterfaces = 16;
+  FakeIoDelegate parallel_io_delegate;
+  string java_batch;
+  string cpp_batch;
+  for (FakeIoDelegate* io : {&io_delegate_, &parallel_io_delegate}) {
+    io->SetFileContents("preprocessed", "parcelable a.Foo;\n");
+    io->AddStubParcelable("p.Bar", "p/Bar.h");
+    io->AddStubParcelable("a.Foo", "a/Foo.h");
+    for (int i = 0; i < kNumInterfaces; ++i) {
+      io->SetFileContents(
+          StringPrintf("p/IFoo%d.aidl", i),
+          StringPrintf("package p; import a.Foo; import p.Bar;"
+                       "interface IFoo%d { Bar get(in Foo f); }", i));
+    }
+  }
+  for (int i = 0; i < kNumInterfaces; ++i) {
+    StringAppendF(&java_batch, "-dout/IFoo%d.d p/IFoo%d.aidl\n", i, i);
+    StringAppendF(&cpp_batch, "p/IFoo%d.aidl out/h out/IFoo%d.cpp\n", i, i);
+  }
+
+  for (FakeIoDelegate* io : {&io_delegate_, &parallel_io_delegate}) {
+    const char* jobs = (io == &io_delegate_) ? "-j1" : "-j4";
+    io->SetFileContents("java_batch", java_batch);
+    io->SetFileContents("cpp_batch", cpp_batch);
+    const char* java_argv[] = {
+        "aidl", "-I.", "-ppreprocessed", "-oout", jobs, "--batch=java_batch"};
+    unique_ptr<JavaOptions> java_options = JavaOptions::Parse(6, java_argv);
+    ASSERT_NE(nullptr, java_options);
+    EXPECT_EQ(0, ::android::aidl::compile_aidl_to_java(*java_options, *io));
+    const char* cpp_argv[] = {"aidl-cpp", "-I.", jobs, "--batch=cpp_batch"};
+    unique_ptr<CppOptions> cpp_options = CppOptions::Parse(4, cpp_argv);
+    ASSERT_NE(nullptr, cpp_options);
+    EXPECT_EQ(0, ::android::aidl::compile_aidl_to_cpp(*cpp_options, *io));
+  }
+
+  for (int i = 0; i < kNumInterfaces; ++i) {
+    for (const string& path : {StringPrintf("out/p/IFoo%d.java", i),
+                               StringPrintf("out/IFoo%d.d", i),
+                               StringPrintf("out/IFoo%d.cpp", i),
+                               StringPrintf("out/h/p/BpFoo%d.h", i)}) {
+      string serial;
+      string parallel;
+      EXPECT_TRUE(io_delegate_.GetWrittenContents(path, &serial)) << path;
+      EXPECT_TRUE(parallel_io_delegate.GetWrittenContents(path, &parallel))
+          << path;
+      EXPECT_EQ(serial, parallel) << path;
+    }
+  }
+}
+
 }  // namespace aidl
 }  // namespace android
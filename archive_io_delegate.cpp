@@ -0,0 +1,223 @@
+/*
+ * Copyright (C) 2018, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "archive_io_delegate.h"
+
+#include <utility>
+
+#include "line_reader.h"
+#include "logging.h"
+#include "os.h"
+
+using std::shared_ptr;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+namespace android {
+namespace aidl {
+
+bool SplitArchivePath(const string& path, string* archive_path,
+                      string* entry_name) {
+  if (path.empty() || path[0] != kArchivePrefix) {
+    return false;
+  }
+  const string separator = {kArchiveEntrySeparator, OS_PATH_SEPARATOR};
+  const size_t pos = path.find(separator, 1);
+  if (pos == string::npos) {
+    return false;
+  }
+  *archive_path = path.substr(1, pos - 1);
+  *entry_name = path.substr(pos + separator.size());
+  // Entry names always use '/'.
+  for (char& c : *entry_name) {
+    if (c == OS_PATH_SEPARATOR) {
+      c = '/';
+    }
+  }
+  return !archive_path->empty();
+}
+
+ArchiveIoDelegate::ArchiveIoDelegate(const IoDelegate& io_delegate)
+    : io_delegate_(io_delegate) {}
+
+unique_ptr<string> ArchiveIoDelegate::GetFileContents(
+    const string& filename, const string& content_suffix) const {
+  string name;
+  shared_ptr<const Archive> archive = GetArchive(filename, &name);
+  if (!archive) {
+    return io_delegate_.GetFileContents(filename, content_suffix);
+  }
+  unique_ptr<string> contents(new string);
+  if (!archive->reader.ReadFile(name, contents.get())) {
+    return nullptr;
+  }
+  contents->append(content_suffix);
+  return contents;
+}
+
+unique_ptr<SourceBuffer> ArchiveIoDelegate::GetSourceBuffer(
+    const string& filename) const {
+  string name;
+  if (!GetArchive(filename, &name)) {
+    return io_delegate_.GetSourceBuffer(filename);
+  }
+  // Files in the archive may be compressed, and in any case the scanner
+  // needs them terminated, so they are always copied out.
+  unique_ptr<string> contents = GetFileContents(filename);
+  if (!contents) {
+    return nullptr;
+  }
+  return unique_ptr<SourceBuffer>(new SourceBuffer(std::move(contents)));
+}
+
+unique_ptr<LineReader> ArchiveIoDelegate::GetLineReader(
+    const string& file_path) const {
+  string name;
+  if (!GetArchive(file_path, &name)) {
+    return io_delegate_.GetLineReader(file_path);
+  }
+  unique_ptr<string> contents = GetFileContents(file_path);
+  if (!contents) {
+    return nullptr;
+  }
+  return LineReader::ReadFromMemory(*contents);
+}
+
+bool ArchiveIoDelegate::FileIsReadable(const string& path) const {
+  string name;
+  shared_ptr<const Archive> archive = GetArchive(path, &name);
+  if (!archive) {
+    return io_delegate_.FileIsReadable(path);
+  }
+  return archive->reader.HasFile(name);
+}
+
+bool ArchiveIoDelegate::ListFiles(const string& dir,
+                                  vector<string>* files) const {
+  string prefix;
+  shared_ptr<const Archive> archive = GetArchive(dir, &prefix);
+  if (!archive) {
+    return io_delegate_.ListFiles(dir, files);
+  }
+  if (!prefix.empty() && prefix.back() != '/') {
+    prefix += '/';
+  }
+  const size_t first = files->size();
+  archive->reader.ListFiles(prefix, files);
+  for (size_t i = first; i < files->size(); ++i) {
+    string& file = (*files)[i];
+    file.erase(0, prefix.size());
+    for (char& c : file) {
+      if (c == '/') {
+        c = OS_PATH_SEPARATOR;
+      }
+    }
+  }
+  return true;
+}
+
+bool ArchiveIoDelegate::GetModificationTime(const string& path,
+                                            int64_t* mtime) const {
+  string archive_path;
+  string name;
+  if (!SplitArchivePath(path, &archive_path, &name)) {
+    return io_delegate_.GetModificationTime(path, mtime);
+  }
+  if (!io_delegate_.GetModificationTime(archive_path, mtime)) {
+    return false;
+  }
+  std::lock_guard<std::mutex> guard(lock_);
+  const auto it = archives_.find(ArchiveKey(archive_path));
+  if (it != archives_.end() && it->second->mtime != *mtime) {
+    archives_.erase(it);
+  }
+  return true;
+}
+
+bool ArchiveIoDelegate::GetFileSize(const string& path, int64_t* size) const {
+  string name;
+  shared_ptr<const Archive> archive = GetArchive(path, &name);
+  if (!archive) {
+    return io_delegate_.GetFileSize(path, size);
+  }
+  return archive->reader.GetFileSize(name, size);
+}
+
+bool ArchiveIoDelegate::CreatedNestedDirs(
+    const string& base_dir, const vector<string>& nested_subdirs) const {
+  return io_delegate_.CreatedNestedDirs(base_dir, nested_subdirs);
+}
+
+unique_ptr<CodeWriter> ArchiveIoDelegate::GetCodeWriter(
+    const string& file_path) const {
+  return io_delegate_.GetCodeWriter(file_path);
+}
+
+void ArchiveIoDelegate::RemovePath(const string& file_path) const {
+  io_delegate_.RemovePath(file_path);
+}
+
+bool ArchiveIoDelegate::WriteFileAtomically(const string& path,
+                                            const string& contents) const {
+  return io_delegate_.WriteFileAtomically(path, contents);
+}
+
+string ArchiveIoDelegate::ArchiveKey(const string& archive_path) {
+  // Relative paths name different archives once the working directory
+  // changes, as it does between compile server requests.
+  string key;
+  if (!IoDelegate::GetAbsolutePath(archive_path, &key)) {
+    key = archive_path;
+  }
+  return key;
+}
+
+shared_ptr<const ArchiveIoDelegate::Archive> ArchiveIoDelegate::GetArchive(
+    const string& path, string* entry_name) const {
+  string archive_path;
+  if (!SplitArchivePath(path, &archive_path, entry_name)) {
+    return nullptr;
+  }
+
+  std::lock_guard<std::mutex> guard(lock_);
+  shared_ptr<const Archive>& slot = archives_[ArchiveKey(archive_path)];
+  if (!slot) {
+    shared_ptr<Archive> archive(new Archive);
+    if (!io_delegate_.GetModificationTime(archive_path, &archive->mtime)) {
+      archive->mtime = 0;
+    }
+    archive->buffer = io_delegate_.GetSourceBuffer(archive_path);
+    if (!archive->buffer) {
+      LOG(ERROR) << "Could not read archive " << archive_path;
+    } else if (!archive->reader.Open(archive->buffer->data(),
+                                     archive->buffer->size())) {
+      LOG(ERROR) << archive_path << " is not a zip archive";
+      archive->buffer.reset();
+    } else {
+      archive->readable = true;
+    }
+    slot = std::move(archive);
+  }
+  if (!slot->readable) {
+    return nullptr;
+  }
+  return slot;
+}
+
+}  // namespace aidl
+}  // namespace android
@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2018, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef AIDL_ARCHIVE_IO_DELEGATE_H_
+#define AIDL_ARCHIVE_IO_DELEGATE_H_
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <android-base/macros.h>
+
+#include "io_delegate.h"
+#include "zip_file.h"
+
+namespace android {
+namespace aidl {
+
+// Import roots given as "-I@ARCHIVE" name the files in a zip archive, rather
+// than in a directory.  The file ENTRY in it goes by "@ARCHIVE!/ENTRY".
+const char kArchivePrefix = '@';
+const char kArchiveEntrySeparator = '!';
+
+// Splits |path| into the archive it names a file in, and the name of that
+// file in the archive.  Returns false if |path| does not lie in an archive.
+bool SplitArchivePath(const std::string& path, std::string* archive_path,
+                      std::string* entry_name);
+
+// Forwards everything to another IoDelegate, except that files in archives
+// are read from the archive.  Each archive is read in, or mapped, once, the
+// first time one of its files is asked for; from then on looking up and
+// reading its files touches no file system.  Safe to use from several
+// threads at once.
+class ArchiveIoDelegate : public IoDelegate {
+ public:
+  explicit ArchiveIoDelegate(const IoDelegate& io_delegate);
+  virtual ~ArchiveIoDelegate() = default;
+
+  std::unique_ptr<std::string> GetFileContents(
+      const std::string& filename,
+      const std::string& content_suffix = "") const override;
+  std::unique_ptr<SourceBuffer> GetSourceBuffer(
+      const std::string& filename) const override;
+  std::unique_ptr<LineReader> GetLineReader(
+      const std::string& file_path) const override;
+  bool FileIsReadable(const std::string& path) const override;
+  bool ListFiles(const std::string& dir,
+                 std::vector<std::string>* files) const override;
+  // Files in an archive carry the modification time of the archive.  An
+  // archive that changed since it was read is read again.
+  bool GetModificationTime(const std::string& path,
+                           int64_t* mtime) const override;
+  // Files in an archive have the size they have once extracted.
+  bool GetFileSize(const std::string& path, int64_t* size) const override;
+  bool CreatedNestedDirs(
+      const std::string& base_dir,
+      const std::vector<std::string>& nested_subdirs) const override;
+  std::unique_ptr<CodeWriter> GetCodeWriter(
+      const std::string& file_path) const override;
+  void RemovePath(const std::string& file_path) const override;
+  bool WriteFileAtomically(const std::string& path,
+                           const std::string& contents) const override;
+
+ private:
+  struct Archive {
+    std::unique_ptr<SourceBuffer> buffer;
+    ZipReader reader;
+    int64_t mtime = 0;
+    // Archives that cannot be read are remembered as well, so that they are
+    // reported once rather than on every lookup.
+    bool readable = false;
+  };
+
+  // Returns the archive |path| lies in, reading it if need be, and stores
+  // the name of the file in it to |*entry_name|.  Returns nullptr if |path|
+  // does not lie in an archive, or the archive cannot be read.
+  std::shared_ptr<const Archive> GetArchive(const std::string& path,
+                                            std::string* entry_name) const;
+  // The key of the archive at |archive_path| in |archives_|.
+  static std::string ArchiveKey(const std::string& archive_path);
+
+  const IoDelegate& io_delegate_;
+  mutable std::mutex lock_;
+  // The archives read so far, by absolute path, until they change.
+  mutable std::map<std::string, std::shared_ptr<const Archive>> archives_;
+
+  DISALLOW_COPY_AND_ASSIGN(ArchiveIoDelegate);
+};
+
+}  // namespace aidl
+}  // namespace android
+
+#endif  // AIDL_ARCHIVE_IO_DELEGATE_H_
@@ -0,0 +1,376 @@
+/*
+ * Copyright (C) 2018, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ast_cache.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include "logging.h"
+#include "os.h"
+#include "sha256.h"
+
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+namespace android {
+namespace aidl {
+namespace {
+
+// Identifies the format of cache files.  Change it whenever the layout below
+// or the meaning of any parsed field changes.
+const char kMagic[] = "AIDLAST1";
+
+class AstWriter {
+ public:
+  explicit AstWriter(string* out) : out_(out) {}
+
+  void WriteUint(uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+      out_->push_back(static_cast<char>(value >> (8 * i)));
+    }
+  }
+  void WriteBool(bool value) { WriteUint(value ? 1 : 0); }
+  void WriteString(const string& value) {
+    WriteUint(value.size());
+    out_->append(value);
+  }
+  void WriteStrings(const vector<string>& values) {
+    WriteUint(values.size());
+    for (const string& value : values) {
+      WriteString(value);
+    }
+  }
+
+  void WriteAnnotations(const AidlAnnotatable& node) {
+    uint32_t annotations = AidlAnnotatable::AnnotationNone;
+    if (node.IsNullable()) annotations |= AidlAnnotatable::AnnotationNullable;
+    if (node.IsUtf8()) annotations |= AidlAnnotatable::AnnotationUtf8;
+    if (node.IsUtf8InCpp()) annotations |= AidlAnnotatable::AnnotationUtf8InCpp;
+    WriteUint(annotations);
+  }
+
+  void WriteType(const AidlType& type) {
+    WriteString(type.GetName());
+    WriteUint(type.GetLine());
+    WriteString(type.GetComments());
+    WriteBool(type.IsArray());
+    WriteAnnotations(type);
+  }
+
+  void WriteMethod(const AidlMethod& method) {
+    WriteBool(method.IsOneway());
+    WriteType(method.GetType());
+    WriteString(method.GetName());
+    WriteUint(method.GetLine());
+    WriteString(method.GetComments());
+    WriteBool(method.HasId());
+    WriteUint(method.GetId());
+    WriteUint(method.GetArguments().size());
+    for (const auto& arg : method.GetArguments()) {
+      WriteUint(arg->GetDirection());
+      WriteBool(arg->DirectionWasSpecified());
+      WriteType(arg->GetType());
+      WriteString(arg->GetName());
+      WriteUint(arg->GetLine());
+    }
+  }
+
+  void WriteInterface(const AidlInterface& interface) {
+    WriteString(interface.GetName());
+    WriteUint(interface.GetLine());
+    WriteString(interface.GetComments());
+    WriteBool(interface.IsOneway());
+    WriteAnnotations(interface);
+    WriteStrings(interface.GetSplitPackage());
+    WriteUint(interface.GetMethods().size());
+    for (const auto& method : interface.GetMethods()) {
+      WriteMethod(*method);
+    }
+    WriteUint(interface.GetIntConstants().size());
+    for (const auto& constant : interface.GetIntConstants()) {
+      WriteString(constant->GetName());
+      WriteUint(constant->GetValue());
+    }
+    WriteUint(interface.GetStringConstants().size());
+    for (const auto& constant : interface.GetStringConstants()) {
+      WriteString(constant->GetName());
+      WriteString(constant->GetValue());
+    }
+  }
+
+  void WriteParcelable(const AidlParcelable& parcelable) {
+    WriteString(parcelable.GetName());
+    WriteUint(parcelable.GetLine());
+    WriteStrings(parcelable.GetSplitPackage());
+    WriteString(parcelable.GetCppHeader());
+  }
+
+ private:
+  string* out_;
+};
+
+// Reads what AstWriter wrote.  Once anything is out of bounds, every read
+// fails, and Ok() returns false.
+class AstReader {
+ public:
+  AstReader(const char* data, size_t length)
+      : data_(data), remaining_(length) {}
+
+  bool Ok() const { return ok_; }
+  bool AtEnd() const { return remaining_ == 0; }
+
+  uint32_t ReadUint() {
+    if (!Check(4)) {
+      return 0;
+    }
+    uint32_t value = 0;
+    for (int i = 0; i < 4; ++i) {
+      value |= uint32_t{static_cast<uint8_t>(data_[i])} << (8 * i);
+    }
+    Skip(4);
+    return value;
+  }
+  bool ReadBool() { return ReadUint() != 0; }
+  string ReadString() {
+    const uint32_t length = ReadUint();
+    if (!Check(length)) {
+      return "";
+    }
+    string value(data_, length);
+    Skip(length);
+    return value;
+  }
+  vector<string> ReadStrings() {
+    vector<string> values;
+    for (uint32_t count = ReadUint(); ok_ && count > 0; --count) {
+      values.push_back(ReadString());
+    }
+    return values;
+  }
+
+  static void Annotate(uint32_t annotations, AidlAnnotatable* node) {
+    for (AidlAnnotatable::Annotation annotation :
+         {AidlAnnotatable::AnnotationNullable, AidlAnnotatable::AnnotationUtf8,
+          AidlAnnotatable::AnnotationUtf8InCpp}) {
+      if (annotations & annotation) {
+        node->Annotate(annotation);
+      }
+    }
+  }
+
+  AidlType* ReadType() {
+    const string name = ReadString();
+    const unsigned line = ReadUint();
+    const string comments = ReadString();
+    const bool is_array = ReadBool();
+    const uint32_t annotations = ReadUint();
+    AidlType* type = new AidlType(name, line, comments, is_array);
+    Annotate(annotations, type);
+    return type;
+  }
+
+  AidlMethod* ReadMethod() {
+    const bool oneway = ReadBool();
+    unique_ptr<AidlType> type(ReadType());
+    const string name = ReadString();
+    const unsigned line = ReadUint();
+    const string comments = ReadString();
+    const bool has_id = ReadBool();
+    const int id = ReadUint();
+    // AidlMethod takes ownership of the vector itself.
+    auto* args = new vector<unique_ptr<AidlArgument>>();
+    for (uint32_t count = ReadUint(); ok_ && count > 0; --count) {
+      const uint32_t direction = ReadUint();
+      const bool direction_specified = ReadBool();
+      AidlType* arg_type = ReadType();
+      const string arg_name = ReadString();
+      const unsigned arg_line = ReadUint();
+      if (direction < AidlArgument::IN_DIR ||
+          direction > AidlArgument::INOUT_DIR) {
+        ok_ = false;
+      }
+      if (direction_specified) {
+        args->emplace_back(new AidlArgument(
+            static_cast<AidlArgument::Direction>(direction), arg_type,
+            arg_name, arg_line));
+      } else {
+        args->emplace_back(new AidlArgument(arg_type, arg_name, arg_line));
+      }
+    }
+    if (has_id) {
+      return new AidlMethod(oneway, type.release(), name, args, line, comments,
+                            id);
+    }
+    return new AidlMethod(oneway, type.release(), name, args, line, comments);
+  }
+
+  AidlInterface* ReadInterface() {
+    const string name = ReadString();
+    const unsigned line = ReadUint();
+    const string comments = ReadString();
+    const bool oneway = ReadBool();
+    const uint32_t annotations = ReadUint();
+    const vector<string> package = ReadStrings();
+    // AidlInterface takes ownership of the vector itself.
+    auto* members = new vector<unique_ptr<AidlMember>>();
+    for (uint32_t count = ReadUint(); ok_ && count > 0; --count) {
+      members->emplace_back(ReadMethod());
+    }
+    for (uint32_t count = ReadUint(); ok_ && count > 0; --count) {
+      const string constant_name = ReadString();
+      const int32_t value = ReadUint();
+      members->emplace_back(new AidlIntConstant(constant_name, value));
+    }
+    for (uint32_t count = ReadUint(); ok_ && count > 0; --count) {
+      const string constant_name = ReadString();
+      const string value = ReadString();
+      members->emplace_back(new AidlStringConstant(constant_name, value, line));
+    }
+    AidlInterface* interface =
+        new AidlInterface(name, line, comments, oneway, members, package);
+    Annotate(annotations, interface);
+    return interface;
+  }
+
+  AidlParcelable* ReadParcelable() {
+    const string name = ReadString();
+    const unsigned line = ReadUint();
+    const vector<string> package = ReadStrings();
+    const string cpp_header = ReadString();
+    // AidlQualifiedName refuses empty terms outright.
+    if (name.empty() || name.front() == '.' || name.back() == '.' ||
+        name.find("..") != string::npos) {
+      ok_ = false;
+    }
+    AidlQualifiedName* qualified_name =
+        new AidlQualifiedName(ok_ ? name : "invalid", "");
+    // AidlParcelable expects the header with its quotes, as written.
+    return new AidlParcelable(qualified_name, line, package,
+                              cpp_header.empty() ? "" : '"' + cpp_header + '"');
+  }
+
+ private:
+  bool Check(size_t length) {
+    ok_ = ok_ && length <= remaining_;
+    return ok_;
+  }
+  void Skip(size_t length) {
+    data_ += length;
+    remaining_ -= length;
+  }
+
+  const char* data_;
+  size_t remaining_;
+  bool ok_ = true;
+};
+
+}  // namespace
+
+AstCache::AstCache(const IoDelegate& io_delegate, const string& dir)
+    : io_delegate_(io_delegate),
+      dir_(dir) {}
+
+string AstCache::PathFor(const string& contents) const {
+  string path = dir_;
+  if (!path.empty() && path.back() != OS_PATH_SEPARATOR) {
+    path += OS_PATH_SEPARATOR;
+  }
+  return path + Sha256Hex(contents) + ".ast";
+}
+
+bool AstCache::Load(const string& contents, const string& filename,
+                    unique_ptr<AidlDocument>* document,
+                    vector<unique_ptr<AidlImport>>* imports) const {
+  const string path = PathFor(contents);
+  if (!io_delegate_.FileIsReadable(path)) {
+    return false;
+  }
+  unique_ptr<string> cached = io_delegate_.GetFileContents(path);
+  const size_t magic_length = strlen(kMagic);
+  if (!cached || cached->compare(0, magic_length, kMagic) != 0) {
+    return false;
+  }
+
+  AstReader reader(cached->data() + magic_length,
+                   cached->size() - magic_length);
+  vector<unique_ptr<AidlImport>> cached_imports;
+  for (uint32_t count = reader.ReadUint(); reader.Ok() && count > 0; --count) {
+    const string needed_class = reader.ReadString();
+    const unsigned line = reader.ReadUint();
+    cached_imports.emplace_back(new AidlImport(filename, needed_class, line));
+  }
+  unique_ptr<AidlDocument> cached_document;
+  if (reader.ReadBool()) {
+    cached_document.reset(new AidlDocument(reader.ReadInterface()));
+  } else {
+    cached_document.reset(new AidlDocument());
+  }
+  for (uint32_t count = reader.ReadUint(); reader.Ok() && count > 0; --count) {
+    cached_document->AddParcelable(reader.ReadParcelable());
+  }
+  if (!reader.Ok() || !reader.AtEnd()) {
+    LOG(WARNING) << "Ignoring corrupt cached document " << path;
+    return false;
+  }
+
+  *document = std::move(cached_document);
+  for (auto& import : cached_imports) {
+    imports->push_back(std::move(import));
+  }
+  return true;
+}
+
+void AstCache::Store(const string& contents, const AidlDocument& document,
+                     const vector<unique_ptr<AidlImport>>& imports) const {
+  // Invalid constants are reported while parsing, which a cached document
+  // would skip, so such documents are always parsed.
+  const AidlInterface* interface = document.GetInterface();
+  if (interface) {
+    for (const auto& constant : interface->GetIntConstants()) {
+      if (!constant->IsValid()) return;
+    }
+    for (const auto& constant : interface->GetStringConstants()) {
+      if (!constant->IsValid()) return;
+    }
+  }
+
+  string serialized = kMagic;
+  AstWriter writer(&serialized);
+  writer.WriteUint(imports.size());
+  for (const auto& import : imports) {
+    writer.WriteString(import->GetNeededClass());
+    writer.WriteUint(import->GetLine());
+  }
+  writer.WriteBool(interface != nullptr);
+  if (interface) {
+    writer.WriteInterface(*interface);
+  }
+  writer.WriteUint(document.GetParcelables().size());
+  for (const auto& parcelable : document.GetParcelables()) {
+    writer.WriteParcelable(*parcelable);
+  }
+
+  const string path = PathFor(contents);
+  if (!io_delegate_.CreatePathForFile(path) ||
+      !io_delegate_.WriteFileAtomically(path, serialized)) {
+    LOG(WARNING) << "Cannot store parsed document to " << path;
+  }
+}
+
+}  // namespace aidl
+}  // namespace android
@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2018, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AIDL_AST_CACHE_H_
+#define AIDL_AST_CACHE_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <android-base/macros.h>
+
+#include "aidl_language.h"
+#include "io_delegate.h"
+
+namespace android {
+namespace aidl {
+
+// A directory of documents parsed from .aidl files, stored in a compact
+// binary form and keyed by the SHA-256 of the file contents, so that the
+// directory can be shared between builds and machines.  Parser consults it
+// before lexing and parsing a file.  Safe to use from several threads and
+// processes at once.
+class AstCache {
+ public:
+  AstCache(const IoDelegate& io_delegate, const std::string& dir);
+  ~AstCache() = default;
+
+  // Returns true and sets |*document| and appends to |*imports| what parsing
+  // |contents| would produce, if it is in the cache.  Imports are attributed
+  // to |filename|.
+  bool Load(const std::string& contents, const std::string& filename,
+            std::unique_ptr<AidlDocument>* document,
+            std::vector<std::unique_ptr<AidlImport>>* imports) const;
+
+  // Stores what parsing |contents| produced.  Failing to store is not an
+  // error; the file is simply parsed again next time.
+  void Store(const std::string& contents, const AidlDocument& document,
+             const std::vector<std::unique_ptr<AidlImport>>& imports) const;
+
+  const std::string& Dir() const { return dir_; }
+
+ private:
+  std::string PathFor(const std::string& contents) const;
+
+  const IoDelegate& io_delegate_;
+  const std::string dir_;
+
+  DISALLOW_COPY_AND_ASSIGN(AstCache);
+};
+
+}  // namespace aidl
+}  // namespace android
+
+#endif  // AIDL_AST_CACHE_H_
@@ -0,0 +1,184 @@
+/*
+ * Copyright (C) 2018, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "aidl_language.h"
+#include "ast_cache.h"
+#include "sha256.h"
+#include "tests/fake_io_delegate.h"
+
+using android::aidl::test::FakeIoDelegate;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+namespace android {
+namespace aidl {
+namespace {
+
+const char kInterface[] =
+    "package a.b;\n"
+    "import a.Bar;\n"
+    "import a.Baz;\n"
+    "/** Docs */\n"
+    "@utf8InCpp oneway interface IFoo {\n"
+    "  const int ONE = 1;\n"
+    "  const String NAME = \"foo\";\n"
+    "  void f(in @nullable Bar bar, out int[] values, inout Baz baz) = 7;\n"
+    "  /** More docs */ void g(String s);\n"
+    "}\n";
+
+// Returns a textual dump of everything a cache entry has to preserve.
+string Describe(const AidlDocument& document,
+                const vector<unique_ptr<AidlImport>>& imports) {
+  string out;
+  for (const auto& import : imports) {
+    out += "import " + import->GetNeededClass() + " from " +
+           import->GetFileFrom() + ":" + std::to_string(import->GetLine()) +
+           "\n";
+  }
+  auto describe_type = [&out](const AidlType& type) {
+    out += type.ToString() + "@" + std::to_string(type.GetLine()) + "/" +
+           type.GetComments() + (type.IsNullable() ? " nullable" : "") +
+           (type.IsUtf8InCpp() ? " utf8InCpp" : "") + "\n";
+  };
+  const AidlInterface* interface = document.GetInterface();
+  if (interface) {
+    out += interface->GetCanonicalName() + "@" +
+           std::to_string(interface->GetLine()) + "/" +
+           interface->GetComments() + (interface->IsOneway() ? " oneway" : "") +
+           (interface->IsUtf8InCpp() ? " utf8InCpp" : "") + "\n";
+    for (const auto& method : interface->GetMethods()) {
+      out += method->GetName() + "@" + std::to_string(method->GetLine()) +
+             "/" + method->GetComments() +
+             (method->HasId() ? " id " + std::to_string(method->GetId()) : "") +
+             "\n";
+      describe_type(method->GetType());
+      for (const auto& arg : method->GetArguments()) {
+        out += arg->ToString() + "@" + std::to_string(arg->GetLine()) + "\n";
+        describe_type(arg->GetType());
+      }
+    }
+    for (const auto& constant : interface->GetIntConstants()) {
+      out += constant->GetName() + "=" + std::to_string(constant->GetValue()) +
+             "\n";
+    }
+    for (const auto& constant : interface->GetStringConstants()) {
+      out += constant->GetName() + "=" + constant->GetValue() + "\n";
+    }
+  }
+  for (const auto& parcelable : document.GetParcelables()) {
+    out += parcelable->GetCanonicalName() + "@" +
+           std::to_string(parcelable->GetLine()) + " " +
+           parcelable->GetCppHeader() + "\n";
+  }
+  return out;
+}
+
+}  // namespace
+
+class AstCacheTest : public ::testing::Test {
+ protected:
+  // Parses |path| with the cache, and stores a description of the result.
+  bool Parse(const string& path, string* description) {
+    Parser p{io_delegate_, &cache_};
+    if (!p.ParseFile(path)) {
+      return false;
+    }
+    *description = Describe(*p.GetDocument(), p.GetImports());
+    return true;
+  }
+
+  // Returns the cache entry for |contents| that the last parse stored, and
+  // makes it visible to the next parse.
+  bool PublishCacheEntry(const string& contents, string* entry = nullptr) {
+    const string path = "cache/" + Sha256Hex(contents) + ".ast";
+    string cached;
+    if (!io_delegate_.GetWrittenContents(path, &cached)) {
+      return false;
+    }
+    io_delegate_.SetFileContents(path, cached);
+    if (entry) {
+      *entry = path;
+    }
+    return true;
+  }
+
+  FakeIoDelegate io_delegate_;
+  AstCache cache_{io_delegate_, "cache"};
+};
+
+TEST_F(AstCacheTest, CachedDocumentsMatchParsedOnes) {
+  const string parcelables =
+      "package a;\nparcelable Bar cpp_header \"a/Bar.h\";\nparcelable Q.R;\n";
+  io_delegate_.SetFileContents("IFoo.aidl", kInterface);
+  io_delegate_.SetFileContents("a/Bar.aidl", parcelables);
+
+  string parsed_interface, parsed_parcelables;
+  ASSERT_TRUE(Parse("IFoo.aidl", &parsed_interface));
+  ASSERT_TRUE(Parse("a/Bar.aidl", &parsed_parcelables));
+  ASSERT_TRUE(PublishCacheEntry(kInterface));
+  ASSERT_TRUE(PublishCacheEntry(parcelables));
+
+  // Parsing the same contents again only reads the cache.  Imports are
+  // attributed to whichever file has the contents now.
+  io_delegate_.SetFileContents("b/IFoo.aidl", kInterface);
+  string cached;
+  ASSERT_TRUE(Parse("b/IFoo.aidl", &cached));
+  EXPECT_NE(string::npos, cached.find("from b/IFoo.aidl:2")) << cached;
+  cached.replace(cached.find("b/IFoo.aidl"), 11, "IFoo.aidl");
+  cached.replace(cached.find("b/IFoo.aidl"), 11, "IFoo.aidl");
+  EXPECT_EQ(parsed_interface, cached);
+  ASSERT_TRUE(Parse("a/Bar.aidl", &cached));
+  EXPECT_EQ(parsed_parcelables, cached);
+}
+
+TEST_F(AstCacheTest, IgnoresCorruptEntries) {
+  io_delegate_.SetFileContents("a/b/IFoo.aidl", kInterface);
+  string parsed;
+  ASSERT_TRUE(Parse("a/b/IFoo.aidl", &parsed));
+  string entry;
+  ASSERT_TRUE(PublishCacheEntry(kInterface, &entry));
+  string contents;
+  ASSERT_TRUE(io_delegate_.GetWrittenContents(entry, &contents));
+
+  // Truncated entries, and entries in another format, are parsed again.
+  for (const string& corrupt :
+       {contents.substr(0, contents.size() / 2), "AIDLAST0" + contents.substr(8),
+        contents + "x"}) {
+    io_delegate_.SetFileContents(entry, corrupt);
+    string reparsed;
+    ASSERT_TRUE(Parse("a/b/IFoo.aidl", &reparsed));
+    EXPECT_EQ(parsed, reparsed);
+  }
+}
+
+TEST_F(AstCacheTest, DoesNotCacheDocumentsWithInvalidConstants) {
+  const string contents =
+      "package p; interface IFoo { const int X = 0x1FFFFFFFF; }";
+  io_delegate_.SetFileContents("p/IFoo.aidl", contents);
+  string parsed;
+  ASSERT_TRUE(Parse("p/IFoo.aidl", &parsed));
+  EXPECT_FALSE(PublishCacheEntry(contents));
+}
+
+}  // namespace aidl
+}  // namespace android
@@ -42,26 +42,26 @@ ClassDecl::ClassDecl(const std::string& name, const std::string& parent,
       private_members_(std::move(private_members)) {}
 
 void ClassDecl::Write(CodeWriter* to) const {
-  to->Write("class %s ", name_.c_str());
+  to->Append("class ", name_, " ");
 
   if (parent_.length() > 0)
-      to->Write(": public %s ", parent_.c_str());
+      to->Append(": public ", parent_, " ");
 
-  to->Write("{\n");
+  to->Append("{\n");
 
   if (!public_members_.empty())
-      to->Write("public:\n");
+      to->Append("public:\n");
 
   for (const auto& dec : public_members_)
     dec->Write(to);
 
   if (!private_members_.empty())
-      to->Write("private:\n");
+      to->Append("private:\n");
 
   for (const auto& dec : private_members_)
     dec->Write(to);
 
-  to->Write("};  // class %s\n", name_.c_str());
+  to->Append("};  // class ", name_, "\n");
 }
 
 void ClassDecl::AddPublic(std::unique_ptr<Declaration> member) {
@@ -83,18 +83,18 @@ Enum::Enum(const string& name) : Enum(name, "") {}
 
 void Enum::Write(CodeWriter* to) const {
   if (underlying_type_.empty()) {
-    to->Write("enum %s {\n", enum_name_.c_str());
+    to->Append("enum ", enum_name_, " {\n");
   } else {
-    to->Write("enum %s : %s {\n", enum_name_.c_str(), underlying_type_.c_str());
+    to->Append("enum ", enum_name_, " : ", underlying_type_, " {\n");
   }
   for (const auto& field : fields_) {
     if (field.value.empty()) {
-      to->Write("  %s,\n", field.key.c_str());
+      to->Append("  ", field.key, ",\n");
     } else {
-      to->Write("  %s = %s,\n", field.key.c_str(), field.value.c_str());
+      to->Append("  ", field.key, " = ", field.value, ",\n");
     }
   }
-  to->Write("};\n");
+  to->Append("};\n");
 }
 
 void Enum::AddValue(const string& key, const string& value) {
@@ -117,14 +117,14 @@ ArgList::ArgList(ArgList&& arg_list)
     : arguments_(std::move(arg_list.arguments_)) {}
 
 void ArgList::Write(CodeWriter* to) const {
-  to->Write("(");
+  to->Append("(");
   bool is_first = true;
   for (const auto& s : arguments_) {
-    if (!is_first) { to->Write(", "); }
+    if (!is_first) { to->Append(", "); }
     is_first = false;
     s->Write(to);
   }
-  to->Write(")");
+  to->Append(")");
 }
 
 ConstructorDecl::ConstructorDecl(
@@ -142,19 +142,19 @@ ConstructorDecl::ConstructorDecl(
 
 void ConstructorDecl::Write(CodeWriter* to) const {
   if (modifiers_ & Modifiers::IS_VIRTUAL)
-    to->Write("virtual ");
+    to->Append("virtual ");
 
   if (modifiers_ & Modifiers::IS_EXPLICIT)
-    to->Write("explicit ");
+    to->Append("explicit ");
 
-  to->Write("%s", name_.c_str());
+  to->Append(name_);
 
   arguments_.Write(to);
 
   if (modifiers_ & Modifiers::IS_DEFAULT)
-    to->Write(" = default");
+    to->Append(" = default");
 
-  to->Write(";\n");
+  to->Append(";\n");
 }
 
 MacroDecl::MacroDecl(const std::string& name, ArgList&& arg_list)
@@ -162,9 +162,9 @@ MacroDecl::MacroDecl(const std::string& name, ArgList&& arg_list)
       arguments_(std::move(arg_list)) {}
 
 void MacroDecl::Write(CodeWriter* to) const {
-  to->Write("%s", name_.c_str());
+  to->Append(name_);
   arguments_.Write(to);
-  to->Write("\n");
+  to->Append("\n");
 }
 
 MethodDecl::MethodDecl(const std::string& return_type,
@@ -187,25 +187,25 @@ MethodDecl::MethodDecl(const std::string& return_type,
 
 void MethodDecl::Write(CodeWriter* to) const {
   if (is_virtual_)
-    to->Write("virtual ");
+    to->Append("virtual ");
 
   if (is_static_)
-    to->Write("static ");
+    to->Append("static ");
 
-  to->Write("%s %s", return_type_.c_str(), name_.c_str());
+  to->Append(return_type_, " ", name_);
 
   arguments_.Write(to);
 
   if (is_const_)
-    to->Write(" const");
+    to->Append(" const");
 
   if (is_override_)
-    to->Write(" override");
+    to->Append(" override");
 
   if (is_pure_virtual_)
-    to->Write(" = 0");
+    to->Append(" = 0");
 
-  to->Write(";\n");
+  to->Append(";\n");
 }
 
 void StatementBlock::AddStatement(unique_ptr<AstNode> statement) {
@@ -227,11 +227,11 @@ void StatementBlock::AddLiteral(const std::string& expression_str,
 }
 
 void StatementBlock::Write(CodeWriter* to) const {
-  to->Write("{\n");
+  to->Append("{\n");
   for (const auto& statement : statements_) {
     statement->Write(to);
   }
-  to->Write("}\n");
+  to->Append("}\n");
 }
 
 ConstructorImpl::ConstructorImpl(const string& class_name,
@@ -242,16 +242,16 @@ ConstructorImpl::ConstructorImpl(const string& class_name,
         initializer_list_(initializer_list) {}
 
 void ConstructorImpl::Write(CodeWriter* to) const {
-  to->Write("%s::%s", class_name_.c_str(), class_name_.c_str());
+  to->Append(class_name_, "::", class_name_);
   arguments_.Write(to);
-  to->Write("\n");
+  to->Append("\n");
 
   bool is_first = true;
   for (const string& i : initializer_list_) {
     if (is_first) {
-      to->Write("    : %s", i.c_str());
+      to->Append("    : ", i);
     } else {
-      to->Write(",\n      %s", i.c_str());
+      to->Append(",\n      ", i);
     }
     is_first = false;
   }
@@ -278,9 +278,9 @@ StatementBlock* MethodImpl::GetStatementBlock() {
 }
 
 void MethodImpl::Write(CodeWriter* to) const {
-  to->Write("%s %s", return_type_.c_str(), method_name_.c_str());
+  to->Append(return_type_, " ", method_name_);
   arguments_.Write(to);
-  to->Write("%s ", (is_const_method_) ? " const" : "");
+  to->Append((is_const_method_) ? " const" : "", " ");
   statements_.Write(to);
 }
 
@@ -300,19 +300,19 @@ StatementBlock* SwitchStatement::AddCase(const string& value_expression) {
 }
 
 void SwitchStatement::Write(CodeWriter* to) const {
-  to->Write("switch (%s) {\n", switch_expression_.c_str());
+  to->Append("switch (", switch_expression_, ") {\n");
   for (size_t i = 0; i < case_values_.size(); ++i) {
     const string& case_value = case_values_[i];
     const unique_ptr<StatementBlock>& statements = case_logic_[i];
     if (case_value.empty()) {
-      to->Write("default:\n");
+      to->Append("default:\n");
     } else {
-      to->Write("case %s:\n", case_value.c_str());
+      to->Append("case ", case_value, ":\n");
     }
     statements->Write(to);
-    to->Write("break;\n");
+    to->Append("break;\n");
   }
-  to->Write("}\n");
+  to->Append("}\n");
 }
 
 
@@ -324,9 +324,9 @@ Assignment::Assignment(const std::string& left, AstNode* right)
       rhs_(right) {}
 
 void Assignment::Write(CodeWriter* to) const {
-  to->Write("%s = ", lhs_.c_str());
+  to->Append(lhs_, " = ");
   rhs_->Write(to);
-  to->Write(";\n");
+  to->Append(";\n");
 }
 
 MethodCall::MethodCall(const std::string& method_name,
@@ -339,7 +339,7 @@ MethodCall::MethodCall(const std::string& method_name,
       arguments_{std::move(arg_list)} {}
 
 void MethodCall::Write(CodeWriter* to) const {
-  to->Write("%s", method_name_.c_str());
+  to->Append(method_name_);
   arguments_.Write(to);
 }
 
@@ -348,13 +348,13 @@ IfStatement::IfStatement(AstNode* expression, bool invert_expression)
       invert_expression_(invert_expression) {}
 
 void IfStatement::Write(CodeWriter* to) const {
-  to->Write("if (%s", (invert_expression_) ? "!(" : "");
+  to->Append("if (", (invert_expression_) ? "!(" : "");
   expression_->Write(to);
-  to->Write(")%s ", (invert_expression_) ? ")" : "");
+  to->Append(")", (invert_expression_) ? ")" : "", " ");
   on_true_.Write(to);
 
   if (!on_false_.Empty()) {
-    to->Write("else ");
+    to->Append("else ");
     on_false_.Write(to);
   }
 }
@@ -369,7 +369,7 @@ Statement::Statement(const string& expression)
 
 void Statement::Write(CodeWriter* to) const {
   expression_->Write(to);
-  to->Write(";\n");
+  to->Append(";\n");
 }
 
 Comparison::Comparison(AstNode* lhs, const string& comparison, AstNode* rhs)
@@ -378,18 +378,18 @@ Comparison::Comparison(AstNode* lhs, const string& comparison, AstNode* rhs)
       operator_(comparison) {}
 
 void Comparison::Write(CodeWriter* to) const {
-  to->Write("((");
+  to->Append("((");
   left_->Write(to);
-  to->Write(") %s (", operator_.c_str());
+  to->Append(") ", operator_, " (");
   right_->Write(to);
-  to->Write("))");
+  to->Append("))");
 }
 
 LiteralExpression::LiteralExpression(const std::string& expression)
     : expression_(expression) {}
 
 void LiteralExpression::Write(CodeWriter* to) const {
-  to->Write("%s", expression_.c_str());
+  to->Append(expression_);
 }
 
 CppNamespace::CppNamespace(const std::string& name,
@@ -406,14 +406,14 @@ CppNamespace::CppNamespace(const std::string& name)
     : name_(name) {}
 
 void CppNamespace::Write(CodeWriter* to) const {
-  to->Write("namespace %s {\n\n", name_.c_str());
+  to->Append("namespace ", name_, " {\n\n");
 
   for (const auto& dec : declarations_) {
     dec->Write(to);
-    to->Write("\n");
+    to->Append("\n");
   }
 
-  to->Write("}  // namespace %s\n", name_.c_str());
+  to->Append("}  // namespace ", name_, "\n");
 }
 
 Document::Document(const std::vector<std::string>& include_list,
@@ -423,9 +423,9 @@ Document::Document(const std::vector<std::string>& include_list,
 
 void Document::Write(CodeWriter* to) const {
   for (const auto& include : include_list_) {
-    to->Write("#include <%s>\n", include.c_str());
+    to->Append("#include <", include, ">\n");
   }
-  to->Write("\n");
+  to->Append("\n");
 
   namespace_->Write(to);
 }
@@ -437,13 +437,13 @@ CppHeader::CppHeader(const std::string& include_guard,
       include_guard_(include_guard) {}
 
 void CppHeader::Write(CodeWriter* to) const {
-  to->Write("#ifndef %s\n", include_guard_.c_str());
-  to->Write("#define %s\n\n", include_guard_.c_str());
+  to->Append("#ifndef ", include_guard_, "\n");
+  to->Append("#define ", include_guard_, "\n\n");
 
   Document::Write(to);
-  to->Write("\n");
+  to->Append("\n");
 
-  to->Write("#endif  // %s\n", include_guard_.c_str());
+  to->Append("#endif  // ", include_guard_, "\n");
 }
 
 CppSource::CppSource(const std::vector<std::string>& include_list,
@@ -16,9 +16,14 @@
 
 #include "ast_java.h"
 
+#include <cstddef>
+#include <functional>
+#include <new>
+
 #include "code_writer.h"
 #include "type_java.h"
 
+using std::less;
 using std::vector;
 using std::string;
 
@@ -26,31 +31,135 @@ namespace android {
 namespace aidl {
 namespace java {
 
+namespace {
+
+const size_t kArenaBlockSize = 32 * 1024;
+const size_t kArenaAlignment = alignof(std::max_align_t);
+
+thread_local AstArena* current_arena = nullptr;
+
+}  // namespace
+
+AstArena::AstArena() : previous_(current_arena) {
+  current_arena = this;
+}
+
+AstArena::~AstArena() {
+  // Later nodes may point at earlier ones, never the other way around.
+  for (auto it = nodes_.rbegin(); it != nodes_.rend(); ++it) {
+    if (*it != nullptr) {
+      (*it)->~AstNode();
+    }
+  }
+  current_arena = previous_;
+}
+
+AstArena* AstArena::Current() {
+  return current_arena;
+}
+
+void* AstArena::Allocate(size_t size) {
+  size = (size + kArenaAlignment - 1) & ~(kArenaAlignment - 1);
+  if (size > kArenaBlockSize / 4) {
+    // Large nodes get a block of their own rather than wasting the tail of
+    // the current one.
+    blocks_.emplace_back(new char[size]);
+    char* block = blocks_.back().get();
+    block_bounds_.emplace_back(block, block + size);
+    return block;
+  }
+  if (static_cast<size_t>(end_ - next_) < size) {
+    blocks_.emplace_back(new char[kArenaBlockSize]);
+    next_ = blocks_.back().get();
+    end_ = next_ + kArenaBlockSize;
+    block_bounds_.emplace_back(next_, end_);
+  }
+  void* p = next_;
+  next_ += size;
+  return p;
+}
+
+bool AstArena::Owns(const void* p) const {
+  const char* c = static_cast<const char*>(p);
+  less<const char*> before;
+  // The block being filled is the last one, so search backwards.
+  for (auto it = block_bounds_.rbegin(); it != block_bounds_.rend(); ++it) {
+    if (!before(c, it->first) && before(c, it->second)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void AstArena::Track(AstNode* node) {
+  node->arena_ = this;
+  node->slot_ = nodes_.size();
+  nodes_.push_back(node);
+  ++live_nodes_;
+}
+
+void AstArena::Forget(AstNode* node) {
+  nodes_[node->slot_] = nullptr;
+  --live_nodes_;
+}
+
+AstNode::AstNode() {
+  for (AstArena* arena = current_arena; arena; arena = arena->previous_) {
+    if (arena->Owns(this)) {
+      arena->Track(this);
+      return;
+    }
+  }
+}
+
+AstNode::~AstNode() {
+  if (arena_ != nullptr) {
+    arena_->Forget(this);
+  }
+}
+
+void* AstNode::operator new(size_t size) {
+  if (current_arena == nullptr) {
+    return ::operator new(size);
+  }
+  return current_arena->Allocate(size);
+}
+
+void AstNode::operator delete(void* p) {
+  for (AstArena* arena = current_arena; arena; arena = arena->previous_) {
+    if (arena->Owns(p)) {
+      // Released with the rest of the arena.
+      return;
+    }
+  }
+  ::operator delete(p);
+}
+
 void WriteModifiers(CodeWriter* to, int mod, int mask) {
   int m = mod & mask;
 
   if (m & OVERRIDE) {
-    to->Write("@Override ");
+    to->Append("@Override ");
   }
 
   if ((m & SCOPE_MASK) == PUBLIC) {
-    to->Write("public ");
+    to->Append("public ");
   } else if ((m & SCOPE_MASK) == PRIVATE) {
-    to->Write("private ");
+    to->Append("private ");
   } else if ((m & SCOPE_MASK) == PROTECTED) {
-    to->Write("protected ");
+    to->Append("protected ");
   }
 
   if (m & STATIC) {
-    to->Write("static ");
+    to->Append("static ");
   }
 
   if (m & FINAL) {
-    to->Write("final ");
+    to->Append("final ");
   }
 
   if (m & ABSTRACT) {
-    to->Write("abstract ");
+    to->Append("abstract ");
   }
 }
 
@@ -59,7 +168,7 @@ void WriteArgumentList(CodeWriter* to, const vector<Expression*>& arguments) {
   for (size_t i = 0; i < N; i++) {
     arguments[i]->Write(to);
     if (i != N - 1) {
-      to->Write(", ");
+      to->Append(", ");
     }
   }
 }
@@ -68,27 +177,26 @@ Field::Field(int m, Variable* v) : ClassElement(), modifiers(m), variable(v) {}
 
 void Field::Write(CodeWriter* to) const {
   if (this->comment.length() != 0) {
-    to->Write("%s\n", this->comment.c_str());
+    to->Append(this->comment, "\n");
   }
   WriteModifiers(to, this->modifiers, SCOPE_MASK | STATIC | FINAL | OVERRIDE);
-  to->Write("%s %s", this->variable->type->JavaType().c_str(),
-            this->variable->name.c_str());
+  to->Append(this->variable->type->JavaType(), " ", this->variable->name);
   if (this->value.length() != 0) {
-    to->Write(" = %s", this->value.c_str());
+    to->Append(" = ", this->value);
   }
-  to->Write(";\n");
+  to->Append(";\n");
 }
 
 LiteralExpression::LiteralExpression(const string& v) : value(v) {}
 
 void LiteralExpression::Write(CodeWriter* to) const {
-  to->Write("%s", this->value.c_str());
+  to->Append(this->value);
 }
 
 StringLiteralExpression::StringLiteralExpression(const string& v) : value(v) {}
 
 void StringLiteralExpression::Write(CodeWriter* to) const {
-  to->Write("\"%s\"", this->value.c_str());
+  to->Append("\"", this->value, "\"");
 }
 
 Variable::Variable(const Type* t, const string& n)
@@ -102,11 +210,10 @@ void Variable::WriteDeclaration(CodeWriter* to) const {
   for (int i = 0; i < this->dimension; i++) {
     dim += "[]";
   }
-  to->Write("%s%s %s", this->type->JavaType().c_str(), dim.c_str(),
-            this->name.c_str());
+  to->Append(this->type->JavaType(), dim, " ", this->name);
 }
 
-void Variable::Write(CodeWriter* to) const { to->Write("%s", name.c_str()); }
+void Variable::Write(CodeWriter* to) const { to->Append(name); }
 
 FieldVariable::FieldVariable(Expression* o, const string& n)
     : object(o), clazz(NULL), name(n) {}
@@ -118,18 +225,18 @@ void FieldVariable::Write(CodeWriter* to) const {
   if (this->object != NULL) {
     this->object->Write(to);
   } else if (this->clazz != NULL) {
-    to->Write("%s", this->clazz->JavaType().c_str());
+    to->Append(this->clazz->JavaType());
   }
-  to->Write(".%s", name.c_str());
+  to->Append(".", name);
 }
 
 void StatementBlock::Write(CodeWriter* to) const {
-  to->Write("{\n");
+  to->Append("{\n");
   int N = this->statements.size();
   for (int i = 0; i < N; i++) {
     this->statements[i]->Write(to);
   }
-  to->Write("}\n");
+  to->Append("}\n");
 }
 
 void StatementBlock::Add(Statement* statement) {
@@ -144,7 +251,7 @@ ExpressionStatement::ExpressionStatement(Expression* e) : expression(e) {}
 
 void ExpressionStatement::Write(CodeWriter* to) const {
   this->expression->Write(to);
-  to->Write(";\n");
+  to->Append(";\n");
 }
 
 Assignment::Assignment(Variable* l, Expression* r)
@@ -155,9 +262,9 @@ Assignment::Assignment(Variable* l, Expression* r, const Type* c)
 
 void Assignment::Write(CodeWriter* to) const {
   this->lvalue->Write(to);
-  to->Write(" = ");
+  to->Append(" = ");
   if (this->cast != NULL) {
-    to->Write("(%s)", this->cast->JavaType().c_str());
+    to->Append("(", this->cast->JavaType(), ")");
   }
   this->rvalue->Write(to);
 }
@@ -201,24 +308,24 @@ void MethodCall::init(int n, va_list args) {
 void MethodCall::Write(CodeWriter* to) const {
   if (this->obj != NULL) {
     this->obj->Write(to);
-    to->Write(".");
+    to->Append(".");
   } else if (this->clazz != NULL) {
-    to->Write("%s.", this->clazz->JavaType().c_str());
+    to->Append(this->clazz->JavaType(), ".");
   }
-  to->Write("%s(", this->name.c_str());
+  to->Append(this->name, "(");
   WriteArgumentList(to, this->arguments);
-  to->Write(")");
+  to->Append(")");
 }
 
 Comparison::Comparison(Expression* l, const string& o, Expression* r)
     : lvalue(l), op(o), rvalue(r) {}
 
 void Comparison::Write(CodeWriter* to) const {
-  to->Write("(");
+  to->Append("(");
   this->lvalue->Write(to);
-  to->Write("%s", this->op.c_str());
+  to->Append(this->op);
   this->rvalue->Write(to);
-  to->Write(")");
+  to->Append(")");
 }
 
 NewExpression::NewExpression(const Type* t) : type(t) {}
@@ -238,39 +345,39 @@ void NewExpression::init(int n, va_list args) {
 }
 
 void NewExpression::Write(CodeWriter* to) const {
-  to->Write("new %s(", this->type->InstantiableName().c_str());
+  to->Append("new ", this->type->InstantiableName(), "(");
   WriteArgumentList(to, this->arguments);
-  to->Write(")");
+  to->Append(")");
 }
 
 NewArrayExpression::NewArrayExpression(const Type* t, Expression* s)
     : type(t), size(s) {}
 
 void NewArrayExpression::Write(CodeWriter* to) const {
-  to->Write("new %s[", this->type->JavaType().c_str());
+  to->Append("new ", this->type->JavaType(), "[");
   size->Write(to);
-  to->Write("]");
+  to->Append("]");
 }
 
 Ternary::Ternary(Expression* a, Expression* b, Expression* c)
     : condition(a), ifpart(b), elsepart(c) {}
 
 void Ternary::Write(CodeWriter* to) const {
-  to->Write("((");
+  to->Append("((");
   this->condition->Write(to);
-  to->Write(")?(");
+  to->Append(")?(");
   this->ifpart->Write(to);
-  to->Write("):(");
+  to->Append("):(");
   this->elsepart->Write(to);
-  to->Write("))");
+  to->Append("))");
 }
 
 Cast::Cast(const Type* t, Expression* e) : type(t), expression(e) {}
 
 void Cast::Write(CodeWriter* to) const {
-  to->Write("((%s)", this->type->JavaType().c_str());
+  to->Append("((", this->type->JavaType(), ")");
   expression->Write(to);
-  to->Write(")");
+  to->Append(")");
 }
 
 VariableDeclaration::VariableDeclaration(Variable* l, Expression* r,
@@ -282,24 +389,24 @@ VariableDeclaration::VariableDeclaration(Variable* l) : lvalue(l) {}
 void VariableDeclaration::Write(CodeWriter* to) const {
   this->lvalue->WriteDeclaration(to);
   if (this->rvalue != NULL) {
-    to->Write(" = ");
+    to->Append(" = ");
     if (this->cast != NULL) {
-      to->Write("(%s)", this->cast->JavaType().c_str());
+      to->Append("(", this->cast->JavaType(), ")");
     }
     this->rvalue->Write(to);
   }
-  to->Write(";\n");
+  to->Append(";\n");
 }
 
 void IfStatement::Write(CodeWriter* to) const {
   if (this->expression != NULL) {
-    to->Write("if (");
+    to->Append("if (");
     this->expression->Write(to);
-    to->Write(") ");
+    to->Append(") ");
   }
   this->statements->Write(to);
   if (this->elseif != NULL) {
-    to->Write("else ");
+    to->Append("else ");
     this->elseif->Write(to);
   }
 }
@@ -307,13 +414,13 @@ void IfStatement::Write(CodeWriter* to) const {
 ReturnStatement::ReturnStatement(Expression* e) : expression(e) {}
 
 void ReturnStatement::Write(CodeWriter* to) const {
-  to->Write("return ");
+  to->Append("return ");
   this->expression->Write(to);
-  to->Write(";\n");
+  to->Append(";\n");
 }
 
 void TryStatement::Write(CodeWriter* to) const {
-  to->Write("try ");
+  to->Append("try ");
   this->statements->Write(to);
 }
 
@@ -321,17 +428,17 @@ CatchStatement::CatchStatement(Variable* e)
     : statements(new StatementBlock), exception(e) {}
 
 void CatchStatement::Write(CodeWriter* to) const {
-  to->Write("catch ");
+  to->Append("catch ");
   if (this->exception != NULL) {
-    to->Write("(");
+    to->Append("(");
     this->exception->WriteDeclaration(to);
-    to->Write(") ");
+    to->Append(") ");
   }
   this->statements->Write(to);
 }
 
 void FinallyStatement::Write(CodeWriter* to) const {
-  to->Write("finally ");
+  to->Append("finally ");
   this->statements->Write(to);
 }
 
@@ -343,13 +450,13 @@ void Case::Write(CodeWriter* to) const {
     for (int i = 0; i < N; i++) {
       string s = this->cases[i];
       if (s.length() != 0) {
-        to->Write("case %s:\n", s.c_str());
+        to->Append("case ", s, ":\n");
       } else {
-        to->Write("default:\n");
+        to->Append("default:\n");
       }
     }
   } else {
-    to->Write("default:\n");
+    to->Append("default:\n");
   }
   statements->Write(to);
 }
@@ -357,23 +464,23 @@ void Case::Write(CodeWriter* to) const {
 SwitchStatement::SwitchStatement(Expression* e) : expression(e) {}
 
 void SwitchStatement::Write(CodeWriter* to) const {
-  to->Write("switch (");
+  to->Append("switch (");
   this->expression->Write(to);
-  to->Write(")\n{\n");
+  to->Append(")\n{\n");
   int N = this->cases.size();
   for (int i = 0; i < N; i++) {
     this->cases[i]->Write(to);
   }
-  to->Write("}\n");
+  to->Append("}\n");
 }
 
-void Break::Write(CodeWriter* to) const { to->Write("break;\n"); }
+void Break::Write(CodeWriter* to) const { to->Append("break;\n"); }
 
 void Method::Write(CodeWriter* to) const {
   size_t N, i;
 
   if (this->comment.length() != 0) {
-    to->Write("%s\n", this->comment.c_str());
+    to->Append(this->comment, "\n");
   }
 
   WriteModifiers(to, this->modifiers,
@@ -384,62 +491,62 @@ void Method::Write(CodeWriter* to) const {
     for (i = 0; i < this->returnTypeDimension; i++) {
       dim += "[]";
     }
-    to->Write("%s%s ", this->returnType->JavaType().c_str(), dim.c_str());
+    to->Append(this->returnType->JavaType(), dim, " ");
   }
 
-  to->Write("%s(", this->name.c_str());
+  to->Append(this->name, "(");
 
   N = this->parameters.size();
   for (i = 0; i < N; i++) {
     this->parameters[i]->WriteDeclaration(to);
     if (i != N - 1) {
-      to->Write(", ");
+      to->Append(", ");
     }
   }
 
-  to->Write(")");
+  to->Append(")");
 
   N = this->exceptions.size();
   for (i = 0; i < N; i++) {
     if (i == 0) {
-      to->Write(" throws ");
+      to->Append(" throws ");
     } else {
-      to->Write(", ");
+      to->Append(", ");
     }
-    to->Write("%s", this->exceptions[i]->JavaType().c_str());
+    to->Append(this->exceptions[i]->JavaType());
   }
 
   if (this->statements == NULL) {
-    to->Write(";\n");
+    to->Append(";\n");
   } else {
-    to->Write("\n");
+    to->Append("\n");
     this->statements->Write(to);
   }
 }
 
 void IntConstant::Write(CodeWriter* to) const {
   WriteModifiers(to, STATIC | FINAL | PUBLIC, ALL_MODIFIERS);
-  to->Write("int %s = %d;\n", name.c_str(), value);
+  to->Append("int ", name, " = ", value, ";\n");
 }
 
 void StringConstant::Write(CodeWriter* to) const {
   WriteModifiers(to, STATIC | FINAL | PUBLIC, ALL_MODIFIERS);
-  to->Write("String %s = %s;\n", name.c_str(), value.c_str());
+  to->Append("String ", name, " = ", value, ";\n");
 }
 
 void Class::Write(CodeWriter* to) const {
   size_t N, i;
 
   if (this->comment.length() != 0) {
-    to->Write("%s\n", this->comment.c_str());
+    to->Append(this->comment, "\n");
   }
 
   WriteModifiers(to, this->modifiers, ALL_MODIFIERS);
 
   if (this->what == Class::CLASS) {
-    to->Write("class ");
+    to->Append("class ");
   } else {
-    to->Write("interface ");
+    to->Append("interface ");
   }
 
   string name = this->type->JavaType();
@@ -448,33 +555,33 @@ void Class::Write(CodeWriter* to) const {
     name = name.c_str() + pos + 1;
   }
 
-  to->Write("%s", name.c_str());
+  to->Append(name);
 
   if (this->extends != NULL) {
-    to->Write(" extends %s", this->extends->JavaType().c_str());
+    to->Append(" extends ", this->extends->JavaType());
   }
 
   N = this->interfaces.size();
   if (N != 0) {
     if (this->what == Class::CLASS) {
-      to->Write(" implements");
+      to->Append(" implements");
     } else {
-      to->Write(" extends");
+      to->Append(" extends");
     }
     for (i = 0; i < N; i++) {
-      to->Write(" %s", this->interfaces[i]->JavaType().c_str());
+      to->Append(" ", this->interfaces[i]->JavaType());
     }
   }
 
-  to->Write("\n");
-  to->Write("{\n");
+  to->Append("\n");
+  to->Append("{\n");
 
   N = this->elements.size();
   for (i = 0; i < N; i++) {
     this->elements[i]->Write(to);
   }
 
-  to->Write("}\n");
+  to->Append("}\n");
 }
 
 static string escape_backslashes(const string& str) {
@@ -503,16 +610,17 @@ Document::Document(const std::string& comment,
 
 void Document::Write(CodeWriter* to) const {
   if (!comment_.empty()) {
-    to->Write("%s\n", comment_.c_str());
+    to->Append(comment_, "\n");
   }
-  to->Write(
+  to->Append(
       "/*\n"
       " * This file is auto-generated.  DO NOT MODIFY.\n"
-      " * Original file: %s\n"
-      " */\n",
-      escape_backslashes(original_src_).c_str());
+      " * Original file: ",
+      escape_backslashes(original_src_),
+      "\n"
+      " */\n");
   if (!package_.empty()) {
-    to->Write("package %s;\n", package_.c_str());
+    to->Append("package ", package_, ";\n");
   }
 
   if (clazz_) {
@@ -19,10 +19,14 @@
 
 #include <memory>
 #include <stdarg.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include <android-base/macros.h>
+
 enum {
   PACKAGE_PRIVATE = 0x00000000,
   PUBLIC = 0x00000001,
@@ -50,18 +54,70 @@ namespace aidl {
 namespace java {
 
 class Type;
+struct AstNode;
 
 // Write the modifiers that are set in both mod and mask
 void WriteModifiers(CodeWriter* to, int mod, int mask);
 
-struct ClassElement {
+// While alive, an AstArena is the current arena of the thread that created
+// it.  AST nodes allocated with new on that thread are carved out of large
+// blocks owned by the arena and are all destroyed with it, so generators may
+// keep building trees out of raw pointers without leaking them.  Nodes created
+// while no arena is current are ordinary heap objects.
+class AstArena {
+ public:
+  AstArena();
+  ~AstArena();
+
+  // Returns the innermost arena of this thread, or nullptr.
+  static AstArena* Current();
+
+  void* Allocate(size_t size);
+  bool Owns(const void* p) const;
+  size_t NodeCount() const { return live_nodes_; }
+
+ private:
+  friend struct AstNode;
+
+  void Track(AstNode* node);
+  void Forget(AstNode* node);
+
+  AstArena* const previous_;
+  std::vector<std::unique_ptr<char[]>> blocks_;
+  std::vector<std::pair<const char*, const char*>> block_bounds_;
+  char* next_ = nullptr;
+  char* end_ = nullptr;
+  std::vector<AstNode*> nodes_;
+  size_t live_nodes_ = 0;
+
+  DISALLOW_COPY_AND_ASSIGN(AstArena);
+};
+
+// Base of every heap allocated node of the Java AST.
+struct AstNode {
+  AstNode();
+  virtual ~AstNode();
+
+  static void* operator new(size_t size);
+  static void operator delete(void* p);
+
+ private:
+  friend class AstArena;
+
+  AstArena* arena_ = nullptr;
+  size_t slot_ = 0;
+
+  DISALLOW_COPY_AND_ASSIGN(AstNode);
+};
+
+struct ClassElement : public AstNode {
   ClassElement() = default;
   virtual ~ClassElement() = default;
 
   virtual void Write(CodeWriter* to) const = 0;
 };
 
-struct Expression {
+struct Expression : public AstNode {
   virtual ~Expression() = default;
   virtual void Write(CodeWriter* to) const = 0;
 };
@@ -122,7 +178,7 @@ struct Field : public ClassElement {
   void Write(CodeWriter* to) const override;
 };
 
-struct Statement {
+struct Statement : public AstNode {
   virtual ~Statement() = default;
   virtual void Write(CodeWriter* to) const = 0;
 };
@@ -285,7 +341,7 @@ struct FinallyStatement : public Statement {
   void Write(CodeWriter* to) const override;
 };
 
-struct Case {
+struct Case : public AstNode {
   std::vector<std::string> cases;
   StatementBlock* statements = new StatementBlock;
 
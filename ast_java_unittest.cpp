@@ -29,6 +29,17 @@ namespace aidl {
 namespace java {
 namespace {
 
+// Counts how many instances are alive.
+struct CountedExpression : public LiteralExpression {
+  explicit CountedExpression(int* live)
+      : LiteralExpression("counted"), live_(live) {
+    ++*live_;
+  }
+  ~CountedExpression() override { --*live_; }
+
+  int* live_;
+};
+
 const char kExpectedClassOutput[] =
 R"(// class comment
 final class TestClass extends SuperClass
@@ -58,6 +69,48 @@ TEST(AstJavaTests, GeneratesClass) {
   EXPECT_EQ(string(kExpectedClassOutput), actual_output);
 }
 
+TEST(AstJavaTests, ArenaDestroysNodesItAllocated) {
+  int live = 0;
+  Expression* outside = new CountedExpression(&live);
+  {
+    AstArena arena;
+    EXPECT_EQ(&arena, AstArena::Current());
+    StatementBlock* block = new StatementBlock;
+    for (int i = 0; i < 10000; ++i) {
+      block->Add(new CountedExpression(&live));
+    }
+    EXPECT_FALSE(arena.Owns(outside));
+    EXPECT_TRUE(arena.Owns(block));
+    EXPECT_EQ(10001u + 10000u, arena.NodeCount());
+    EXPECT_EQ(10001, live);
+
+    // Explicitly deleted nodes are not destroyed a second time.
+    delete new CountedExpression(&live);
+    EXPECT_EQ(10001, live);
+    EXPECT_EQ(10001u + 10000u, arena.NodeCount());
+  }
+  EXPECT_EQ(nullptr, AstArena::Current());
+  EXPECT_EQ(1, live);
+  delete outside;
+  EXPECT_EQ(0, live);
+}
+
+TEST(AstJavaTests, NestedArenasReleaseOnlyTheirOwnNodes) {
+  int live = 0;
+  AstArena outer;
+  Expression* kept = new CountedExpression(&live);
+  {
+    AstArena inner;
+    new CountedExpression(&live);
+    EXPECT_EQ(2, live);
+    // Deleting a node of the enclosing arena leaves its memory to that arena.
+    delete kept;
+    EXPECT_EQ(1, live);
+  }
+  EXPECT_EQ(0, live);
+  EXPECT_EQ(0u, outer.NodeCount());
+}
+
 }  // namespace java
 }  // namespace aidl
 }  // namespace android
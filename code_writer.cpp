@@ -16,11 +16,28 @@
 
 #include "code_writer.h"
 
+#include <fcntl.h>
 #include <iostream>
 #include <stdarg.h>
+#include <sys/stat.h>
 
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include <android-base/file.h>
 #include <android-base/stringprintf.h>
 
+#include "trace.h"
+
+#ifndef O_BINARY
+#  define O_BINARY  0
+#endif
+
+using android::base::StringAppendV;
+using android::base::WriteFully;
 using std::cerr;
 using std::endl;
 
@@ -37,68 +54,121 @@ class StringCodeWriter : public CodeWriter {
   bool Write(const char* format, ...) override {
     va_list ap;
     va_start(ap, format);
-    android::base::StringAppendV(output_, format, ap);
+    StringAppendV(output_, format, ap);
     va_end(ap);
     return true;
   }
 
+  bool AppendBytes(const char* data, size_t length) override {
+    output_->append(data, length);
+    return true;
+  }
+
   bool Close() override { return true; }
 
  private:
   std::string* output_;
 };  // class StringCodeWriter
 
+// Collects output in memory and hands it to the kernel in large writes, rather
+// than going through stdio for every fragment.
 class FileCodeWriter : public CodeWriter {
  public:
-  FileCodeWriter(FILE* output_file, bool close_on_destruction)
-      : output_(output_file),
-        close_on_destruction_(close_on_destruction) {}
-  virtual ~FileCodeWriter() {
-    if (close_on_destruction_ && output_ != nullptr) {
-      fclose(output_);
-    }
+  FileCodeWriter(int fd, bool close_on_destruction)
+      : fd_(fd),
+        close_on_destruction_(close_on_destruction) {
+    buffer_.reserve(kBufferSize);
   }
+  virtual ~FileCodeWriter() { Close(); }
 
   bool Write(const char* format, ...) override {
-    bool success;
     va_list ap;
     va_start(ap, format);
-    success = vfprintf(output_, format, ap) >= 0;
+    StringAppendV(&buffer_, format, ap);
     va_end(ap);
-    no_error_ = no_error_ && success;
-    return success;
+    if (buffer_.size() >= kBufferSize) {
+      Flush();
+    }
+    return no_error_;
+  }
+
+  bool AppendBytes(const char* data, size_t length) override {
+    if (buffer_.size() + length > kBufferSize) {
+      Flush();
+      if (length >= kBufferSize) {
+        // Too big to be worth copying into the buffer first.
+        no_error_ = fd_ != -1 && WriteFully(fd_, data, length) && no_error_;
+        return no_error_;
+      }
+    }
+    buffer_.append(data, length);
+    return no_error_;
   }
 
   bool Close() override {
-    if (output_ != nullptr) {
-      no_error_ = fclose(output_) == 0 && no_error_;
-      output_ = nullptr;
+    if (fd_ != -1) {
+      Flush();
+      if (close_on_destruction_) {
+        no_error_ = close(fd_) == 0 && no_error_;
+      }
+      fd_ = -1;
     }
     return no_error_;
   }
 
  private:
+  static constexpr size_t kBufferSize = 64 * 1024;
+
+  void Flush() {
+    TraceSpan span("CodeWriter::Flush");
+    if (!buffer_.empty()) {
+      no_error_ = fd_ != -1 &&
+                  WriteFully(fd_, buffer_.data(), buffer_.size()) &&
+                  no_error_;
+      buffer_.clear();
+    }
+  }
+
   bool no_error_ = true;
-  FILE* output_;
+  int fd_;
   bool close_on_destruction_;
-};  // class StringCodeWriter
+  std::string buffer_;
+};  // class FileCodeWriter
 
 }  // namespace
 
+bool CodeWriter::Append(int value) {
+  char digits[16];
+  char* const end = digits + sizeof(digits);
+  char* begin = end;
+  unsigned magnitude = (value < 0) ? 0u - static_cast<unsigned>(value)
+                                   : static_cast<unsigned>(value);
+  do {
+    *--begin = static_cast<char>('0' + magnitude % 10);
+    magnitude /= 10;
+  } while (magnitude != 0);
+  if (value < 0) {
+    *--begin = '-';
+  }
+  return AppendBytes(begin, end - begin);
+}
+
 CodeWriterPtr GetFileWriter(const std::string& output_file) {
   CodeWriterPtr result;
-  FILE* to = nullptr;
+  int to = -1;
   bool close_on_destruction = true;
   if (output_file == "-") {
-    to = stdout;
+    fflush(stdout);
+    to = fileno(stdout);
     close_on_destruction = false;
   } else {
     // open file in binary mode to ensure that the tool produces the
     // same output on all platforms !!
-    to = fopen(output_file.c_str(), "wb");
+    to = open(output_file.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_BINARY,
+              0666);
   }
 
-  if (to != nullptr) {
+  if (to != -1) {
     result.reset(new FileCodeWriter(to, close_on_destruction));
   } else {
     cerr << "unable to open " << output_file << " for write" << endl;
@@ -21,6 +21,7 @@
 #include <string>
 
 #include <stdio.h>
+#include <string.h>
 
 #include <android-base/macros.h>
 
@@ -32,6 +33,32 @@ class CodeWriter {
   // Write a formatted string to this writer in the usual printf sense.
   // Returns false on error.
   virtual bool Write(const char* format, ...) = 0;
+
+  // Write |length| bytes at |data| to this writer verbatim.
+  // Returns false on error.
+  virtual bool AppendBytes(const char* data, size_t length) = 0;
+
+  // Write text to this writer verbatim, without parsing it as a format.
+  // These are much cheaper than Write() for the many small fragments that
+  // generated code is assembled from.  Return false on error.
+  bool Append(const std::string& text) {
+    return AppendBytes(text.data(), text.size());
+  }
+  bool Append(const char* text) { return AppendBytes(text, strlen(text)); }
+  bool Append(char c) { return AppendBytes(&c, 1); }
+  // Writes |value| in decimal, as "%d" would.
+  bool Append(int value);
+
+  // Appends each of |pieces| in turn, so that
+  //   to->Append("class ", name, " {\n");
+  // writes the same as three separate calls.
+  template <typename First, typename Second, typename... Rest>
+  bool Append(const First& first, const Second& second,
+              const Rest&... rest) {
+    const bool success = Append(first);
+    return Append(second, rest...) && success;
+  }
+
   virtual bool Close() = 0;
   virtual ~CodeWriter() = default;
 };  // class CodeWriter
@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2018, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <limits.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <memory>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "code_writer.h"
+#include "io_delegate.h"
+
+using std::string;
+using std::unique_ptr;
+
+namespace android {
+namespace aidl {
+
+TEST(CodeWriterTest, AppendsWithoutFormatting) {
+  string output;
+  CodeWriterPtr writer = GetStringWriter(&output);
+  const string name = "100%s";
+  EXPECT_TRUE(writer->Append("int "));
+  EXPECT_TRUE(writer->Append(name));
+  EXPECT_TRUE(writer->Append(' '));
+  EXPECT_TRUE(writer->Append("= ", 0, ", ", -7, ", ", INT_MIN, ";\n"));
+  EXPECT_TRUE(writer->AppendBytes("a\0b", 3));
+  EXPECT_TRUE(writer->Close());
+  EXPECT_EQ(string("int 100%s = 0, -7, -2147483648;\na\0b", 35), output);
+}
+
+TEST(CodeWriterTest, FileWriterKeepsOrderAcrossFlushes) {
+  char temp_dir[] = "/tmp/aidl_code_writer_XXXXXX";
+  ASSERT_NE(nullptr, mkdtemp(temp_dir));
+  const string path = string(temp_dir) + "/out.txt";
+
+  // Mix small fragments, formatted writes and fragments larger than the
+  // writer's buffer.
+  string expected;
+  {
+    CodeWriterPtr writer = GetFileWriter(path);
+    ASSERT_NE(nullptr, writer);
+    for (int i = 0; i < 20000; ++i) {
+      writer->Append("line ", i, "\n");
+      expected += "line " + std::to_string(i) + "\n";
+      if (i % 5000 == 0) {
+        const string big(100 * 1024, 'a' + i % 26);
+        writer->Append(big);
+        writer->Write("%s|%d\n", "formatted", i);
+        expected += big + "formatted|" + std::to_string(i) + "\n";
+      }
+    }
+    EXPECT_TRUE(writer->Close());
+  }
+
+  IoDelegate io_delegate;
+  unique_ptr<string> contents = io_delegate.GetFileContents(path);
+  ASSERT_NE(nullptr, contents);
+  EXPECT_EQ(expected, *contents);
+
+  unlink(path.c_str());
+  rmdir(temp_dir);
+}
+
+}  // namespace aidl
+}  // namespace android
@@ -0,0 +1,430 @@
+/*
+ * Copyright (C) 2018, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "compile_server.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include <iostream>
+#include <memory>
+
+#include <android-base/file.h>
+#include <android-base/parseint.h>
+#include <android-base/unique_fd.h>
+
+#include "logging.h"
+#include "options.h"
+
+using android::base::ParseInt;
+using android::base::ReadFdToString;
+using android::base::ReadFully;
+using android::base::WriteFully;
+using android::base::unique_fd;
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+namespace android {
+namespace aidl {
+namespace {
+
+#ifndef _WIN32
+
+// Messages are a count of strings followed by the strings, each prefixed
+// with its length.  Requests are either
+//   "compile" CWD ARG...
+// or
+//   "stop"
+// and are answered with the exit code, in decimal, and the output.
+const char kCompileRequest[] = "compile";
+const char kStopRequest[] = "stop";
+// Guards against allocating absurd amounts of memory for a corrupt message.
+const uint32_t kMaxMessageSize = 64u << 20;
+
+bool WriteMessage(int fd, const vector<string>& message) {
+  uint32_t count = message.size();
+  if (!WriteFully(fd, &count, sizeof(count))) {
+    return false;
+  }
+  for (const string& part : message) {
+    uint32_t length = part.size();
+    if (!WriteFully(fd, &length, sizeof(length)) ||
+        !WriteFully(fd, part.data(), part.size())) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool ReadMessage(int fd, vector<string>* message) {
+  uint32_t count;
+  if (!ReadFully(fd, &count, sizeof(count)) || count > kMaxMessageSize) {
+    return false;
+  }
+  message->clear();
+  uint32_t total = 0;
+  for (uint32_t i = 0; i < count; ++i) {
+    uint32_t length;
+    if (!ReadFully(fd, &length, sizeof(length)) ||
+        length > kMaxMessageSize - total) {
+      return false;
+    }
+    total += length;
+    message->emplace_back(length, '\0');
+    if (length > 0 && !ReadFully(fd, &message->back()[0], length)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool MakeAddress(const string& socket_path, sockaddr_un* address) {
+  memset(address, 0, sizeof(*address));
+  address->sun_family = AF_UNIX;
+  if (socket_path.empty() || socket_path.size() >= sizeof(address->sun_path)) {
+    LOG(ERROR) << "invalid socket path: '" << socket_path << "'";
+    return false;
+  }
+  memcpy(address->sun_path, socket_path.c_str(), socket_path.size());
+  return true;
+}
+
+unique_fd Connect(const string& socket_path) {
+  sockaddr_un address;
+  if (!MakeAddress(socket_path, &address)) {
+    return unique_fd();
+  }
+  unique_fd fd(socket(AF_UNIX, SOCK_STREAM, 0));
+  if (fd.get() == -1 ||
+      connect(fd.get(), reinterpret_cast<sockaddr*>(&address),
+              sizeof(address)) != 0) {
+    LOG(ERROR) << "cannot connect to aidl server at " << socket_path << ": "
+               << strerror(errno);
+    return unique_fd();
+  }
+  return fd;
+}
+
+// Sends |request| to the server at |socket_path| and stores its answer to
+// |*response|.
+bool Transact(const string& socket_path, const vector<string>& request,
+              vector<string>* response) {
+  unique_fd fd = Connect(socket_path);
+  if (fd.get() == -1) {
+    return false;
+  }
+  if (!WriteMessage(fd.get(), request) || !ReadMessage(fd.get(), response) ||
+      response->size() != 2) {
+    LOG(ERROR) << "lost connection to aidl server at " << socket_path;
+    return false;
+  }
+  return true;
+}
+
+#endif  // _WIN32
+
+// Forwards everything to the server's IoDelegate, except that files are
+// written only if changed when the request asked for that.  The server's
+// delegate, and the archives it has read, outlive the request.
+class RequestIoDelegate : public IoDelegate {
+ public:
+  RequestIoDelegate(const IoDelegate& io_delegate, bool write_only_if_changed)
+      : io_delegate_(io_delegate),
+        write_only_if_changed_(write_only_if_changed) {}
+  virtual ~RequestIoDelegate() = default;
+
+  unique_ptr<string> GetFileContents(
+      const string& filename,
+      const string& content_suffix = "") const override {
+    return io_delegate_.GetFileContents(filename, content_suffix);
+  }
+  unique_ptr<SourceBuffer> GetSourceBuffer(
+      const string& filename) const override {
+    return io_delegate_.GetSourceBuffer(filename);
+  }
+  unique_ptr<LineReader> GetLineReader(const string& file_path) const override {
+    return io_delegate_.GetLineReader(file_path);
+  }
+  bool FileIsReadable(const string& path) const override {
+    return io_delegate_.FileIsReadable(path);
+  }
+  bool ListFiles(const string& dir, vector<string>* files) const override {
+    return io_delegate_.ListFiles(dir, files);
+  }
+  bool GetModificationTime(const string& path, int64_t* mtime) const override {
+    return io_delegate_.GetModificationTime(path, mtime);
+  }
+  bool GetFileSize(const string& path, int64_t* size) const override {
+    return io_delegate_.GetFileSize(path, size);
+  }
+  bool CreatedNestedDirs(
+      const string& base_dir,
+      const vector<string>& nested_subdirs) const override {
+    return io_delegate_.CreatedNestedDirs(base_dir, nested_subdirs);
+  }
+  unique_ptr<CodeWriter> GetCodeWriter(const string& file_path) const override {
+    if (write_only_if_changed_ && file_path != "-") {
+      return GetWriteIfChangedCodeWriter(file_path);
+    }
+    return io_delegate_.GetCodeWriter(file_path);
+  }
+  void RemovePath(const string& file_path) const override {
+    io_delegate_.RemovePath(file_path);
+  }
+  bool WriteFileAtomically(const string& path,
+                           const string& contents) const override {
+    return io_delegate_.WriteFileAtomically(path, contents);
+  }
+
+ private:
+  const IoDelegate& io_delegate_;
+  const bool write_only_if_changed_;
+
+  DISALLOW_COPY_AND_ASSIGN(RequestIoDelegate);
+};
+
+}  // namespace
+
+CompileServer::CompileServer()
+    : archive_io_delegate_(file_io_delegate_),
+      io_delegate_(archive_io_delegate_),
+      cache_(io_delegate_, true /* long_lived */) {}
+
+CompileServer::CompileServer(const IoDelegate& io_delegate)
+    : archive_io_delegate_(file_io_delegate_),
+      io_delegate_(io_delegate),
+      cache_(io_delegate_, true /* long_lived */) {}
+
+int CompileServer::Run(const vector<string>& args) {
+  vector<const char*> argv;
+  for (const string& arg : args) {
+    argv.push_back(arg.c_str());
+  }
+  argv.push_back(nullptr);
+  const int argc = args.size();
+
+  if (args.empty()) {
+    cerr << "aidl server: empty command line" << endl;
+    return 1;
+  }
+  if (EndsWith(args[0], "aidl-cpp")) {
+    unique_ptr<CppOptions> options = CppOptions::Parse(argc, argv.data());
+    if (!options) {
+      return 1;
+    }
+    if (options->IsClient()) {
+      cerr << "aidl server: requests cannot be forwarded again" << endl;
+      return 1;
+    }
+    RequestIoDelegate io_delegate(io_delegate_, options->WriteOnlyIfChanged());
+    return compile_aidl_to_cpp(*options, io_delegate, &cache_);
+  }
+  if (!EndsWith(args[0], "aidl")) {
+    cerr << "aidl server: cannot run " << args[0] << endl;
+    return 1;
+  }
+
+  unique_ptr<JavaOptions> options = JavaOptions::Parse(argc, argv.data());
+  if (!options) {
+    return 1;
+  }
+  RequestIoDelegate io_delegate(io_delegate_, options->write_only_if_changed_);
+  switch (options->task) {
+    case JavaOptions::COMPILE_AIDL_TO_JAVA:
+      return compile_aidl_to_java(*options, io_delegate, &cache_);
+    case JavaOptions::PREPROCESS_AIDL:
+      return preprocess_aidl(*options, io_delegate) ? 0 : 1;
+  }
+  cerr << "aidl server: only compiling and preprocessing are supported"
+       << endl;
+  return 1;
+}
+
+#ifndef _WIN32
+
+int CompileServer::Compile(const string& cwd, const vector<string>& args,
+                           string* output) {
+  output->clear();
+  unique_ptr<FILE, int (*)(FILE*)> capture(tmpfile(), fclose);
+  char original_cwd[4096];
+  if (!capture || getcwd(original_cwd, sizeof(original_cwd)) == nullptr) {
+    LOG(ERROR) << "aidl server cannot set up request: " << strerror(errno);
+    return 1;
+  }
+
+  // Send everything the compilation prints to |capture|.
+  cout.flush();
+  cerr.flush();
+  fflush(stdout);
+  fflush(stderr);
+  unique_fd saved_stdout(dup(STDOUT_FILENO));
+  unique_fd saved_stderr(dup(STDERR_FILENO));
+  dup2(fileno(capture.get()), STDOUT_FILENO);
+  dup2(fileno(capture.get()), STDERR_FILENO);
+
+  int ret = 1;
+  if (chdir(cwd.c_str()) != 0) {
+    cerr << "aidl server cannot change directory to " << cwd << ": "
+         << strerror(errno) << endl;
+  } else {
+    cache_.Revalidate();
+    ret = Run(args);
+  }
+
+  cout.flush();
+  cerr.flush();
+  fflush(stdout);
+  fflush(stderr);
+  dup2(saved_stdout.get(), STDOUT_FILENO);
+  dup2(saved_stderr.get(), STDERR_FILENO);
+  if (chdir(original_cwd) != 0) {
+    LOG(ERROR) << "aidl server cannot change directory back to "
+               << original_cwd;
+  }
+
+  lseek(fileno(capture.get()), 0, SEEK_SET);
+  ReadFdToString(fileno(capture.get()), output);
+  return ret;
+}
+
+bool CompileServer::Listen(const string& socket_path) {
+  sockaddr_un address;
+  if (!MakeAddress(socket_path, &address)) {
+    return false;
+  }
+  // A client hanging up must not take the server down with it.
+  signal(SIGPIPE, SIG_IGN);
+
+  unique_fd listen_fd(socket(AF_UNIX, SOCK_STREAM, 0));
+  unlink(socket_path.c_str());
+  if (listen_fd.get() == -1 ||
+      bind(listen_fd.get(), reinterpret_cast<sockaddr*>(&address),
+           sizeof(address)) != 0 ||
+      listen(listen_fd.get(), SOMAXCONN) != 0) {
+    LOG(ERROR) << "cannot listen on " << socket_path << ": "
+               << strerror(errno);
+    return false;
+  }
+  socket_path_ = socket_path;
+  listen_fd_ = std::move(listen_fd);
+  return true;
+}
+
+void CompileServer::Serve() {
+  bool stopping = false;
+  while (!stopping) {
+    unique_fd fd(accept(listen_fd_.get(), nullptr, nullptr));
+    if (fd.get() == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      LOG(ERROR) << "accept failed on " << socket_path_ << ": "
+                 << strerror(errno);
+      break;
+    }
+
+    vector<string> request;
+    if (!ReadMessage(fd.get(), &request) || request.empty()) {
+      LOG(ERROR) << "malformed request to aidl server";
+      continue;
+    }
+    vector<string> response(2);
+    if (request[0] == kStopRequest) {
+      response[0] = "0";
+      stopping = true;
+    } else if (request[0] == kCompileRequest && request.size() >= 2) {
+      const string cwd = request[1];
+      request.erase(request.begin(), request.begin() + 2);
+      response[0] = std::to_string(Compile(cwd, request, &response[1]));
+    } else {
+      LOG(ERROR) << "unknown request to aidl server: " << request[0];
+      continue;
+    }
+    WriteMessage(fd.get(), response);
+  }
+
+  listen_fd_.reset();
+  unlink(socket_path_.c_str());
+}
+
+int RunCompileClient(const string& socket_path, const vector<string>& args) {
+  char cwd[4096];
+  if (getcwd(cwd, sizeof(cwd)) == nullptr) {
+    LOG(ERROR) << "Path of current working directory does not fit in "
+               << sizeof(cwd) << " bytes";
+    return 1;
+  }
+  vector<string> request{kCompileRequest, cwd};
+  request.insert(request.end(), args.begin(), args.end());
+
+  vector<string> response;
+  int ret;
+  if (!Transact(socket_path, request, &response) ||
+      !ParseInt(response[0].c_str(), &ret)) {
+    return 1;
+  }
+  cerr << response[1];
+  return ret;
+}
+
+bool StopCompileServer(const string& socket_path) {
+  vector<string> response;
+  return Transact(socket_path, {kStopRequest}, &response);
+}
+
+#else  // _WIN32
+
+int CompileServer::Compile(const string& /* cwd */,
+                           const vector<string>& /* args */,
+                           string* /* output */) {
+  LOG(ERROR) << "the aidl server is not supported on Windows";
+  return 1;
+}
+
+bool CompileServer::Listen(const string& /* socket_path */) {
+  LOG(ERROR) << "the aidl server is not supported on Windows";
+  return false;
+}
+
+void CompileServer::Serve() {}
+
+int RunCompileClient(const string& /* socket_path */,
+                     const vector<string>& /* args */) {
+  LOG(ERROR) << "the aidl server is not supported on Windows";
+  return 1;
+}
+
+bool StopCompileServer(const string& /* socket_path */) {
+  LOG(ERROR) << "the aidl server is not supported on Windows";
+  return false;
+}
+
+#endif  // _WIN32
+
+}  // namespace aidl
+}  // namespace android
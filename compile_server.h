@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2018, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AIDL_COMPILE_SERVER_H_
+#define AIDL_COMPILE_SERVER_H_
+
+#include <string>
+#include <vector>
+
+#include <android-base/macros.h>
+#include <android-base/unique_fd.h>
+
+#include "aidl.h"
+#include "archive_io_delegate.h"
+#include "io_delegate.h"
+
+namespace android {
+namespace aidl {
+
+// Compiles requests sent by RunCompileClient() over a Unix domain socket,
+// keeping the built in types, preprocessed types and parsed imports in
+// memory between requests.  Imports are checked for changes at the start of
+// every request.  Options that change how files are written, such as
+// --write-if-changed, apply to the request that gives them.
+class CompileServer {
+ public:
+  // Compiles on the file system, reading archives given as -I@ARCHIVE.
+  CompileServer();
+  // Compiles on |io_delegate|.
+  explicit CompileServer(const IoDelegate& io_delegate);
+  ~CompileServer() = default;
+
+  // Starts listening on |socket_path|, replacing any stale socket there.
+  // Returns false if the socket cannot be set up.
+  bool Listen(const std::string& socket_path);
+  // Handles requests one at a time until a client asks the server to stop,
+  // or the socket fails.
+  void Serve();
+
+  // Runs the command line |args| in |cwd|, as aidl would if |args[0]| ends
+  // in "aidl", or as aidl-cpp would if it ends in "aidl-cpp".  Everything
+  // printed to stdout and stderr meanwhile is stored to |*output|.
+  // Returns the exit code of the command.
+  int Compile(const std::string& cwd, const std::vector<std::string>& args,
+              std::string* output);
+
+ private:
+  int Run(const std::vector<std::string>& args);
+
+  // What everything is read through, unless an IoDelegate was given.  Kept
+  // for the life of the server, so that archives are read only once.
+  IoDelegate file_io_delegate_;
+  ArchiveIoDelegate archive_io_delegate_;
+  const IoDelegate& io_delegate_;
+  CompileCache cache_;
+  std::string socket_path_;
+  android::base::unique_fd listen_fd_;
+
+  DISALLOW_COPY_AND_ASSIGN(CompileServer);
+};
+
+// Sends |args| and the current working directory to the server listening on
+// |socket_path|, and prints what the server printed while compiling them to
+// stderr.  Returns the exit code of the request, or 1 if the server cannot be
+// reached.
+int RunCompileClient(const std::string& socket_path,
+                     const std::vector<std::string>& args);
+
+// Asks the server listening on |socket_path| to stop.  Returns false if the
+// server cannot be reached.
+bool StopCompileServer(const std::string& socket_path);
+
+}  // namespace aidl
+}  // namespace android
+
+#endif  // AIDL_COMPILE_SERVER_H_
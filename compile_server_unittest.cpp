@@ -0,0 +1,252 @@
+/*
+ * Copyright (C) 2018, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utime.h>
+
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "compile_server.h"
+#include "tests/fake_io_delegate.h"
+#include "zip_file.h"
+
+using android::aidl::test::FakeIoDelegate;
+using std::string;
+using std::vector;
+
+namespace android {
+namespace aidl {
+
+TEST(CompileServerTest, ReusesImportsUntilTheyChange) {
+  FakeIoDelegate io_delegate;
+  io_delegate.SetFileContents("p/Bar.aidl",
+                              "package p; parcelable Bar cpp_header \"b.h\";");
+  io_delegate.SetFileContents(
+      "p/IFoo.aidl", "package p; import p.Bar; interface IFoo { Bar get(); }");
+  CompileServer server(io_delegate);
+  const vector<string> cpp_args{"aidl-cpp", "-I.", "p/IFoo.aidl", "out",
+                                "out/IFoo.cpp"};
+  const vector<string> java_args{"aidl", "-I.", "p/IFoo.aidl",
+                                 "out/IFoo.java"};
+
+  string output;
+  EXPECT_EQ(0, server.Compile(".", cpp_args, &output));
+  EXPECT_EQ("", output);
+  EXPECT_TRUE(io_delegate.GetWrittenContents("out/IFoo.cpp", nullptr));
+  EXPECT_EQ(0, server.Compile(".", java_args, &output));
+  EXPECT_TRUE(io_delegate.GetWrittenContents("out/IFoo.java", nullptr));
+
+  // The cached import is parsed again once it changes.
+  io_delegate.SetFileContents("p/Bar.aidl", "package p; parcelable Baz;");
+  EXPECT_NE(0, server.Compile(".", cpp_args, &output));
+  EXPECT_NE(string::npos, output.find("p/Bar.aidl")) << output;
+
+  io_delegate.SetFileContents("p/Bar.aidl",
+                              "package p; parcelable Bar cpp_header \"b.h\";");
+  EXPECT_EQ(0, server.Compile(".", cpp_args, &output));
+}
+
+TEST(CompileServerTest, ReloadsPreprocessedFilesOnlyOnceTheyChange) {
+  FakeIoDelegate io_delegate;
+  io_delegate.SetFileContents("sdk.txt", "parcelable p.Bar;\n");
+  io_delegate.SetFileContents(
+      "p/IFoo.aidl", "package p; import p.Bar; interface IFoo { Bar get(); }");
+  CompileServer server(io_delegate);
+  const vector<string> java_args{"aidl", "-psdk.txt", "p/IFoo.aidl",
+                                 "out/IFoo.java"};
+
+  string output;
+  EXPECT_EQ(0, server.Compile(".", java_args, &output)) << output;
+  EXPECT_EQ(0, server.Compile(".", java_args, &output)) << output;
+
+  io_delegate.SetFileContents("sdk.txt", "parcelable p.Baz;\n");
+  EXPECT_NE(0, server.Compile(".", java_args, &output));
+
+  io_delegate.SetFileContents("sdk.txt", "parcelable p.Bar;\n");
+  EXPECT_EQ(0, server.Compile(".", java_args, &output)) << output;
+}
+
+TEST(CompileServerTest, ReportsBadCommandLines) {
+  FakeIoDelegate io_delegate;
+  CompileServer server(io_delegate);
+  string output;
+  EXPECT_NE(0, server.Compile(".", {"aidl-cpp", "-Z"}, &output));
+  EXPECT_NE(string::npos, output.find("usage: aidl-cpp")) << output;
+  EXPECT_NE(0, server.Compile(".", {"aidl", "--server", "s"}, &output));
+  EXPECT_NE(0, server.Compile(".", {"cc"}, &output));
+  EXPECT_NE(0, server.Compile("/does/not/exist", {"aidl"}, &output));
+}
+
+TEST(CompileServerTest, ServesClientsOverASocket) {
+  char temp_dir[] = "/tmp/aidl_server_test.XXXXXX";
+  ASSERT_NE(nullptr, mkdtemp(temp_dir));
+  const string dir = temp_dir;
+  const string socket_path = dir + "/socket";
+  ASSERT_EQ(0, mkdir((dir + "/p").c_str(), 0700));
+  std::ofstream(dir + "/p/IFoo.aidl") << "package p; interface IFoo {}";
+
+  CompileServer server;
+  ASSERT_TRUE(server.Listen(socket_path));
+  std::thread server_thread(&CompileServer::Serve, &server);
+
+  char cwd[4096];
+  ASSERT_NE(nullptr, getcwd(cwd, sizeof(cwd)));
+  ASSERT_EQ(0, chdir(temp_dir));
+  EXPECT_EQ(0, RunCompileClient(socket_path,
+                                {"aidl", "p/IFoo.aidl", "IFoo.java"}));
+  EXPECT_NE(0, RunCompileClient(socket_path, {"aidl", "p/IMissing.aidl"}));
+  ASSERT_EQ(0, chdir(cwd));
+
+  EXPECT_TRUE(StopCompileServer(socket_path));
+  server_thread.join();
+  EXPECT_NE(0, access(socket_path.c_str(), F_OK));
+
+  std::ifstream generated(dir + "/IFoo.java");
+  EXPECT_TRUE(generated.good());
+  unlink((dir + "/IFoo.java").c_str());
+  unlink((dir + "/p/IFoo.aidl").c_str());
+  rmdir((dir + "/p").c_str());
+  rmdir(temp_dir);
+}
+
+TEST(CompileServerTest, TellsArchivesInDifferentDirectoriesApart) {
+  char temp_dir[] = "/tmp/aidl_server_test.XXXXXX";
+  ASSERT_NE(nullptr, mkdtemp(temp_dir));
+  const string dir = temp_dir;
+  // Both requests name "sdk.zip", relative to directories of their own.
+  for (const char* name : {"IBar", "IBaz"}) {
+    const string sub_dir = dir + "/" + name;
+    ASSERT_EQ(0, mkdir(sub_dir.c_str(), 0700));
+    ASSERT_EQ(0, mkdir((sub_dir + "/q").c_str(), 0700));
+    ZipWriter zip;
+    zip.AddFile(string("p/") + name + ".aidl",
+                string("package p; interface ") + name + " {}");
+    string archive;
+    ASSERT_TRUE(zip.Finish(&archive));
+    std::ofstream(sub_dir + "/sdk.zip", std::ios::binary) << archive;
+    std::ofstream(sub_dir + "/q/IFoo.aidl")
+        << "package q; import p." << name << "; interface IFoo { " << name
+        << " get(); }";
+  }
+
+  CompileServer server;
+  string output;
+  for (const char* name : {"IBar", "IBaz"}) {
+    EXPECT_EQ(0, server.Compile(dir + "/" + name,
+                                {"aidl", "--index-import-roots", "-I@sdk.zip",
+                                 "q/IFoo.aidl", "IFoo.java"},
+                                &output)) << output;
+  }
+
+  for (const char* name : {"IBar", "IBaz"}) {
+    const string sub_dir = dir + "/" + name;
+    unlink((sub_dir + "/IFoo.java").c_str());
+    unlink((sub_dir + "/q/IFoo.aidl").c_str());
+    unlink((sub_dir + "/sdk.zip").c_str());
+    rmdir((sub_dir + "/q").c_str());
+    rmdir(sub_dir.c_str());
+  }
+  rmdir(temp_dir);
+}
+
+TEST(CompileServerTest, ReadsArchivesOnceForAllRequests) {
+  char temp_dir[] = "/tmp/aidl_server_test.XXXXXX";
+  ASSERT_NE(nullptr, mkdtemp(temp_dir));
+  const string dir = temp_dir;
+  const string archive_path = dir + "/sdk.zip";
+  ASSERT_EQ(0, mkdir((dir + "/q").c_str(), 0700));
+  ZipWriter zip;
+  zip.AddFile("p/IBar.aidl", "package p; interface IBar {}");
+  string archive;
+  ASSERT_TRUE(zip.Finish(&archive));
+  std::ofstream(archive_path, std::ios::binary) << archive;
+  std::ofstream(dir + "/q/IFoo.aidl")
+      << "package q; import p.IBar; interface IFoo { IBar get(); }";
+  const vector<string> args{"aidl", "-I@sdk.zip", "q/IFoo.aidl",
+                            "IFoo.java"};
+
+  CompileServer server;
+  string output;
+  EXPECT_EQ(0, server.Compile(dir, args, &output)) << output;
+  // Spoil the archive without changing its modification time.  Requests
+  // that write only changed files still read the archive read before.
+  struct stat info;
+  ASSERT_EQ(0, stat(archive_path.c_str(), &info));
+  std::ofstream(archive_path, std::ios::binary) << "not an archive";
+  const utimbuf times{info.st_atime, info.st_mtime};
+  ASSERT_EQ(0, utime(archive_path.c_str(), &times));
+  vector<string> write_if_changed_args = args;
+  write_if_changed_args.insert(write_if_changed_args.begin() + 1,
+                               "--write-if-changed");
+  EXPECT_EQ(0, server.Compile(dir, write_if_changed_args, &output))
+      << output;
+  EXPECT_EQ(0, server.Compile(dir, args, &output)) << output;
+
+  unlink((dir + "/IFoo.java").c_str());
+  unlink((dir + "/q/IFoo.aidl").c_str());
+  unlink(archive_path.c_str());
+  rmdir((dir + "/q").c_str());
+  rmdir(temp_dir);
+}
+
+TEST(CompileServerTest, WritesOnlyChangedFilesForRequestsThatAskForIt) {
+  char temp_dir[] = "/tmp/aidl_server_test.XXXXXX";
+  ASSERT_NE(nullptr, mkdtemp(temp_dir));
+  const string dir = temp_dir;
+  const string output_path = dir + "/IFoo.java";
+  ASSERT_EQ(0, mkdir((dir + "/p").c_str(), 0700));
+  std::ofstream(dir + "/p/IFoo.aidl") << "package p; interface IFoo {}";
+
+  CompileServer server;
+  string output;
+  ASSERT_EQ(0, server.Compile(dir, {"aidl", "p/IFoo.aidl", "IFoo.java"},
+                              &output)) << output;
+  // Back date the output, so that any write shows in its modification time.
+  const utimbuf old_times{1000, 1000};
+  ASSERT_EQ(0, utime(output_path.c_str(), &old_times));
+  struct stat before;
+  ASSERT_EQ(0, stat(output_path.c_str(), &before));
+
+  ASSERT_EQ(0, server.Compile(dir,
+                              {"aidl", "--write-if-changed", "p/IFoo.aidl",
+                               "IFoo.java"},
+                              &output)) << output;
+  struct stat after;
+  ASSERT_EQ(0, stat(output_path.c_str(), &after));
+  EXPECT_EQ(before.st_ino, after.st_ino);
+  EXPECT_EQ(1000, after.st_mtime);
+
+  // The next request writes the unchanged file again.
+  ASSERT_EQ(0, server.Compile(dir, {"aidl", "p/IFoo.aidl", "IFoo.java"},
+                              &output)) << output;
+  ASSERT_EQ(0, stat(output_path.c_str(), &after));
+  EXPECT_NE(1000, after.st_mtime);
+
+  unlink(output_path.c_str());
+  unlink((dir + "/p/IFoo.aidl").c_str());
+  rmdir((dir + "/p").c_str());
+  rmdir(temp_dir);
+}
+
+}  // namespace aidl
+}  // namespace android
@@ -16,6 +16,7 @@
 
 #include "generate_cpp.h"
 
+#include <algorithm>
 #include <cctype>
 #include <cstring>
 #include <memory>
@@ -23,6 +24,7 @@
 #include <set>
 #include <string>
 
+#include <android-base/macros.h>
 #include <android-base/stringprintf.h>
 
 #include "aidl_language.h"
@@ -30,6 +32,9 @@
 #include "code_writer.h"
 #include "logging.h"
 #include "os.h"
+#include "thread_pool.h"
+#include "timings.h"
+#include "trace.h"
 
 using android::base::StringPrintf;
 using std::string;
@@ -396,6 +401,7 @@ unique_ptr<Declaration> DefineClientTransaction(const TypeNamespace& types,
 
 unique_ptr<Document> BuildClientSource(const TypeNamespace& types,
                                        const AidlInterface& interface) {
+  TraceSpan span("BuildClientSource");
   vector<string> include_list = {
       HeaderFile(interface, ClassNames::CLIENT, false),
       kParcelHeader
@@ -546,6 +552,7 @@ bool HandleServerTransaction(const TypeNamespace& types,
 
 unique_ptr<Document> BuildServerSource(const TypeNamespace& types,
                                        const AidlInterface& interface) {
+  TraceSpan span("BuildServerSource");
   const string bn_name = ClassName(interface, ClassNames::SERVER);
   vector<string> include_list{
       HeaderFile(interface, ClassNames::SERVER, false),
@@ -608,6 +615,7 @@ unique_ptr<Document> BuildServerSource(const TypeNamespace& types,
 
 unique_ptr<Document> BuildInterfaceSource(const TypeNamespace& /* types */,
                                           const AidlInterface& interface) {
+  TraceSpan span("BuildInterfaceSource");
   vector<string> include_list{
       HeaderFile(interface, ClassNames::INTERFACE, false),
       HeaderFile(interface, ClassNames::CLIENT, false),
@@ -646,6 +654,7 @@ unique_ptr<Document> BuildInterfaceSource(const TypeNamespace& /* types */,
 
 unique_ptr<Document> BuildClientHeader(const TypeNamespace& types,
                                        const AidlInterface& interface) {
+  TraceSpan span("BuildClientHeader");
   const string i_name = ClassName(interface, ClassNames::INTERFACE);
   const string bp_name = ClassName(interface, ClassNames::CLIENT);
 
@@ -686,6 +695,7 @@ unique_ptr<Document> BuildClientHeader(const TypeNamespace& types,
 
 unique_ptr<Document> BuildServerHeader(const TypeNamespace& /* types */,
                                        const AidlInterface& interface) {
+  TraceSpan span("BuildServerHeader");
   const string i_name = ClassName(interface, ClassNames::INTERFACE);
   const string bn_name = ClassName(interface, ClassNames::SERVER);
 
@@ -718,6 +728,7 @@ unique_ptr<Document> BuildServerHeader(const TypeNamespace& /* types */,
 
 unique_ptr<Document> BuildInterfaceHeader(const TypeNamespace& types,
                                           const AidlInterface& interface) {
+  TraceSpan span("BuildInterfaceHeader");
   set<string> includes = { kIBinderHeader, kIInterfaceHeader,
                            kStatusHeader, kStrongPointerHeader };
 
@@ -781,38 +792,15 @@ unique_ptr<Document> BuildInterfaceHeader(const TypeNamespace& types,
       NestInNamespaces(std::move(if_class), interface.GetSplitPackage())}};
 }
 
-bool WriteHeader(const CppOptions& options,
-                 const TypeNamespace& types,
-                 const AidlInterface& interface,
-                 const IoDelegate& io_delegate,
-                 ClassNames header_type) {
-  unique_ptr<Document> header;
-  switch (header_type) {
-    case ClassNames::INTERFACE:
-      header = BuildInterfaceHeader(types, interface);
-      break;
-    case ClassNames::CLIENT:
-      header = BuildClientHeader(types, interface);
-      break;
-    case ClassNames::SERVER:
-      header = BuildServerHeader(types, interface);
-      break;
-    default:
-      LOG(FATAL) << "aidl internal error";
-  }
-  if (!header) {
-    LOG(ERROR) << "aidl internal error: Failed to generate header.";
-    return false;
-  }
+bool WriteFile(const IoDelegate& io_delegate,
+               const string& path,
+               const string& contents) {
+  unique_ptr<CodeWriter> writer(io_delegate.GetCodeWriter(path));
+  writer->Append(contents);
 
-  const string header_path = options.OutputHeaderDir() + OS_PATH_SEPARATOR +
-                             HeaderFile(interface, header_type);
-  unique_ptr<CodeWriter> code_writer(io_delegate.GetCodeWriter(header_path));
-  header->Write(code_writer.get());
-
-  const bool success = code_writer->Close();
+  const bool success = writer->Close();
   if (!success) {
-    io_delegate.RemovePath(header_path);
+    io_delegate.RemovePath(path);
   }
 
   return success;
@@ -843,42 +831,84 @@ string HeaderFile(const AidlInterface& interface,
 bool GenerateCpp(const CppOptions& options,
                  const TypeNamespace& types,
                  const AidlInterface& interface,
-                 const IoDelegate& io_delegate) {
-  auto interface_src = BuildInterfaceSource(types, interface);
-  auto client_src = BuildClientSource(types, interface);
-  auto server_src = BuildServerSource(types, interface);
+                 const IoDelegate& io_delegate,
+                 size_t num_threads) {
+  using DocumentBuilder = unique_ptr<Document> (*)(const TypeNamespace&,
+                                                   const AidlInterface&);
+  // Headers first, then the three parts of the source file in the order they
+  // are concatenated.
+  const DocumentBuilder kBuilders[] = {
+      BuildInterfaceHeader, BuildClientHeader, BuildServerHeader,
+      BuildInterfaceSource, BuildClientSource, BuildServerSource,
+  };
+  const ClassNames kHeaders[] = {
+      ClassNames::INTERFACE, ClassNames::CLIENT, ClassNames::SERVER,
+  };
+  constexpr size_t kNumDocuments = arraysize(kBuilders);
+  constexpr size_t kNumHeaders = arraysize(kHeaders);
+
+  // The documents only read |types| and |interface|, so they are built and
+  // written out to memory side by side.  The files themselves are written
+  // afterwards, one at a time.
+  PhaseTimer build_timer(Phase::BUILD_AST);
+  string contents[kNumDocuments];
+  bool built[kNumDocuments] = {};
+  auto emit = [&](size_t i) {
+    unique_ptr<Document> document = kBuilders[i](types, interface);
+    if (document) {
+      document->Write(GetStringWriter(&contents[i]).get());
+      built[i] = true;
+    }
+  };
+  if (ThreadPool::OnWorkerThread()) {
+    num_threads = 1;
+  }
+  num_threads = std::min(kNumDocuments, num_threads);
+  if (num_threads <= 1) {
+    for (size_t i = 0; i < kNumDocuments; ++i) {
+      emit(i);
+    }
+  } else {
+    ThreadPool pool(num_threads);
+    for (size_t i = 0; i < kNumDocuments; ++i) {
+      pool.Post([&emit, i]() { emit(i); });
+    }
+    pool.Wait();
+  }
 
-  if (!interface_src || !client_src || !server_src) {
-    return false;
+  build_timer.Stop();
+
+  for (size_t i = kNumHeaders; i < kNumDocuments; ++i) {
+    if (!built[i]) {
+      return false;
+    }
   }
 
+  PhaseTimer write_timer(Phase::WRITE_OUTPUT);
   if (!io_delegate.CreatedNestedDirs(options.OutputHeaderDir(),
                                      interface.GetSplitPackage())) {
     LOG(ERROR) << "Failed to create directory structure for headers.";
     return false;
   }
 
-  if (!WriteHeader(options, types, interface, io_delegate,
-                   ClassNames::INTERFACE) ||
-      !WriteHeader(options, types, interface, io_delegate,
-                   ClassNames::CLIENT) ||
-      !WriteHeader(options, types, interface, io_delegate,
-                   ClassNames::SERVER)) {
-    return false;
+  for (size_t i = 0; i < kNumHeaders; ++i) {
+    if (!built[i]) {
+      LOG(ERROR) << "aidl internal error: Failed to generate header.";
+      return false;
+    }
+    const string header_path = options.OutputHeaderDir() +
+                               OS_PATH_SEPARATOR +
+                               HeaderFile(interface, kHeaders[i]);
+    if (!WriteFile(io_delegate, header_path, contents[i])) {
+      return false;
+    }
   }
 
-  unique_ptr<CodeWriter> writer = io_delegate.GetCodeWriter(
-      options.OutputCppFilePath());
-  interface_src->Write(writer.get());
-  client_src->Write(writer.get());
-  server_src->Write(writer.get());
-
-  const bool success = writer->Close();
-  if (!success) {
-    io_delegate.RemovePath(options.OutputCppFilePath());
+  string source;
+  for (size_t i = kNumHeaders; i < kNumDocuments; ++i) {
+    source += contents[i];
   }
-
-  return success;
+  return WriteFile(io_delegate, options.OutputCppFilePath(), source);
 }
 
 }  // namespace cpp
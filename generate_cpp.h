@@ -29,10 +29,13 @@ namespace android {
 namespace aidl {
 namespace cpp {
 
+// Builds the headers and the source of |parsed_doc| on up to |num_threads|
+// threads, or on the calling thread alone if it is a ThreadPool worker.
 bool GenerateCpp(const CppOptions& options,
                  const cpp::TypeNamespace& types,
                  const AidlInterface& parsed_doc,
-                 const IoDelegate& io_delegate);
+                 const IoDelegate& io_delegate,
+                 size_t num_threads = 1);
 
 // These roughly correspond to the various class names in the C++ hierarchy:
 enum class ClassNames {
@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2018, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <memory>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "aidl.h"
+#include "ast_cpp.h"
+#include "generate_cpp.h"
+#include "tests/benchmark_util.h"
+#include "tests/fake_io_delegate.h"
+#include "type_cpp.h"
+
+using android::aidl::test::AddBenchmarkInterface;
+using android::aidl::test::FakeIoDelegate;
+using android::aidl::test::GetInputSize;
+using android::aidl::test::InputSizes;
+using android::aidl::test::kBenchmarkInterface;
+using std::unique_ptr;
+using std::vector;
+
+namespace android {
+namespace aidl {
+namespace cpp {
+namespace {
+
+using BuildFunction = unique_ptr<Document> (*)(const TypeNamespace&,
+                                                const AidlInterface&);
+
+// Builds one of the generated C++ files for the benchmark interface, which is
+// loaded once up front so that only generation is measured.
+void Build(benchmark::State& state, BuildFunction build) {
+  FakeIoDelegate io_delegate;
+  AddBenchmarkInterface(GetInputSize(state), &io_delegate);
+  TypeNamespace types;
+  types.Init();
+  unique_ptr<AidlInterface> interface;
+  vector<unique_ptr<AidlImport>> imports;
+  if (::android::aidl::internals::load_and_validate_aidl(
+          {}, {"."}, kBenchmarkInterface, false, io_delegate, &types,
+          &interface, &imports) != AidlError::OK) {
+    state.SkipWithError("cannot load interface");
+    return;
+  }
+  while (state.KeepRunning()) {
+    benchmark::DoNotOptimize(build(types, *interface));
+  }
+}
+
+void BM_BuildClientSource(benchmark::State& state) {
+  Build(state, internals::BuildClientSource);
+}
+BENCHMARK(BM_BuildClientSource)->Apply(InputSizes);
+
+void BM_BuildServerSource(benchmark::State& state) {
+  Build(state, internals::BuildServerSource);
+}
+BENCHMARK(BM_BuildServerSource)->Apply(InputSizes);
+
+void BM_BuildInterfaceSource(benchmark::State& state) {
+  Build(state, internals::BuildInterfaceSource);
+}
+BENCHMARK(BM_BuildInterfaceSource)->Apply(InputSizes);
+
+void BM_BuildClientHeader(benchmark::State& state) {
+  Build(state, internals::BuildClientHeader);
+}
+BENCHMARK(BM_BuildClientHeader)->Apply(InputSizes);
+
+void BM_BuildServerHeader(benchmark::State& state) {
+  Build(state, internals::BuildServerHeader);
+}
+BENCHMARK(BM_BuildServerHeader)->Apply(InputSizes);
+
+void BM_BuildInterfaceHeader(benchmark::State& state) {
+  Build(state, internals::BuildInterfaceHeader);
+}
+BENCHMARK(BM_BuildInterfaceHeader)->Apply(InputSizes);
+
+}  // namespace
+}  // namespace cpp
+}  // namespace aidl
+}  // namespace android
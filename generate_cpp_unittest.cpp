@@ -1432,6 +1432,28 @@ TEST_F(IoErrorHandlingTest, GenerateCorrectlyAbsentErrors) {
   ASSERT_TRUE(GenerateCpp(*options_, types_, *interface, io_delegate_));
 }
 
+TEST_F(IoErrorHandlingTest, GeneratesTheSameFilesOnSeveralThreads) {
+  using namespace test_io_handling;
+  const unique_ptr<AidlInterface> interface = Parse();
+  ASSERT_NE(interface, nullptr);
+  const string header_path =
+      StringPrintf("%s%c%s", kHeaderDir, OS_PATH_SEPARATOR,
+                   kInterfaceHeaderRelPath);
+
+  ASSERT_TRUE(GenerateCpp(*options_, types_, *interface, io_delegate_));
+  string header;
+  string source;
+  ASSERT_TRUE(io_delegate_.GetWrittenContents(header_path, &header));
+  ASSERT_TRUE(io_delegate_.GetWrittenContents(kOutputPath, &source));
+
+  ASSERT_TRUE(GenerateCpp(*options_, types_, *interface, io_delegate_, 6));
+  string contents;
+  ASSERT_TRUE(io_delegate_.GetWrittenContents(header_path, &contents));
+  EXPECT_EQ(header, contents);
+  ASSERT_TRUE(io_delegate_.GetWrittenContents(kOutputPath, &contents));
+  EXPECT_EQ(source, contents);
+}
+
 TEST_F(IoErrorHandlingTest, HandlesBadHeaderWrite) {
   using namespace test_io_handling;
   const unique_ptr<AidlInterface> interface = Parse();
@@ -24,6 +24,7 @@
 #include <android-base/stringprintf.h>
 
 #include "code_writer.h"
+#include "timings.h"
 #include "type_java.h"
 
 using std::unique_ptr;
@@ -57,14 +58,19 @@ namespace java {
 int generate_java(const string& filename, const string& originalSrc,
                   AidlInterface* iface, JavaTypeNamespace* types,
                   const IoDelegate& io_delegate, const JavaOptions& options) {
+  // Every node of the generated tree lives until the document is written.
+  AstArena arena;
+  PhaseTimer build_timer(Phase::BUILD_AST);
   Class* cl = generate_binder_interface_class(iface, types, options);
 
-  Document* document = new Document(
+  unique_ptr<Document> document(new Document(
       "" /* no comment */,
       iface->GetPackage(),
       originalSrc,
-      unique_ptr<Class>(cl));
+      unique_ptr<Class>(cl)));
+  build_timer.Stop();
 
+  PhaseTimer write_timer(Phase::WRITE_OUTPUT);
   CodeWriterPtr code_writer = io_delegate.GetCodeWriter(filename);
   document->Write(code_writer.get());
 
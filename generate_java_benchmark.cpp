@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2018, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <memory>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "aidl.h"
+#include "ast_java.h"
+#include "generate_java.h"
+#include "options.h"
+#include "tests/benchmark_util.h"
+#include "tests/fake_io_delegate.h"
+#include "type_java.h"
+
+using android::aidl::test::AddBenchmarkInterface;
+using android::aidl::test::FakeIoDelegate;
+using android::aidl::test::GetInputSize;
+using android::aidl::test::InputSizes;
+using android::aidl::test::kBenchmarkInterface;
+using std::unique_ptr;
+using std::vector;
+
+namespace android {
+namespace aidl {
+namespace java {
+namespace {
+
+// Builds the Java class for the benchmark interface, which is loaded once up
+// front so that only generation is measured.
+void BM_GenerateBinderInterfaceClass(benchmark::State& state) {
+  FakeIoDelegate io_delegate;
+  AddBenchmarkInterface(GetInputSize(state), &io_delegate);
+  const char* argv[] = {"aidl", kBenchmarkInterface};
+  unique_ptr<JavaOptions> options = JavaOptions::Parse(2, argv);
+  JavaTypeNamespace types;
+  types.Init();
+  unique_ptr<AidlInterface> interface;
+  vector<unique_ptr<AidlImport>> imports;
+  if (!options ||
+      ::android::aidl::internals::load_and_validate_aidl(
+          {}, {"."}, kBenchmarkInterface, false, io_delegate, &types,
+          &interface, &imports) != AidlError::OK) {
+    state.SkipWithError("cannot load interface");
+    return;
+  }
+  while (state.KeepRunning()) {
+    // The arena frees the tree built in each iteration.
+    AstArena arena;
+    benchmark::DoNotOptimize(
+        generate_binder_interface_class(interface.get(), &types, *options));
+  }
+}
+BENCHMARK(BM_GenerateBinderInterfaceClass)->Apply(InputSizes);
+
+}  // namespace
+}  // namespace java
+}  // namespace aidl
+}  // namespace android
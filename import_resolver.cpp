@@ -16,27 +16,101 @@
 
 #include "import_resolver.h"
 
+#include <ctype.h>
 #include <unistd.h>
 
 #ifdef _WIN32
 #include <io.h>
 #endif
 
+#include <android-base/strings.h>
+
+#include "archive_io_delegate.h"
 #include "os.h"
+#include "trace.h"
 
+using android::base::EndsWith;
 using std::string;
+using std::unique_ptr;
 using std::vector;
 
 namespace android {
 namespace aidl {
+namespace {
+
+// Files are looked up case-insensitively where the file system usually is.
+string NormalizeCase(const string& path) {
+#if defined(__linux__)
+  return path;
+#else
+  string normalized = path;
+  for (char& c : normalized) {
+    c = tolower(static_cast<unsigned char>(c));
+  }
+  return normalized;
+#endif
+}
+
+}  // namespace
+
+ImportRootIndex::ImportRootIndex(const IoDelegate& io_delegate)
+    : io_delegate_(io_delegate) {}
+
+bool ImportRootIndex::Contains(const string& root,
+                               const string& relative_path) {
+  // Relative roots name different directories once the working directory
+  // changes.
+  string key;
+  if (!IoDelegate::GetAbsolutePath(root, &key)) {
+    key = root;
+  }
+
+  Root* entry;
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    std::unique_ptr<Root>& slot = roots_[key];
+    if (!slot) {
+      slot.reset(new Root);
+    }
+    entry = slot.get();
+  }
+
+  std::lock_guard<std::mutex> guard(entry->lock);
+  if (!entry->listed) {
+    entry->listed = true;
+    vector<string> files;
+    io_delegate_.ListFiles(root, &files);
+    for (string& file : files) {
+      if (EndsWith(file, ".aidl")) {
+        entry->files.insert(NormalizeCase(file));
+      }
+    }
+  }
+  return entry->files.count(NormalizeCase(relative_path)) > 0;
+}
+
+void ImportRootIndex::Clear() {
+  std::lock_guard<std::mutex> guard(lock_);
+  roots_.clear();
+}
 
 ImportResolver::ImportResolver(const IoDelegate& io_delegate,
-                               const vector<string>& import_paths)
-    : io_delegate_(io_delegate) {
+                               const vector<string>& import_paths,
+                               ImportRootIndex* index)
+    : io_delegate_(io_delegate),
+      index_(index) {
   for (string path : import_paths) {
     if (path.empty()) {
       path = ".";
     }
+    if (path[0] == kArchivePrefix &&
+        path.find(kArchiveEntrySeparator) == string::npos) {
+      // The whole archive is the root.
+      while (path.size() > 1 && path.back() == OS_PATH_SEPARATOR) {
+        path.pop_back();
+      }
+      path += kArchiveEntrySeparator;
+    }
     if (path[path.size() - 1] != OS_PATH_SEPARATOR) {
       path += OS_PATH_SEPARATOR;
     }
@@ -46,6 +120,12 @@ ImportResolver::ImportResolver(const IoDelegate& io_delegate,
 
 
 string ImportResolver::FindImportFile(const string& canonical_name) const {
+  TraceSpan span("FindImportFile", canonical_name);
+  const auto found = found_.find(canonical_name);
+  if (found != found_.end()) {
+    return found->second;
+  }
+
   // Convert the canonical name to a relative file path.
   string relative_path = canonical_name;
   for (char& c : relative_path) {
@@ -56,14 +136,73 @@ string ImportResolver::FindImportFile(const string& canonical_name) const {
   relative_path += ".aidl";
 
   // Look for that relative path at each of our import roots.
-  for (string path : import_paths_) {
-    path = path + relative_path;
-    if (io_delegate_.FileIsReadable(path)) {
-      return path;
+  string& ret = found_[canonical_name];
+  for (const string& root : import_paths_) {
+    if (index_ ? index_->Contains(root, relative_path)
+               : io_delegate_.FileIsReadable(root + relative_path)) {
+      ret = root + relative_path;
+      break;
+    }
+  }
+  return ret;
+}
+
+ImportCache::ImportCache(const IoDelegate& io_delegate)
+    : io_delegate_(io_delegate),
+      root_index_(io_delegate) {}
+
+const AidlDocument* ImportCache::GetDocument(const string& path) {
+  // Relative paths name different files once the working directory changes.
+  string key;
+  if (!IoDelegate::GetAbsolutePath(path, &key)) {
+    key = path;
+  }
+
+  Entry* entry;
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    std::unique_ptr<Entry>& slot = entries_[key];
+    if (!slot) {
+      slot.reset(new Entry);
     }
+    entry = slot.get();
   }
 
-  return "";
+  std::lock_guard<std::mutex> guard(entry->lock);
+  if (entry->document && entry->needs_check) {
+    entry->needs_check = false;
+    if (!entry->state.IsUnchanged(io_delegate_, path)) {
+      entry->document.reset();
+    }
+  }
+  if (!entry->document) {
+    Parse(path, entry);
+  }
+  return entry->document.get();
+}
+
+void ImportCache::Revalidate() {
+  root_index_.Clear();
+  std::lock_guard<std::mutex> guard(lock_);
+  for (auto& it : entries_) {
+    it.second->needs_check = true;
+  }
+}
+
+void ImportCache::Parse(const string& path, Entry* entry) {
+  // Only the declarations of imports are used.
+  Parser p{io_delegate_, ast_cache_};
+  entry->state = FileState();
+  entry->state.Record(io_delegate_, path);
+  unique_ptr<string> contents = io_delegate_.GetFileContents(path);
+  if (contents) {
+    // The contents hashed are the contents parsed.
+    entry->state.SetContents(contents->data(), contents->size());
+  }
+  // ParseFile() reports files that cannot be read.
+  if (contents ? p.SkimFile(path, *contents) : p.ParseFile(path)) {
+    entry->document.reset(p.ReleaseDocument());
+  }
 }
 
 }  // namespace android
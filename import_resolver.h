@@ -17,33 +17,134 @@
 #ifndef AIDL_IMPORT_RESOLVER_H_
 #define AIDL_IMPORT_RESOLVER_H_
 
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_set>
 #include <vector>
 
 #include <android-base/macros.h>
 
+#include "aidl_language.h"
+#include "ast_cache.h"
 #include "io_delegate.h"
 
 namespace android {
 namespace aidl {
 
+// The .aidl files under import roots.  Each root is listed once, on first
+// use, so that resolving an import against it costs no system calls.  Safe to
+// use from several threads.
+class ImportRootIndex {
+ public:
+  explicit ImportRootIndex(const IoDelegate& io_delegate);
+  ~ImportRootIndex() = default;
+
+  // Returns true if |relative_path| names an .aidl file under |root|.
+  bool Contains(const std::string& root, const std::string& relative_path);
+
+  // Makes every root be listed again on its next use.  Must not be called
+  // concurrently with Contains().
+  void Clear();
+
+ private:
+  struct Root {
+    // Held while listing, so other threads wait for the result.
+    std::mutex lock;
+    bool listed = false;
+    std::unordered_set<std::string> files;
+  };
+
+  const IoDelegate& io_delegate_;
+  // Guards |roots_|, but not the roots themselves.
+  std::mutex lock_;
+  std::map<std::string, std::unique_ptr<Root>> roots_;
+
+  DISALLOW_COPY_AND_ASSIGN(ImportRootIndex);
+};
+
 class ImportResolver {
  public:
+  // If |index| is given, import roots are looked up in it rather than
+  // probed for each import.  Import paths of the form "@ARCHIVE" name the
+  // files in that archive, for |io_delegate| to read; see ArchiveIoDelegate.
   ImportResolver(const IoDelegate& io_delegate,
-                 const std::vector<std::string>& import_paths);
-  virtual ~ImportResolver() = default;
+                 const std::vector<std::string>& import_paths,
+                 ImportRootIndex* index = nullptr);
+  ~ImportResolver() = default;
 
   // Resolve the canonical name for a class to a file that exists
-  // in one of the import paths given to the ImportResolver.
+  // in one of the import paths given to the ImportResolver.  Results,
+  // including failures, are remembered, so this is not safe to call from
+  // several threads.
   std::string FindImportFile(const std::string& canonical_name) const;
 
  private:
   const IoDelegate& io_delegate_;
   std::vector<std::string> import_paths_;
+  ImportRootIndex* index_;
+  mutable std::map<std::string, std::string> found_;
 
   DISALLOW_COPY_AND_ASSIGN(ImportResolver);
 };
 
+// Documents parsed from import files, shared between compilations so that
+// each import file is parsed at most once.  Safe to use from several threads.
+class ImportCache {
+ public:
+  explicit ImportCache(const IoDelegate& io_delegate);
+  ~ImportCache() = default;
+
+  // Returns the document parsed from |path|, parsing it on first use.
+  // Returns nullptr if |path| fails to parse; it will be parsed again (and
+  // report its errors again) on the next call.  The cache keeps ownership of
+  // the document, which must not be modified.
+  const AidlDocument* GetDocument(const std::string& path);
+
+  // Makes the next GetDocument() for each cached file check whether the
+  // modification time or the contents of the file changed since it was
+  // parsed, and parse it again if so, and makes import roots be listed
+  // again.  Documents returned before must not be used after this is called.
+  // Must not be called concurrently with GetDocument().
+  void Revalidate();
+
+  // Makes GetRootIndex() return an index of the import roots, or nullptr if
+  // |enabled| is false.  Must not be called concurrently with GetDocument().
+  void SetIndexImportRoots(bool enabled) { index_enabled_ = enabled; }
+  ImportRootIndex* GetRootIndex() {
+    return index_enabled_ ? &root_index_ : nullptr;
+  }
+
+  // Makes imports be loaded from and stored to |ast_cache|, which may be
+  // nullptr.  Must not be called concurrently with GetDocument().
+  void SetAstCache(const AstCache* ast_cache) { ast_cache_ = ast_cache; }
+  const AstCache* GetAstCache() const { return ast_cache_; }
+
+ private:
+  struct Entry {
+    // Held while parsing, so other threads wait for the result.
+    std::mutex lock;
+    std::unique_ptr<AidlDocument> document;
+    // What the file looked like when |document| was parsed.
+    FileState state;
+    bool needs_check = false;
+  };
+
+  // Parses |path| into |entry|, remembering the state of the file.
+  void Parse(const std::string& path, Entry* entry);
+
+  const IoDelegate& io_delegate_;
+  const AstCache* ast_cache_ = nullptr;
+  ImportRootIndex root_index_;
+  bool index_enabled_ = false;
+  // Guards |entries_|, but not the entries themselves.
+  std::mutex lock_;
+  std::map<std::string, std::unique_ptr<Entry>> entries_;
+
+  DISALLOW_COPY_AND_ASSIGN(ImportCache);
+};
+
 }  // namespace android
 }  // namespace aidl
 
@@ -16,17 +16,28 @@
 
 #include "io_delegate.h"
 
+#include <atomic>
+#include <cstdarg>
+#include <cstdio>
 #include <cstring>
+#include <ctime>
 #include <fstream>
+#include <set>
+#include <utility>
 #include <vector>
 
+#include <sys/stat.h>
+
 #ifdef _WIN32
 #include <direct.h>
 #else
-#include <sys/stat.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
 #include <unistd.h>
 #endif
 
+#include <android-base/stringprintf.h>
 #include <android-base/strings.h>
 
 #include "logging.h"
@@ -37,9 +48,191 @@ using std::unique_ptr;
 using std::vector;
 
 using android::base::Split;
+using android::base::StringAppendV;
+using android::base::StringPrintf;
 
 namespace android {
 namespace aidl {
+namespace {
+
+// The coarsest modification time resolution of common file systems, in
+// seconds.
+const int64_t kTimestampResolution = 2;
+
+string JoinPath(const string& dir, const string& name) {
+  if (dir.empty() || dir.back() == OS_PATH_SEPARATOR) {
+    return dir + name;
+  }
+  return dir + OS_PATH_SEPARATOR + name;
+}
+
+#ifdef _WIN32
+
+// Appends the files under |dir|/|prefix| to |*files|, prefixed by |prefix|.
+// Reparse points are not followed, so junctions cannot make this loop.
+bool ListFilesRecursively(const string& dir, const string& prefix,
+                          vector<string>* files) {
+  WIN32_FIND_DATAA data;
+  HANDLE find = FindFirstFileA(JoinPath(JoinPath(dir, prefix), "*").c_str(),
+                               &data);
+  if (find == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+  do {
+    const string name = data.cFileName;
+    if (name == "." || name == "..") {
+      continue;
+    }
+    const string child = JoinPath(prefix, name);
+    if (data.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) {
+      continue;
+    }
+    if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+      ListFilesRecursively(dir, child, files);
+    } else {
+      files->push_back(child);
+    }
+  } while (FindNextFileA(find, &data));
+  FindClose(find);
+  return true;
+}
+
+#else
+
+// Appends the files under |dir|/|prefix| to |*files|, prefixed by |prefix|.
+// Symbolic links are followed, as opening the files would, but directories in
+// |*visited| are not listed again, so links cannot make this loop.
+bool ListFilesRecursively(const string& dir, const string& prefix,
+                          std::set<std::pair<dev_t, ino_t>>* visited,
+                          vector<string>* files) {
+  DIR* listing = opendir(JoinPath(dir, prefix).c_str());
+  if (listing == nullptr) {
+    return false;
+  }
+  while (const struct dirent* entry = readdir(listing)) {
+    const string name = entry->d_name;
+    if (name == "." || name == "..") {
+      continue;
+    }
+    const string child = JoinPath(prefix, name);
+    struct stat info;
+    if (stat(JoinPath(dir, child).c_str(), &info) != 0) {
+      continue;
+    }
+    if (S_ISDIR(info.st_mode)) {
+      if (visited->emplace(info.st_dev, info.st_ino).second) {
+        ListFilesRecursively(dir, child, visited, files);
+      }
+    } else if (S_ISREG(info.st_mode)) {
+      files->push_back(child);
+    }
+  }
+  closedir(listing);
+  return true;
+}
+
+// Files smaller than this are read: mapping them costs more than it saves.
+const off_t kMinMappedFileSize = 64 * 1024;
+
+// A file mapped copy-on-write, followed by at least two zero bytes.
+class MappedSourceBuffer : public SourceBuffer {
+ public:
+  MappedSourceBuffer(void* mapping, size_t mapping_size, size_t size)
+      : SourceBuffer(static_cast<char*>(mapping), size),
+        mapping_(mapping),
+        mapping_size_(mapping_size) {}
+  ~MappedSourceBuffer() override { munmap(mapping_, mapping_size_); }
+
+ private:
+  void* const mapping_;
+  const size_t mapping_size_;
+
+  DISALLOW_COPY_AND_ASSIGN(MappedSourceBuffer);
+};
+
+// Maps the |size| bytes of the file open as |fd|, or returns nullptr.
+unique_ptr<SourceBuffer> MapSourceFile(int fd, size_t size) {
+  // Reserve whole pages for the contents and the NULs.  The file is mapped
+  // over the front of this, and both the tail of its last page and the
+  // anonymous pages after it read as zeros.
+  const size_t page_size = sysconf(_SC_PAGESIZE);
+  const size_t mapping_size = (size + 2 + page_size - 1) / page_size * page_size;
+  void* mapping = mmap(nullptr, mapping_size, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (mapping == MAP_FAILED) {
+    return nullptr;
+  }
+  if (mmap(mapping, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd,
+           0) == MAP_FAILED) {
+    munmap(mapping, mapping_size);
+    return nullptr;
+  }
+  return unique_ptr<SourceBuffer>(
+      new MappedSourceBuffer(mapping, mapping_size, size));
+}
+
+#endif
+
+// Holds everything written in memory, and only touches the file on Close(),
+// if it does not already hold exactly that.
+class WriteIfChangedCodeWriter : public CodeWriter {
+ public:
+  WriteIfChangedCodeWriter(const IoDelegate& io_delegate, const string& path)
+      : io_delegate_(io_delegate),
+        path_(path) {}
+  virtual ~WriteIfChangedCodeWriter() { Close(); }
+
+  bool Write(const char* format, ...) override {
+    va_list ap;
+    va_start(ap, format);
+    StringAppendV(&contents_, format, ap);
+    va_end(ap);
+    return true;
+  }
+
+  bool AppendBytes(const char* data, size_t length) override {
+    contents_.append(data, length);
+    return true;
+  }
+
+  bool Close() override {
+    if (!closed_) {
+      closed_ = true;
+      success_ = IsUnchanged() ||
+                 io_delegate_.WriteFileAtomically(path_, contents_);
+    }
+    return success_;
+  }
+
+ private:
+  bool IsUnchanged() const {
+    // Most changes show in the size, which saves reading the file.
+    struct stat info;
+    if (stat(path_.c_str(), &info) != 0 || !S_ISREG(info.st_mode) ||
+        static_cast<uint64_t>(info.st_size) != contents_.size()) {
+      return false;
+    }
+    unique_ptr<string> existing = io_delegate_.GetFileContents(path_);
+    return existing && *existing == contents_;
+  }
+
+  const IoDelegate& io_delegate_;
+  const string path_;
+  string contents_;
+  bool closed_ = false;
+  bool success_ = false;
+
+  DISALLOW_COPY_AND_ASSIGN(WriteIfChangedCodeWriter);
+};  // class WriteIfChangedCodeWriter
+
+}  // namespace
+
+SourceBuffer::SourceBuffer(unique_ptr<string> contents)
+    : contents_(std::move(contents)) {
+  size_ = contents_->size();
+  contents_->append(2u, '\0');
+  data_ = &(*contents_)[0];
+}
 
 bool IoDelegate::GetAbsolutePath(const string& path, string* absolute_path) {
 #ifdef _WIN32
@@ -102,6 +295,30 @@ unique_ptr<string> IoDelegate::GetFileContents(
   return contents;
 }
 
+unique_ptr<SourceBuffer> IoDelegate::GetSourceBuffer(
+    const string& filename) const {
+#ifndef _WIN32
+  int fd = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd >= 0) {
+    unique_ptr<SourceBuffer> mapped;
+    struct stat info;
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) &&
+        info.st_size >= kMinMappedFileSize) {
+      mapped = MapSourceFile(fd, info.st_size);
+    }
+    close(fd);
+    if (mapped) {
+      return mapped;
+    }
+  }
+#endif
+  unique_ptr<string> contents = GetFileContents(filename);
+  if (!contents) {
+    return nullptr;
+  }
+  return unique_ptr<SourceBuffer>(new SourceBuffer(std::move(contents)));
+}
+
 unique_ptr<LineReader> IoDelegate::GetLineReader(
     const string& file_path) const {
   return LineReader::ReadFromFile(file_path);
@@ -117,6 +334,39 @@ bool IoDelegate::FileIsReadable(const string& path) const {
 #endif
 }
 
+bool IoDelegate::ListFiles(const string& dir, vector<string>* files) const {
+  const string root = dir.empty() ? "." : dir;
+#ifdef _WIN32
+  return ListFilesRecursively(root, "", files);
+#else
+  std::set<std::pair<dev_t, ino_t>> visited;
+  struct stat info;
+  if (stat(root.c_str(), &info) == 0) {
+    visited.emplace(info.st_dev, info.st_ino);
+  }
+  return ListFilesRecursively(root, "", &visited, files);
+#endif
+}
+
+bool IoDelegate::GetModificationTime(const string& path,
+                                     int64_t* mtime) const {
+  struct stat info;
+  if (stat(path.c_str(), &info) != 0) {
+    return false;
+  }
+  *mtime = info.st_mtime;
+  return true;
+}
+
+bool IoDelegate::GetFileSize(const string& path, int64_t* size) const {
+  struct stat info;
+  if (stat(path.c_str(), &info) != 0) {
+    return false;
+  }
+  *size = info.st_size;
+  return true;
+}
+
 bool IoDelegate::CreatedNestedDirs(
     const string& caller_base_dir,
     const vector<string>& nested_subdirs) const {
@@ -175,9 +425,18 @@ bool IoDelegate::CreatePathForFile(const string& path) const {
 
 unique_ptr<CodeWriter> IoDelegate::GetCodeWriter(
     const string& file_path) const {
+  if (write_only_if_changed_ && file_path != "-") {
+    return GetWriteIfChangedCodeWriter(file_path);
+  }
   return GetFileWriter(file_path);
 }
 
+unique_ptr<CodeWriter> IoDelegate::GetWriteIfChangedCodeWriter(
+    const string& file_path) const {
+  return unique_ptr<CodeWriter>(
+      new WriteIfChangedCodeWriter(*this, file_path));
+}
+
 void IoDelegate::RemovePath(const std::string& file_path) const {
 #ifdef _WIN32
   _unlink(file_path.c_str());
@@ -186,5 +445,82 @@ void IoDelegate::RemovePath(const std::string& file_path) const {
 #endif
 }
 
+bool IoDelegate::WriteFileAtomically(const string& path,
+                                     const string& contents) const {
+  // Temporary names must differ between processes and threads.
+  static std::atomic<unsigned> counter{0};
+#ifdef _WIN32
+  const unsigned long pid = GetCurrentProcessId();
+#else
+  const unsigned long pid = getpid();
+#endif
+  const string temp_path =
+      StringPrintf("%s.tmp.%lu.%u", path.c_str(), pid, counter++);
+
+  std::ofstream out(temp_path, std::ios::out | std::ios::binary);
+  out.write(contents.data(), contents.size());
+  out.close();
+  if (!out) {
+    LOG(ERROR) << "Error while writing " << temp_path;
+    RemovePath(temp_path);
+    return false;
+  }
+
+#ifdef _WIN32
+  const bool renamed = MoveFileExA(temp_path.c_str(), path.c_str(),
+                                   MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+  const bool renamed = rename(temp_path.c_str(), path.c_str()) == 0;
+#endif
+  if (!renamed) {
+    LOG(ERROR) << "Error while renaming " << temp_path << " to " << path;
+    RemovePath(temp_path);
+    return false;
+  }
+  return true;
+}
+
+bool FileState::Record(const IoDelegate& io_delegate, const string& path) {
+  checked_at_ = time(nullptr);
+  return io_delegate.GetModificationTime(path, &mtime_) &&
+         io_delegate.GetFileSize(path, &size_);
+}
+
+void FileState::SetContents(const char* data, size_t size) {
+  contents_hash_ = Hash(data, size);
+}
+
+bool FileState::IsUnchanged(const IoDelegate& io_delegate,
+                            const string& path) {
+  int64_t mtime = 0;
+  int64_t size = 0;
+  if (!io_delegate.GetModificationTime(path, &mtime) ||
+      !io_delegate.GetFileSize(path, &size) ||
+      mtime != mtime_ || size != size_) {
+    return false;
+  }
+  // Any change made since a second or two after the file was last looked at
+  // shows in its modification time.
+  if (mtime_ + kTimestampResolution < checked_at_) {
+    return true;
+  }
+  const int64_t now = time(nullptr);
+  unique_ptr<SourceBuffer> buffer = io_delegate.GetSourceBuffer(path);
+  if (!buffer || Hash(buffer->data(), buffer->size()) != contents_hash_) {
+    return false;
+  }
+  checked_at_ = now;
+  return true;
+}
+
+uint64_t FileState::Hash(const char* data, size_t size) {
+  // FNV-1a.
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (size_t i = 0; i < size; ++i) {
+    hash = (hash ^ static_cast<unsigned char>(data[i])) * 0x100000001b3ULL;
+  }
+  return hash;
+}
+
 }  // namespace android
 }  // namespace aidl
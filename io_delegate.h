@@ -19,6 +19,8 @@
 
 #include <android-base/macros.h>
 
+#include <stdint.h>
+
 #include <memory>
 #include <string>
 #include <vector>
@@ -29,6 +31,31 @@
 namespace android {
 namespace aidl {
 
+// The contents of a source file followed by two NUL bytes, which is how flex
+// wants a buffer it scans in place.  The contents may be written to in memory,
+// but writes never reach the file.
+class SourceBuffer {
+ public:
+  // Takes over |contents| and terminates it.
+  explicit SourceBuffer(std::unique_ptr<std::string> contents);
+  virtual ~SourceBuffer() = default;
+
+  char* data() const { return data_; }
+  // The size of the contents, not counting the terminating NULs.
+  size_t size() const { return size_; }
+
+ protected:
+  // For buffers that keep their contents elsewhere.
+  SourceBuffer(char* data, size_t size) : data_(data), size_(size) {}
+
+ private:
+  std::unique_ptr<std::string> contents_;
+  char* data_;
+  size_t size_;
+
+  DISALLOW_COPY_AND_ASSIGN(SourceBuffer);
+};
+
 class IoDelegate {
  public:
   IoDelegate() = default;
@@ -46,26 +73,98 @@ class IoDelegate {
       const std::string& filename,
       const std::string& content_suffix = "") const;
 
+  // Returns the contents of |filename| ready to be scanned in place, or
+  // nullptr if it cannot be read.  Large files are mapped into memory rather
+  // than read.
+  virtual std::unique_ptr<SourceBuffer> GetSourceBuffer(
+      const std::string& filename) const;
+
   virtual std::unique_ptr<LineReader> GetLineReader(
       const std::string& file_path) const;
 
   virtual bool FileIsReadable(const std::string& path) const;
 
+  // Appends the paths of the regular files under |dir| and its
+  // subdirectories, relative to |dir|, to |*files|.  Returns false if |dir|
+  // cannot be listed.
+  virtual bool ListFiles(const std::string& dir,
+                         std::vector<std::string>* files) const;
+
+  // Stores the last modification time of |path| to |*mtime|.
+  // Returns false if |path| cannot be examined.
+  virtual bool GetModificationTime(const std::string& path,
+                                   int64_t* mtime) const;
+  // Stores the size of |path| in bytes to |*size|.
+  // Returns false if |path| cannot be examined.
+  virtual bool GetFileSize(const std::string& path, int64_t* size) const;
+
   virtual bool CreatedNestedDirs(
       const std::string& base_dir,
       const std::vector<std::string>& nested_subdirs) const;
 
   bool CreatePathForFile(const std::string& path) const;
 
+  // Unless writing only changed files, the file is truncated right away.
   virtual std::unique_ptr<CodeWriter> GetCodeWriter(
       const std::string& file_path) const;
 
+  // When set, writers from GetCodeWriter() keep what is written to them in
+  // memory until closed, and then replace the file through a temporary file,
+  // or leave it untouched if its contents are the same.  Either way the file
+  // is never seen half written, and unchanged files keep their modification
+  // times, so nothing built from them is rebuilt.
+  void SetWriteOnlyIfChanged(bool write_only_if_changed) {
+    write_only_if_changed_ = write_only_if_changed;
+  }
+
   virtual void RemovePath(const std::string& file_path) const;
 
+  // Writes |contents| to |path| through a temporary file, so that concurrent
+  // readers never see a partially written file.  Returns false on error.
+  virtual bool WriteFileAtomically(const std::string& path,
+                                   const std::string& contents) const;
+
+ protected:
+  // Returns the writer GetCodeWriter() gives out when writing only changed
+  // files.  It reads and writes |file_path| through this delegate.
+  std::unique_ptr<CodeWriter> GetWriteIfChangedCodeWriter(
+      const std::string& file_path) const;
+
  private:
+  bool write_only_if_changed_ = false;
+
   DISALLOW_COPY_AND_ASSIGN(IoDelegate);
 };  // class IoDelegate
 
+// What a file looked like when it was read, so that a cache built from it can
+// tell whether it changed.  A file whose modification time or size differs
+// has changed.  Otherwise only a file modified within the timestamp
+// resolution of the last look may have changed unnoticed, and its contents
+// are read and compared.
+class FileState {
+ public:
+  FileState() = default;
+
+  // Records the modification time and size of |path|.  Call this before
+  // reading the file, so that a change made while reading is noticed.
+  // Returns false if |path| cannot be examined.
+  bool Record(const IoDelegate& io_delegate, const std::string& path);
+  // Records the contents read after Record().
+  void SetContents(const char* data, size_t size);
+
+  // Returns true if |path| is as recorded.
+  bool IsUnchanged(const IoDelegate& io_delegate, const std::string& path);
+
+ private:
+  static uint64_t Hash(const char* data, size_t size);
+
+  int64_t mtime_ = -1;
+  int64_t size_ = -1;
+  uint64_t contents_hash_ = 0;
+  // When the contents were last known to match the modification time.
+  int64_t checked_at_ = 0;
+};
+
 }  // namespace android
 }  // namespace aidl
 
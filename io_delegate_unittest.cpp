@@ -14,13 +14,23 @@
  * limitations under the License.
  */
 
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <utime.h>
+
+#include <algorithm>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include <gtest/gtest.h>
 
 #include "io_delegate.h"
 
 using std::string;
+using std::vector;
 
 namespace android {
 namespace aidl {
@@ -42,5 +52,169 @@ TEST(IoDelegateTest, CurrentlyInfersLinuxAbsolutePath) {
   EXPECT_EQ(absolute_path[0], '/');
 }
 
+TEST(IoDelegateTest, ListsFilesRecursively) {
+  char temp_dir[] = "/tmp/aidl_list_files_XXXXXX";
+  ASSERT_NE(nullptr, mkdtemp(temp_dir));
+  const string dir = temp_dir;
+  IoDelegate io_delegate;
+  ASSERT_TRUE(io_delegate.CreatePathForFile(dir + "/a/b/IFoo.aidl"));
+  ASSERT_TRUE(io_delegate.WriteFileAtomically(dir + "/a/b/IFoo.aidl", ""));
+  ASSERT_TRUE(io_delegate.WriteFileAtomically(dir + "/IBar.aidl", ""));
+  // Links are followed, but never into a directory listed already.
+  ASSERT_EQ(0, symlink(dir.c_str(), (dir + "/a/loop").c_str()));
+
+  vector<string> files;
+  EXPECT_TRUE(io_delegate.ListFiles(dir + "/", &files));
+  std::sort(files.begin(), files.end());
+  EXPECT_EQ((vector<string>{"IBar.aidl", "a/b/IFoo.aidl"}), files);
+  EXPECT_FALSE(io_delegate.ListFiles(dir + "/missing", &files));
+
+  unlink((dir + "/a/loop").c_str());
+  unlink((dir + "/a/b/IFoo.aidl").c_str());
+  unlink((dir + "/IBar.aidl").c_str());
+  rmdir((dir + "/a/b").c_str());
+  rmdir((dir + "/a").c_str());
+  rmdir(dir.c_str());
+}
+
+TEST(IoDelegateTest, TerminatesSourceBuffers) {
+  char temp_dir[] = "/tmp/aidl_source_buffer_XXXXXX";
+  ASSERT_NE(nullptr, mkdtemp(temp_dir));
+  const string dir = temp_dir;
+  IoDelegate io_delegate;
+  // Small files are read, large ones are mapped.  A whole number of pages
+  // leaves no room for the NULs in the last page of the file.
+  for (size_t size : {size_t{10}, size_t{256 * 1024}, size_t{256 * 1024 + 7}}) {
+    string contents(size, 'x');
+    contents.front() = 'a';
+    contents.back() = 'z';
+    const string path = dir + "/IFoo.aidl";
+    ASSERT_TRUE(io_delegate.WriteFileAtomically(path, contents));
+
+    std::unique_ptr<SourceBuffer> buffer = io_delegate.GetSourceBuffer(path);
+    ASSERT_NE(nullptr, buffer);
+    ASSERT_EQ(size, buffer->size());
+    EXPECT_EQ(contents, string(buffer->data(), buffer->size()));
+    EXPECT_EQ('\0', buffer->data()[size]);
+    EXPECT_EQ('\0', buffer->data()[size + 1]);
+
+    // The scanner writes to the buffer, but that must not touch the file.
+    buffer->data()[0] = 'b';
+    buffer.reset();
+    std::unique_ptr<string> read = io_delegate.GetFileContents(path);
+    ASSERT_NE(nullptr, read);
+    EXPECT_EQ(contents, *read);
+    unlink(path.c_str());
+  }
+  EXPECT_EQ(nullptr, io_delegate.GetSourceBuffer(dir + "/missing.aidl"));
+  rmdir(dir.c_str());
+}
+
+TEST(IoDelegateTest, WritesOnlyChangedFiles) {
+  char temp_dir[] = "/tmp/aidl_write_if_changed_XXXXXX";
+  ASSERT_NE(nullptr, mkdtemp(temp_dir));
+  const string path = string(temp_dir) + "/IFoo.h";
+  IoDelegate io_delegate;
+  io_delegate.SetWriteOnlyIfChanged(true);
+  // Replacing a file gives it a new inode, leaving it alone does not.
+  auto get_inode = [&path]() {
+    struct stat info;
+    return (stat(path.c_str(), &info) == 0) ? info.st_ino : 0;
+  };
+
+  std::unique_ptr<CodeWriter> writer = io_delegate.GetCodeWriter(path);
+  writer->Append("int ", 1, ";\n");
+  EXPECT_EQ(0u, get_inode());
+  EXPECT_TRUE(writer->Close());
+  const ino_t first = get_inode();
+  EXPECT_NE(0u, first);
+
+  writer = io_delegate.GetCodeWriter(path);
+  writer->Write("int %d;\n", 1);
+  EXPECT_TRUE(writer->Close());
+  EXPECT_EQ(first, get_inode());
+
+  // Until it is closed, the writer leaves the old contents in place.
+  writer = io_delegate.GetCodeWriter(path);
+  writer->Append("int ", 2, ";\n");
+  std::unique_ptr<string> contents = io_delegate.GetFileContents(path);
+  ASSERT_NE(nullptr, contents);
+  EXPECT_EQ("int 1;\n", *contents);
+  EXPECT_TRUE(writer->Close());
+  EXPECT_NE(first, get_inode());
+  contents = io_delegate.GetFileContents(path);
+  ASSERT_NE(nullptr, contents);
+  EXPECT_EQ("int 2;\n", *contents);
+
+  // Failing writes still fail, and leave nothing behind.
+  writer = io_delegate.GetCodeWriter(string(temp_dir) + "/missing/IFoo.h");
+  ASSERT_NE(nullptr, writer);
+  EXPECT_FALSE(writer->Close());
+
+  unlink(path.c_str());
+  EXPECT_EQ(0, rmdir(temp_dir));
+}
+
+namespace {
+
+// Counts the files read.
+class CountingIoDelegate : public IoDelegate {
+ public:
+  std::unique_ptr<SourceBuffer> GetSourceBuffer(
+      const string& filename) const override {
+    ++reads;
+    return IoDelegate::GetSourceBuffer(filename);
+  }
+
+  mutable int reads = 0;
+};
+
+}  // namespace
+
+TEST(IoDelegateTest, TellsChangedFilesFromTheirState) {
+  char temp_dir[] = "/tmp/aidl_file_state_XXXXXX";
+  ASSERT_NE(nullptr, mkdtemp(temp_dir));
+  const string path = string(temp_dir) + "/IFoo.aidl";
+  CountingIoDelegate io_delegate;
+  auto set_mtime = [&path](time_t mtime) {
+    struct utimbuf times = {mtime, mtime};
+    return utime(path.c_str(), &times) == 0;
+  };
+  const string contents = "interface IFoo {}";
+
+  // A file modified as recently as it was looked at is read again, since
+  // a change within the same timestamp may not show.
+  FileState state;
+  ASSERT_TRUE(io_delegate.WriteFileAtomically(path, contents));
+  ASSERT_TRUE(set_mtime(time(nullptr)));
+  ASSERT_TRUE(state.Record(io_delegate, path));
+  state.SetContents(contents.data(), contents.size());
+  EXPECT_TRUE(state.IsUnchanged(io_delegate, path));
+  EXPECT_EQ(1, io_delegate.reads);
+  ASSERT_TRUE(io_delegate.WriteFileAtomically(path, "interface IBar {}"));
+  ASSERT_TRUE(set_mtime(time(nullptr)));
+  EXPECT_FALSE(state.IsUnchanged(io_delegate, path));
+
+  // A file modified long before it was looked at is not read at all.
+  ASSERT_TRUE(io_delegate.WriteFileAtomically(path, contents));
+  ASSERT_TRUE(set_mtime(time(nullptr) - 100));
+  ASSERT_TRUE(state.Record(io_delegate, path));
+  state.SetContents(contents.data(), contents.size());
+  io_delegate.reads = 0;
+  EXPECT_TRUE(state.IsUnchanged(io_delegate, path));
+  EXPECT_EQ(0, io_delegate.reads);
+  // Changes to its modification time or size still show.
+  ASSERT_TRUE(set_mtime(time(nullptr) - 50));
+  EXPECT_FALSE(state.IsUnchanged(io_delegate, path));
+  ASSERT_TRUE(io_delegate.WriteFileAtomically(path, "interface IFoo2 {}"));
+  ASSERT_TRUE(set_mtime(time(nullptr) - 100));
+  EXPECT_FALSE(state.IsUnchanged(io_delegate, path));
+  EXPECT_EQ(0, io_delegate.reads);
+
+  unlink(path.c_str());
+  EXPECT_FALSE(state.IsUnchanged(io_delegate, path));
+  EXPECT_EQ(0, rmdir(temp_dir));
+}
+
 }  // namespace android
 }  // namespace aidl
@@ -17,6 +17,8 @@
 #ifndef AIDL_LINE_READER_H_
 #define AIDL_LINE_READER_H_
 
+#include <stddef.h>
+
 #include <memory>
 #include <string>
 
@@ -40,6 +42,27 @@ class LineReader {
   DISALLOW_COPY_AND_ASSIGN(LineReader);
 };  // class LineReader
 
+// Walks the lines of a buffer in place, without copying them.  Each line is
+// returned as a pointer into the buffer, which must outlive the iterator, and
+// does not include its '\n'.  Unlike LineReader, a buffer ending in a newline
+// has no empty last line.
+class LineIterator {
+ public:
+  LineIterator(const char* data, size_t size)
+      : next_(data), end_(data + size) {}
+  ~LineIterator() = default;
+
+  // Points |*line| at the next line and stores its length to |*length|.
+  // Returns false once every line has been returned.
+  bool Next(const char** line, size_t* length);
+
+ private:
+  const char* next_;
+  const char* const end_;
+
+  DISALLOW_COPY_AND_ASSIGN(LineIterator);
+};  // class LineIterator
+
 }  // namespace android
 }  // namespace aidl
 
@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2018, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "line_reader.h"
+
+using std::string;
+using std::vector;
+
+namespace android {
+namespace aidl {
+
+namespace {
+
+vector<string> SplitLines(const string& contents) {
+  LineIterator lines(contents.data(), contents.size());
+  vector<string> ret;
+  const char* line = nullptr;
+  size_t length = 0;
+  while (lines.Next(&line, &length)) {
+    EXPECT_GE(line, contents.data());
+    EXPECT_LE(line + length, contents.data() + contents.size());
+    ret.emplace_back(line, length);
+  }
+  return ret;
+}
+
+}  // namespace
+
+TEST(LineIteratorTest, SplitsOnNewlines) {
+  EXPECT_EQ((vector<string>{"a", "bc", "", "d"}), SplitLines("a\nbc\n\nd"));
+  EXPECT_EQ((vector<string>{"a", "bc"}), SplitLines("a\nbc\n"));
+  EXPECT_EQ((vector<string>{"", ""}), SplitLines("\n\n"));
+  EXPECT_EQ((vector<string>{"a\r"}), SplitLines("a\r\n"));
+  EXPECT_TRUE(SplitLines("").empty());
+}
+
+TEST(LineIteratorTest, HandlesLongLines) {
+  const string first(100000, 'x');
+  const string second(3, 'y');
+  EXPECT_EQ((vector<string>{first, second}),
+            SplitLines(first + "\n" + second));
+}
+
+TEST(LineIteratorTest, KeepsEmbeddedNuls) {
+  const string contents("a\0b\nc", 5);
+  EXPECT_EQ((vector<string>{string("a\0b", 3), "c"}), SplitLines(contents));
+}
+
+}  // namespace aidl
+}  // namespace android
@@ -17,6 +17,8 @@
 #include <memory>
 
 #include "aidl.h"
+#include "archive_io_delegate.h"
+#include "compile_server.h"
 #include "io_delegate.h"
 #include "logging.h"
 #include "options.h"
@@ -37,6 +39,13 @@ int main(int argc, char** argv) {
     return 1;
   }
 
-  android::aidl::IoDelegate io_delegate;
+  if (options->IsClient()) {
+    return android::aidl::RunCompileClient(options->ServerSocket(),
+                                           options->ServerArgs());
+  }
+
+  android::aidl::IoDelegate file_io_delegate;
+  file_io_delegate.SetWriteOnlyIfChanged(options->WriteOnlyIfChanged());
+  android::aidl::ArchiveIoDelegate io_delegate(file_io_delegate);
   return android::aidl::compile_aidl_to_cpp(*options, io_delegate);
 }
@@ -18,6 +18,8 @@
 #include <memory>
 
 #include "aidl.h"
+#include "archive_io_delegate.h"
+#include "compile_server.h"
 #include "io_delegate.h"
 #include "logging.h"
 #include "options.h"
@@ -37,7 +39,9 @@ int main(int argc, char** argv) {
     return 1;
   }
 
-  android::aidl::IoDelegate io_delegate;
+  android::aidl::IoDelegate file_io_delegate;
+  file_io_delegate.SetWriteOnlyIfChanged(options->write_only_if_changed_);
+  android::aidl::ArchiveIoDelegate io_delegate(file_io_delegate);
   switch (options->task) {
     case JavaOptions::COMPILE_AIDL_TO_JAVA:
       return android::aidl::compile_aidl_to_java(*options, io_delegate);
@@ -45,6 +49,20 @@ int main(int argc, char** argv) {
       if (android::aidl::preprocess_aidl(*options, io_delegate))
         return 0;
       return 1;
+    case JavaOptions::RUN_SERVER: {
+      // Requests choose for themselves whether to write only changed files.
+      android::aidl::CompileServer server;
+      if (!server.Listen(options->server_socket_)) {
+        return 1;
+      }
+      server.Serve();
+      return 0;
+    }
+    case JavaOptions::STOP_SERVER:
+      return android::aidl::StopCompileServer(options->server_socket_) ? 0 : 1;
+    case JavaOptions::COMPILE_ON_SERVER:
+      return android::aidl::RunCompileClient(options->server_socket_,
+                                             options->server_args_);
   }
   std::cerr << "aidl: internal error" << std::endl;
   return 1;
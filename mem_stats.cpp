@@ -0,0 +1,167 @@
+/*
+ * Copyright (C) 2018, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "mem_stats.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#if defined(__APPLE__)
+#include <malloc/malloc.h>
+#else
+#include <malloc.h>
+#endif
+
+#include <android-base/stringprintf.h>
+
+#include "timings.h"
+
+using android::base::StringAppendF;
+using std::string;
+
+namespace android {
+namespace aidl {
+
+namespace {
+
+// Allocations made outside of any phase count towards this extra slot.
+constexpr int kOtherPhase = static_cast<int>(kNumPhases);
+
+struct Counters {
+  std::atomic<int64_t> allocations{0};
+  std::atomic<int64_t> allocated_bytes{0};
+  std::atomic<int64_t> frees{0};
+  std::atomic<int64_t> freed_bytes{0};
+  std::atomic<int64_t> peak_live_bytes{0};
+};
+
+// Everything here is touched from operator new, so it must never allocate:
+// the counters are plain atomics with constant initializers.
+Counters counters[kNumPhases + 1];
+std::atomic<int64_t> live_bytes{0};
+std::atomic<int64_t> peak_live_bytes{0};
+thread_local int current_phase = kOtherPhase;
+
+size_t AllocationSize(void* p) {
+#if defined(_WIN32)
+  return _msize(p);
+#elif defined(__APPLE__)
+  return malloc_size(p);
+#else
+  return malloc_usable_size(p);
+#endif
+}
+
+void RaiseTo(std::atomic<int64_t>* peak, int64_t value) {
+  int64_t current = peak->load(std::memory_order_relaxed);
+  while (value > current &&
+         !peak->compare_exchange_weak(current, value,
+                                      std::memory_order_relaxed)) {
+  }
+}
+
+}  // namespace
+
+namespace internals {
+
+std::atomic<bool> mem_stats_enabled{false};
+
+void CountAllocation(void* p) {
+  const int64_t size = AllocationSize(p);
+  Counters& phase = counters[current_phase];
+  phase.allocations.fetch_add(1, std::memory_order_relaxed);
+  phase.allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+  const int64_t live =
+      live_bytes.fetch_add(size, std::memory_order_relaxed) + size;
+  RaiseTo(&phase.peak_live_bytes, live);
+  RaiseTo(&peak_live_bytes, live);
+}
+
+void CountFree(void* p) {
+  const int64_t size = AllocationSize(p);
+  Counters& phase = counters[current_phase];
+  phase.frees.fetch_add(1, std::memory_order_relaxed);
+  phase.freed_bytes.fetch_add(size, std::memory_order_relaxed);
+  live_bytes.fetch_sub(size, std::memory_order_relaxed);
+}
+
+}  // namespace internals
+
+void StartMemStats() {
+  internals::mem_stats_enabled.store(false);
+  for (Counters& phase : counters) {
+    phase.allocations = 0;
+    phase.allocated_bytes = 0;
+    phase.frees = 0;
+    phase.freed_bytes = 0;
+    phase.peak_live_bytes = 0;
+  }
+  live_bytes = 0;
+  peak_live_bytes = 0;
+  internals::mem_stats_enabled.store(true);
+}
+
+string StopMemStats() {
+  internals::mem_stats_enabled.store(false);
+  int64_t allocations = 0;
+  int64_t allocated_bytes = 0;
+  for (const Counters& phase : counters) {
+    allocations += phase.allocations;
+    allocated_bytes += phase.allocated_bytes;
+  }
+
+  string out = "{\n";
+  StringAppendF(&out, "  \"allocations\": %lld,\n",
+                static_cast<long long>(allocations));
+  StringAppendF(&out, "  \"allocated_bytes\": %lld,\n",
+                static_cast<long long>(allocated_bytes));
+  StringAppendF(&out, "  \"peak_live_bytes\": %lld,\n",
+                static_cast<long long>(peak_live_bytes.load()));
+  out += "  \"phases\": {\n";
+  for (int i = 0; i <= kOtherPhase; ++i) {
+    const Counters& phase = counters[i];
+    const char* name =
+        (i == kOtherPhase) ? "other" : PhaseName(static_cast<Phase>(i));
+    StringAppendF(&out,
+                  "    %s: {\"allocations\": %lld, \"allocated_bytes\": %lld, "
+                  "\"frees\": %lld, \"freed_bytes\": %lld, "
+                  "\"peak_live_bytes\": %lld}%s\n",
+                  JsonString(name).c_str(),
+                  static_cast<long long>(phase.allocations.load()),
+                  static_cast<long long>(phase.allocated_bytes.load()),
+                  static_cast<long long>(phase.frees.load()),
+                  static_cast<long long>(phase.freed_bytes.load()),
+                  static_cast<long long>(phase.peak_live_bytes.load()),
+                  i < kOtherPhase ? "," : "");
+  }
+  out += "  }\n}\n";
+  return out;
+}
+
+MemPhase::MemPhase(Phase phase) : previous_(current_phase) {
+  current_phase = static_cast<int>(phase);
+}
+
+void MemPhase::End() {
+  if (!ended_) {
+    current_phase = previous_;
+    ended_ = true;
+  }
+}
+
+}  // namespace aidl
+}  // namespace android
@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2018, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef AIDL_MEM_STATS_H_
+#define AIDL_MEM_STATS_H_
+
+#include <atomic>
+#include <string>
+
+#include <android-base/macros.h>
+
+namespace android {
+namespace aidl {
+
+enum class Phase;
+
+namespace internals {
+// The hooks the replacement operator new and delete in
+// mem_stats_allocator.cpp count through.  Only the aidl and aidl-cpp
+// binaries link that; everything else keeps the standard allocator, and so
+// counts nothing.
+extern std::atomic<bool> mem_stats_enabled;
+// Count the block |p| from malloc() as allocated or freed by the calling
+// thread.  Neither allocates.
+void CountAllocation(void* p);
+void CountFree(void* p);
+}  // namespace internals
+
+// Starts counting the heap allocations made through operator new by every
+// thread, by the phase that makes them, dropping any counted before.
+void StartMemStats();
+// Stops counting, and returns as JSON the allocations, bytes allocated and
+// freed, and the highest number of live bytes reached during each phase and
+// overall.  Live bytes are those allocated since StartMemStats() less those
+// freed since, so freeing memory allocated before lowers them.
+std::string StopMemStats();
+
+// Counts the allocations of the calling thread towards |phase| for as long
+// as it lives, while counting allocations.  Allocations made outside of any
+// phase count as "other".
+class MemPhase {
+ public:
+  explicit MemPhase(Phase phase);
+  ~MemPhase() { End(); }
+
+  // Ends the phase before the end of the scope.
+  void End();
+
+ private:
+  const int previous_;
+  bool ended_ = false;
+
+  DISALLOW_COPY_AND_ASSIGN(MemPhase);
+};
+
+}  // namespace aidl
+}  // namespace android
+
+#endif  // AIDL_MEM_STATS_H_
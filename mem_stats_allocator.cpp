@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2018, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Replaces the global operator new and delete, so that the allocations of
+// the compiler can be counted by phase for --mem-stats.  Only the aidl and
+// aidl-cpp binaries link this; the tests, benchmarks and everything else
+// built on libaidl-common keep the standard allocator.
+
+#include <stdlib.h>
+
+#include <new>
+
+#include "mem_stats.h"
+
+using android::aidl::internals::CountAllocation;
+using android::aidl::internals::CountFree;
+using android::aidl::internals::mem_stats_enabled;
+
+namespace {
+
+void* Allocate(size_t size) {
+  if (size == 0) {
+    size = 1;
+  }
+  void* p = malloc(size);
+  while (p == nullptr) {
+    std::new_handler handler = std::get_new_handler();
+    if (handler == nullptr) {
+      throw std::bad_alloc();
+    }
+    handler();
+    p = malloc(size);
+  }
+  if (mem_stats_enabled.load(std::memory_order_relaxed)) {
+    CountAllocation(p);
+  }
+  return p;
+}
+
+void* AllocateNoThrow(size_t size) noexcept {
+  try {
+    return Allocate(size);
+  } catch (const std::bad_alloc&) {
+    return nullptr;
+  }
+}
+
+void Free(void* p) noexcept {
+  if (p == nullptr) {
+    return;
+  }
+  if (mem_stats_enabled.load(std::memory_order_relaxed)) {
+    CountFree(p);
+  }
+  free(p);
+}
+
+}  // namespace
+
+// While not counting, these cost a branch on top of malloc and free.
+void* operator new(size_t size) {
+  return Allocate(size);
+}
+
+void* operator new[](size_t size) {
+  return Allocate(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+  return AllocateNoThrow(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+  return AllocateNoThrow(size);
+}
+
+void operator delete(void* p) noexcept {
+  Free(p);
+}
+
+void operator delete[](void* p) noexcept {
+  Free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept {
+  Free(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept {
+  Free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+  Free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+  Free(p);
+}
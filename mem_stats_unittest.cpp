@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2018, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "mem_stats.h"
+#include "timings.h"
+
+using std::string;
+
+namespace android {
+namespace aidl {
+namespace {
+
+struct PhaseStats {
+  long long allocations = -1;
+  long long allocated_bytes = -1;
+  long long frees = -1;
+  long long freed_bytes = -1;
+  long long peak_live_bytes = -1;
+};
+
+// Reads the counts of the phase called |name| out of |report|.
+PhaseStats GetPhaseStats(const string& report, const string& name) {
+  PhaseStats stats;
+  const size_t start = report.find("\"" + name + "\": {");
+  if (start != string::npos) {
+    sscanf(report.c_str() + start + name.size() + 4,
+           "{\"allocations\": %lld, \"allocated_bytes\": %lld, "
+           "\"frees\": %lld, \"freed_bytes\": %lld, "
+           "\"peak_live_bytes\": %lld}",
+           &stats.allocations, &stats.allocated_bytes, &stats.frees,
+           &stats.freed_bytes, &stats.peak_live_bytes);
+  }
+  return stats;
+}
+
+}  // namespace
+
+// The tests keep the standard allocator, so they count blocks through the
+// hooks that the replacement operator new and delete of the compiler use.
+TEST(MemStatsTest, CountsAllocationsOfEachPhase) {
+  StartMemStats();
+  void* kept = malloc(1000);
+  {
+    MemPhase parse(Phase::PARSE_INPUT);
+    internals::CountAllocation(kept);
+    {
+      MemPhase build(Phase::BUILD_AST);
+      void* p = malloc(4000);
+      internals::CountAllocation(p);
+      internals::CountFree(p);
+      free(p);
+    }
+    void* p = malloc(2000);
+    internals::CountAllocation(p);
+    internals::CountFree(p);
+    free(p);
+  }
+  const string report = StopMemStats();
+  free(kept);
+
+  const PhaseStats parse = GetPhaseStats(report, "parse_input");
+  EXPECT_EQ(2, parse.allocations);
+  EXPECT_GE(parse.allocated_bytes, 3000);
+  EXPECT_EQ(1, parse.frees);
+  EXPECT_GE(parse.freed_bytes, 2000);
+  EXPECT_GE(parse.peak_live_bytes, 3000);
+  // The block of 4000 bytes was freed before the one of 2000 was allocated.
+  EXPECT_LT(parse.peak_live_bytes, 6000);
+
+  const PhaseStats build = GetPhaseStats(report, "build_ast");
+  EXPECT_EQ(1, build.allocations);
+  EXPECT_EQ(1, build.frees);
+  EXPECT_EQ(build.allocated_bytes, build.freed_bytes);
+  EXPECT_GE(build.peak_live_bytes, 5000);
+
+  EXPECT_EQ(0, GetPhaseStats(report, "write_output").allocations);
+  EXPECT_EQ(0, GetPhaseStats(report, "other").allocations);
+}
+
+TEST(MemStatsTest, StartsCountingAfresh) {
+  StartMemStats();
+  EXPECT_TRUE(internals::mem_stats_enabled.load());
+  void* p = malloc(100);
+  {
+    MemPhase phase(Phase::CHECK_TYPES);
+    internals::CountAllocation(p);
+  }
+  StopMemStats();
+  EXPECT_FALSE(internals::mem_stats_enabled.load());
+
+  StartMemStats();
+  const string report = StopMemStats();
+  free(p);
+  const PhaseStats check = GetPhaseStats(report, "check_types");
+  EXPECT_EQ(0, check.allocations);
+  EXPECT_EQ(0, check.peak_live_bytes);
+}
+
+}  // namespace aidl
+}  // namespace android
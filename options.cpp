@@ -20,9 +20,14 @@
 #include <iostream>
 #include <stdio.h>
 
+#include <android-base/parseint.h>
+#include <android-base/strings.h>
+
 #include "logging.h"
 #include "os.h"
 
+using android::base::ParseUint;
+using android::base::Split;
 using std::cerr;
 using std::endl;
 using std::string;
@@ -33,13 +38,29 @@ namespace android {
 namespace aidl {
 namespace {
 
+// Parses the thread count of a -j<N> or -j <N> option starting at argv[*i],
+// advancing |*i| past a separate count.  Returns false if the count is
+// missing or not a positive number.
+bool ParseJobs(int argc, const char* const* argv, int* i, size_t* jobs) {
+  const char* value = argv[*i] + 2;
+  if (*value == '\0' && *i + 1 < argc) {
+    value = argv[++*i];
+  }
+  return ParseUint(value, jobs) && *jobs > 0;
+}
+
 unique_ptr<JavaOptions> java_usage() {
   fprintf(stderr,
           "usage: aidl OPTIONS INPUT [OUTPUT]\n"
-          "       aidl --preprocess OUTPUT INPUT...\n"
+          "       aidl OPTIONS --batch=BATCH_FILE\n"
+          "       aidl --preprocess [--binary] OUTPUT INPUT...\n"
+          "       aidl --server SOCKET\n"
+          "       aidl --stop-server SOCKET\n"
+          "       aidl --client SOCKET ARGS...\n"
           "\n"
           "OPTIONS:\n"
           "   -I<DIR>    search path for import statements.\n"
+          "   -I@<ZIP>   search path for import statements, in a zip archive.\n"
           "   -d<FILE>   generate dependency file.\n"
           "   -a         generate dependency file next to the output file with "
           "the name based on the input file.\n"
@@ -51,6 +72,40 @@ unique_ptr<JavaOptions> java_usage() {
           "   -t         include tracing code for systrace. Note that if either "
           "the client or server code is not auto-generated by this tool, that "
           "part will not be traced.\n"
+          "   --batch=BATCH_FILE\n"
+          "              compile every entry of BATCH_FILE in a single process, "
+          "loading preprocessed files and parsing each import at most once. "
+          "Each line of BATCH_FILE has the form: "
+          "[-d<FILE>] INPUT [OUTPUT]\n"
+          "   -j<N>      with --batch, compile the entries on N threads.\n"
+          "   --ast-cache=DIR\n"
+          "              keep parsed files in DIR, keyed by their contents, and "
+          "load them from there instead of parsing them again.\n"
+          "   --output-cache=DIR\n"
+          "              keep generated files in DIR, and copy them from there "
+          "instead of compiling again while the input, imports and "
+          "preprocessed files are unchanged.\n"
+          "   --index-import-roots\n"
+          "              list each import directory once, instead of looking "
+          "for every import in each of them.\n"
+          "   --write-if-changed\n"
+          "              leave generated files that would not change untouched, "
+          "and replace the others atomically.\n"
+          "   --srcjar=SRCJAR\n"
+          "              instead of -o, write the generated files into the "
+          "uncompressed zip archive SRCJAR, under their package folders.  "
+          "The archive is only written if every file is generated.\n"
+          "   --timings=FILE\n"
+          "              write the wall and CPU time spent in each phase of "
+          "compiling, in total and for the slowest inputs, to FILE as "
+          "JSON.\n"
+          "   --trace-out=FILE\n"
+          "              write a timeline of the compiler's work on each "
+          "thread to FILE, in the Chrome trace event format.\n"
+          "   --mem-stats=FILE\n"
+          "              count the allocations, bytes allocated and peak live "
+          "bytes of each phase of compiling, and write them to FILE as "
+          "JSON.\n"
           "\n"
           "INPUT:\n"
           "   An aidl interface file.\n"
@@ -60,7 +115,18 @@ unique_ptr<JavaOptions> java_usage() {
           "   If omitted and the -o option is not used, the input filename is "
           "used, with the .aidl extension changed to a .java extension.\n"
           "   If the -o option is used, the generated files will be placed in "
-          "the base output folder, under their package folder\n");
+          "the base output folder, under their package folder\n"
+          "\n"
+          "PREPROCESS:\n"
+          "   --preprocess lists the types declared in INPUT... for -p.  With "
+          "--binary, the list is written in an indexed binary format, from "
+          "which only the types used are loaded.  -p reads either format.\n"
+          "\n"
+          "SERVER:\n"
+          "   --server keeps running, compiling the command lines sent with "
+          "--client over the Unix domain socket SOCKET, and keeping types and "
+          "imports in memory between them.  ARGS is any aidl command line "
+          "other than these.  --stop-server stops the server.\n");
   return unique_ptr<JavaOptions>(nullptr);
 }
 
@@ -71,17 +137,47 @@ unique_ptr<JavaOptions> JavaOptions::Parse(int argc, const char* const* argv) {
   int i = 1;
 
   if (argc >= 2 && 0 == strcmp(argv[1], "--preprocess")) {
-    if (argc < 4) {
+    int first = 2;
+    if (argc >= 3 && 0 == strcmp(argv[2], "--binary")) {
+      options->preprocess_binary_ = true;
+      first = 3;
+    }
+    if (argc < first + 2) {
       return java_usage();
     }
-    options->output_file_name_ = argv[2];
-    for (int i = 3; i < argc; i++) {
+    options->output_file_name_ = argv[first];
+    for (int i = first + 1; i < argc; i++) {
       options->files_to_preprocess_.push_back(argv[i]);
     }
     options->task = PREPROCESS_AIDL;
     return options;
   }
 
+  if (argc >= 2 && (0 == strcmp(argv[1], "--server") ||
+                    0 == strcmp(argv[1], "--stop-server"))) {
+    if (argc != 3) {
+      return java_usage();
+    }
+    options->server_socket_ = argv[2];
+    options->task =
+        (0 == strcmp(argv[1], "--server")) ? RUN_SERVER : STOP_SERVER;
+    return options;
+  }
+
+  if (argc >= 2 && 0 == strcmp(argv[1], "--client")) {
+    if (argc < 3) {
+      return java_usage();
+    }
+    options->server_socket_ = argv[2];
+    // The server parses the arguments, and reports any problem with them.
+    options->server_args_.push_back("aidl");
+    for (int i = 3; i < argc; i++) {
+      options->server_args_.push_back(argv[i]);
+    }
+    options->task = COMPILE_ON_SERVER;
+    return options;
+  }
+
   options->task = COMPILE_AIDL_TO_JAVA;
   // OPTIONS
   while (i < argc) {
@@ -131,6 +227,58 @@ unique_ptr<JavaOptions> JavaOptions::Parse(int argc, const char* const* argv) {
       options->dep_file_ninja_ = true;
     } else if (strcmp(s, "-t") == 0) {
       options->gen_traces_ = true;
+    } else if (strncmp(s, "--batch=", strlen("--batch=")) == 0) {
+      options->batch_file_name_ = s + strlen("--batch=");
+      if (options->batch_file_name_.empty()) {
+        fprintf(stderr, "--batch option (%d) requires a file.\n", i);
+        return java_usage();
+      }
+    } else if (s[1] == 'j') {
+      if (!ParseJobs(argc, argv, &i, &options->jobs_)) {
+        fprintf(stderr, "-j option (%d) requires a positive number.\n", i);
+        return java_usage();
+      }
+    } else if (strncmp(s, "--ast-cache=", strlen("--ast-cache=")) == 0) {
+      options->ast_cache_dir_ = s + strlen("--ast-cache=");
+      if (options->ast_cache_dir_.empty()) {
+        fprintf(stderr, "--ast-cache option (%d) requires a directory.\n", i);
+        return java_usage();
+      }
+    } else if (strncmp(s, "--output-cache=", strlen("--output-cache=")) == 0) {
+      options->output_cache_dir_ = s + strlen("--output-cache=");
+      if (options->output_cache_dir_.empty()) {
+        fprintf(stderr, "--output-cache option (%d) requires a directory.\n",
+                i);
+        return java_usage();
+      }
+    } else if (strcmp(s, "--index-import-roots") == 0) {
+      options->index_import_roots_ = true;
+    } else if (strcmp(s, "--write-if-changed") == 0) {
+      options->write_only_if_changed_ = true;
+    } else if (strncmp(s, "--srcjar=", strlen("--srcjar=")) == 0) {
+      options->srcjar_file_ = s + strlen("--srcjar=");
+      if (options->srcjar_file_.empty()) {
+        fprintf(stderr, "--srcjar option (%d) requires a file.\n", i);
+        return java_usage();
+      }
+    } else if (strncmp(s, "--timings=", strlen("--timings=")) == 0) {
+      options->timings_file_ = s + strlen("--timings=");
+      if (options->timings_file_.empty()) {
+        fprintf(stderr, "--timings option (%d) requires a file.\n", i);
+        return java_usage();
+      }
+    } else if (strncmp(s, "--trace-out=", strlen("--trace-out=")) == 0) {
+      options->trace_file_ = s + strlen("--trace-out=");
+      if (options->trace_file_.empty()) {
+        fprintf(stderr, "--trace-out option (%d) requires a file.\n", i);
+        return java_usage();
+      }
+    } else if (strncmp(s, "--mem-stats=", strlen("--mem-stats=")) == 0) {
+      options->mem_stats_file_ = s + strlen("--mem-stats=");
+      if (options->mem_stats_file_.empty()) {
+        fprintf(stderr, "--mem-stats option (%d) requires a file.\n", i);
+        return java_usage();
+      }
     } else {
       // s[1] is not known
       fprintf(stderr, "unknown option (%d): %s\n", i, s);
@@ -138,6 +286,27 @@ unique_ptr<JavaOptions> JavaOptions::Parse(int argc, const char* const* argv) {
     }
     i++;
   }
+  if (!options->srcjar_file_.empty()) {
+    if (!options->output_base_folder_.empty()) {
+      fprintf(stderr, "-o cannot be used with --srcjar.\n");
+      return java_usage();
+    }
+    // Files are laid out in the archive as -o lays them out on disk.
+    options->output_base_folder_ = options->srcjar_file_;
+  }
+  if (options->IsBatch()) {
+    // Inputs and outputs all come from the batch file.
+    if (i != argc) {
+      fprintf(stderr, "INPUT cannot be used with --batch\n");
+      return java_usage();
+    }
+    if (!options->dep_file_name_.empty()) {
+      fprintf(stderr, "-d cannot be used with --batch, give a -d<FILE> for "
+                      "each entry instead.\n");
+      return java_usage();
+    }
+    return options;
+  }
   // INPUT
   if (i < argc) {
     options->input_file_name_ = argv[i];
@@ -180,6 +349,60 @@ unique_ptr<JavaOptions> JavaOptions::Parse(int argc, const char* const* argv) {
   return options;
 }
 
+unique_ptr<JavaOptions> JavaOptions::ParseBatchEntry(
+    const string& line) const {
+  unique_ptr<JavaOptions> entry(new JavaOptions());
+  entry->fail_on_parcelable_ = fail_on_parcelable_;
+  entry->import_paths_ = import_paths_;
+  // Preprocessed files are loaded once for the whole batch, not per entry.
+  entry->output_base_folder_ = output_base_folder_;
+  entry->auto_dep_file_ = auto_dep_file_;
+  entry->dep_file_ninja_ = dep_file_ninja_;
+  entry->gen_traces_ = gen_traces_;
+  entry->jobs_ = jobs_;
+  entry->ast_cache_dir_ = ast_cache_dir_;
+  entry->output_cache_dir_ = output_cache_dir_;
+  entry->index_import_roots_ = index_import_roots_;
+  entry->srcjar_file_ = srcjar_file_;
+  entry->onTransact_outline_threshold_ = onTransact_outline_threshold_;
+  entry->onTransact_non_outline_count_ = onTransact_non_outline_count_;
+
+  vector<string> positional;
+  for (const string& piece : Split(line, " \t")) {
+    if (piece.empty()) {
+      continue;
+    }
+    if (piece.compare(0, 2, "-d") == 0 && piece.length() > 2) {
+      entry->dep_file_name_ = piece.substr(2);
+    } else if (piece[0] == '-') {
+      cerr << "unknown option in batch entry: " << piece << endl;
+      return nullptr;
+    } else {
+      positional.push_back(piece);
+    }
+  }
+  if (positional.empty() || positional.size() > 2) {
+    cerr << "Expected INPUT [OUTPUT] in batch entry but got "
+         << positional.size() << " arguments." << endl;
+    return nullptr;
+  }
+
+  entry->input_file_name_ = positional[0];
+  if (!EndsWith(entry->input_file_name_, ".aidl")) {
+    cerr << "Expected .aidl file for input but got "
+         << entry->input_file_name_ << endl;
+    return nullptr;
+  }
+  if (positional.size() == 2) {
+    entry->output_file_name_ = positional[1];
+  } else if (entry->output_base_folder_.empty()) {
+    entry->output_file_name_ = entry->input_file_name_;
+    ReplaceSuffix(".aidl", ".java", &entry->output_file_name_);
+  }
+
+  return entry;
+}
+
 string JavaOptions::DependencyFilePath() const {
   if (auto_dep_file_) {
     return output_file_name_ + ".d";
@@ -191,22 +414,58 @@ namespace {
 
 unique_ptr<CppOptions> cpp_usage() {
   cerr << "usage: aidl-cpp INPUT_FILE HEADER_DIR OUTPUT_FILE" << endl
+       << "       aidl-cpp --batch=BATCH_FILE" << endl
+       << "       aidl-cpp --client SOCKET ARGS..." << endl
        << endl
        << "OPTIONS:" << endl
        << "   -I<DIR>   search path for import statements" << endl
+       << "   -I@<ZIP>  search path for import statements, in a zip archive"
+       << endl
        << "   -d<FILE>  generate dependency file" << endl
        << "   -t        include tracing code for systrace. Note that if the "
           "client or server code is not auto-generated by this tool, that part "
           "will not be traced." << endl
        << "   -ninja    generate dependency file in a format ninja "
           "understands" << endl
+       << "   --batch=BATCH_FILE" << endl
+       << "             compile every entry of BATCH_FILE in a single process, "
+          "parsing each import at most once.  Each line of BATCH_FILE has the "
+          "form: INPUT_FILE HEADER_DIR OUTPUT_FILE [DEP_FILE]" << endl
+       << "   -j<N>     with --batch, compile the entries on N threads" << endl
+       << "   --ast-cache=DIR" << endl
+       << "             keep parsed files in DIR, keyed by their contents, and "
+          "load them from there instead of parsing them again" << endl
+       << "   --output-cache=DIR" << endl
+       << "             keep generated files in DIR, and copy them from there "
+          "instead of compiling again while the input and imports are "
+          "unchanged" << endl
+       << "   --index-import-roots" << endl
+       << "             list each import directory once, instead of looking "
+          "for every import in each of them" << endl
+       << "   --write-if-changed" << endl
+       << "             leave generated files that would not change untouched, "
+          "and replace the others atomically" << endl
+       << "   --timings=FILE" << endl
+       << "             write the wall and CPU time spent in each phase of "
+          "compiling, in total and for the slowest inputs, to FILE as JSON"
+       << endl
+       << "   --trace-out=FILE" << endl
+       << "             write a timeline of the compiler's work on each thread "
+          "to FILE, in the Chrome trace event format" << endl
+       << "   --mem-stats=FILE" << endl
+       << "             count the allocations, bytes allocated and peak live "
+          "bytes of each phase of compiling, and write them to FILE as JSON"
+       << endl
        << endl
        << "INPUT_FILE:" << endl
        << "   an aidl interface file" << endl
        << "HEADER_DIR:" << endl
        << "   empty directory to put generated headers" << endl
        << "OUTPUT_FILE:" << endl
-       << "   path to write generated .cpp code" << endl;
+       << "   path to write generated .cpp code" << endl
+       << "SOCKET:" << endl
+       << "   socket of a server started with 'aidl --server SOCKET', to "
+          "send the aidl-cpp command line ARGS to" << endl;
   return unique_ptr<CppOptions>(nullptr);
 }
 
@@ -216,6 +475,18 @@ unique_ptr<CppOptions> CppOptions::Parse(int argc, const char* const* argv) {
   unique_ptr<CppOptions> options(new CppOptions());
   int i = 1;
 
+  if (argc >= 2 && strcmp(argv[1], "--client") == 0) {
+    if (argc < 3) {
+      return cpp_usage();
+    }
+    options->server_socket_ = argv[2];
+    // The server parses the arguments, and reports any problem with them.
+    options->server_args_.push_back("aidl-cpp");
+    options->server_args_.insert(options->server_args_.end(), argv + 3,
+                                 argv + argc);
+    return options;
+  }
+
   // Parse flags, all of which start with '-'
   for ( ; i < argc; ++i) {
     const size_t len = strlen(argv[i]);
@@ -228,7 +499,52 @@ unique_ptr<CppOptions> CppOptions::Parse(int argc, const char* const* argv) {
       return cpp_usage();
     }
     const string the_rest = s + 2;
-    if (s[1] == 'I') {
+    if (strncmp(s, "--batch=", strlen("--batch=")) == 0) {
+      options->batch_file_name_ = s + strlen("--batch=");
+      if (options->batch_file_name_.empty()) {
+        cerr << "--batch requires a file." << endl;
+        return cpp_usage();
+      }
+    } else if (s[1] == 'j') {
+      if (!ParseJobs(argc, argv, &i, &options->jobs_)) {
+        cerr << "-j requires a positive number of threads." << endl;
+        return cpp_usage();
+      }
+    } else if (strncmp(s, "--ast-cache=", strlen("--ast-cache=")) == 0) {
+      options->ast_cache_dir_ = s + strlen("--ast-cache=");
+      if (options->ast_cache_dir_.empty()) {
+        cerr << "--ast-cache requires a directory." << endl;
+        return cpp_usage();
+      }
+    } else if (strncmp(s, "--output-cache=", strlen("--output-cache=")) == 0) {
+      options->output_cache_dir_ = s + strlen("--output-cache=");
+      if (options->output_cache_dir_.empty()) {
+        cerr << "--output-cache requires a directory." << endl;
+        return cpp_usage();
+      }
+    } else if (strcmp(s, "--index-import-roots") == 0) {
+      options->index_import_roots_ = true;
+    } else if (strcmp(s, "--write-if-changed") == 0) {
+      options->write_only_if_changed_ = true;
+    } else if (strncmp(s, "--timings=", strlen("--timings=")) == 0) {
+      options->timings_file_ = s + strlen("--timings=");
+      if (options->timings_file_.empty()) {
+        cerr << "--timings requires a file." << endl;
+        return cpp_usage();
+      }
+    } else if (strncmp(s, "--trace-out=", strlen("--trace-out=")) == 0) {
+      options->trace_file_ = s + strlen("--trace-out=");
+      if (options->trace_file_.empty()) {
+        cerr << "--trace-out requires a file." << endl;
+        return cpp_usage();
+      }
+    } else if (strncmp(s, "--mem-stats=", strlen("--mem-stats=")) == 0) {
+      options->mem_stats_file_ = s + strlen("--mem-stats=");
+      if (options->mem_stats_file_.empty()) {
+        cerr << "--mem-stats requires a file." << endl;
+        return cpp_usage();
+      }
+    } else if (s[1] == 'I') {
       options->import_paths_.push_back(the_rest);
     } else if (s[1] == 'd') {
       options->dep_file_name_ = the_rest;
@@ -242,8 +558,23 @@ unique_ptr<CppOptions> CppOptions::Parse(int argc, const char* const* argv) {
     }
   }
 
-  // There are exactly three positional arguments.
   const int remaining_args = argc - i;
+  if (options->IsBatch()) {
+    // Inputs and outputs all come from the batch file.
+    if (remaining_args != 0) {
+      cerr << "Expected no positional arguments with --batch but got "
+           << remaining_args << "." << endl;
+      return cpp_usage();
+    }
+    if (!options->dep_file_name_.empty()) {
+      cerr << "-d cannot be used with --batch, give a DEP_FILE for each entry "
+              "instead." << endl;
+      return cpp_usage();
+    }
+    return options;
+  }
+
+  // There are exactly three positional arguments.
   if (remaining_args != 3) {
     cerr << "Expected 3 positional arguments but got " << remaining_args << "." << endl;
     return cpp_usage();
@@ -261,6 +592,43 @@ unique_ptr<CppOptions> CppOptions::Parse(int argc, const char* const* argv) {
   return options;
 }
 
+unique_ptr<CppOptions> CppOptions::ParseBatchEntry(const string& line) const {
+  vector<string> args;
+  for (const string& piece : Split(line, " \t")) {
+    if (!piece.empty()) {
+      args.push_back(piece);
+    }
+  }
+  if (args.size() != 3 && args.size() != 4) {
+    cerr << "Expected 3 or 4 fields in batch entry but got " << args.size()
+         << "." << endl;
+    return nullptr;
+  }
+
+  unique_ptr<CppOptions> entry(new CppOptions());
+  entry->import_paths_ = import_paths_;
+  entry->gen_traces_ = gen_traces_;
+  entry->jobs_ = jobs_;
+  entry->ast_cache_dir_ = ast_cache_dir_;
+  entry->output_cache_dir_ = output_cache_dir_;
+  entry->index_import_roots_ = index_import_roots_;
+  entry->dep_file_ninja_ = dep_file_ninja_;
+  entry->input_file_name_ = args[0];
+  entry->output_header_dir_ = args[1];
+  entry->output_file_name_ = args[2];
+  if (args.size() == 4) {
+    entry->dep_file_name_ = args[3];
+  }
+
+  if (!EndsWith(entry->input_file_name_, ".aidl")) {
+    cerr << "Expected .aidl file for input but got " << entry->input_file_name_
+         << endl;
+    return nullptr;
+  }
+
+  return entry;
+}
+
 bool EndsWith(const string& str, const string& suffix) {
   if (str.length() < suffix.length()) {
     return false;
@@ -32,6 +32,9 @@ class JavaOptions final {
   enum {
       COMPILE_AIDL_TO_JAVA,
       PREPROCESS_AIDL,
+      RUN_SERVER,
+      STOP_SERVER,
+      COMPILE_ON_SERVER,
   };
 
   ~JavaOptions() = default;
@@ -41,6 +44,13 @@ class JavaOptions final {
   // Prints the usage statement on failure.
   static std::unique_ptr<JavaOptions> Parse(int argc, const char* const* argv);
 
+  // Returns options for a single entry of the batch file, inheriting the
+  // shared flags from these options.  Each entry has the form:
+  //   [-d<DEP_FILE>] INPUT_FILE [OUTPUT_FILE]
+  // Returns nullptr if |line| is malformed.
+  std::unique_ptr<JavaOptions> ParseBatchEntry(const std::string& line) const;
+  bool IsBatch() const { return !batch_file_name_.empty(); }
+
   std::string DependencyFilePath() const;
   bool DependencyFileNinja() const { return dep_file_ninja_; }
 
@@ -55,7 +65,29 @@ class JavaOptions final {
   bool auto_dep_file_{false};
   bool dep_file_ninja_{false};
   bool gen_traces_{false};
+  std::string batch_file_name_;
+  // Number of threads compiling the entries of a batch.
+  size_t jobs_{1u};
+  std::string ast_cache_dir_;
+  std::string output_cache_dir_;
+  bool index_import_roots_{false};
+  // Only replace generated files whose contents change.
+  bool write_only_if_changed_{false};
+  // Archive that takes the files otherwise written below
+  // |output_base_folder_|, which is set to it.
+  std::string srcjar_file_;
+  // Report of the time spent in each phase of compiling.
+  std::string timings_file_;
+  // Chrome trace of the compiler's work.
+  std::string trace_file_;
+  // Report of the memory allocated in each phase of compiling.
+  std::string mem_stats_file_;
   std::vector<std::string> files_to_preprocess_;
+  // Write the preprocessed file in the binary format.
+  bool preprocess_binary_{false};
+  // Socket of the compile server to run, stop or send |server_args_| to.
+  std::string server_socket_;
+  std::vector<std::string> server_args_;
 
   // The following are for testability, but cannot be influenced on the command line.
 
@@ -89,6 +121,38 @@ class CppOptions final {
   // Prints the usage statement on failure.
   static std::unique_ptr<CppOptions> Parse(int argc, const char* const* argv);
 
+  // Returns options for a single entry of the batch file, inheriting the
+  // shared flags (import paths, tracing, ninja) from these options.
+  // Each entry has the form: INPUT_FILE HEADER_DIR OUTPUT_FILE [DEP_FILE]
+  // Returns nullptr if |line| is malformed.
+  std::unique_ptr<CppOptions> ParseBatchEntry(const std::string& line) const;
+
+  // True if the command line is to be forwarded to a compile server.
+  bool IsClient() const { return !server_socket_.empty(); }
+  std::string ServerSocket() const { return server_socket_; }
+  std::vector<std::string> ServerArgs() const { return server_args_; }
+
+  std::string BatchFilePath() const { return batch_file_name_; }
+  bool IsBatch() const { return !batch_file_name_.empty(); }
+  // Number of threads compiling the entries of a batch.
+  size_t Jobs() const { return jobs_; }
+  // Directory of the AstCache to use, if any.
+  std::string AstCacheDir() const { return ast_cache_dir_; }
+  // Directory of the OutputCache to use, if any.
+  std::string OutputCacheDir() const { return output_cache_dir_; }
+  // True if each import root is to be listed once, rather than probed for
+  // each import.
+  bool IndexImportRoots() const { return index_import_roots_; }
+  // True if generated files are only to be replaced when their contents
+  // change.
+  bool WriteOnlyIfChanged() const { return write_only_if_changed_; }
+  // File to write a report of the time spent in each phase to, if any.
+  std::string TimingsFile() const { return timings_file_; }
+  // File to write a Chrome trace of the compiler's work to, if any.
+  std::string TraceFile() const { return trace_file_; }
+  // File to write a report of the memory allocated in each phase to, if any.
+  std::string MemStatsFile() const { return mem_stats_file_; }
+
   std::string InputFileName() const { return input_file_name_; }
   std::string OutputHeaderDir() const { return output_header_dir_; }
   std::string OutputCppFilePath() const { return output_file_name_; }
@@ -106,11 +170,23 @@ class CppOptions final {
   std::string output_header_dir_;
   std::string output_file_name_;
   std::string dep_file_name_;
+  std::string batch_file_name_;
+  size_t jobs_{1u};
+  std::string ast_cache_dir_;
+  std::string output_cache_dir_;
+  std::string timings_file_;
+  std::string trace_file_;
+  std::string mem_stats_file_;
+  std::string server_socket_;
+  std::vector<std::string> server_args_;
   bool gen_traces_{false};
   bool dep_file_ninja_{false};
+  bool index_import_roots_{false};
+  bool write_only_if_changed_{false};
 
   FRIEND_TEST(CppOptionsTests, ParsesCompileCpp);
   FRIEND_TEST(CppOptionsTests, ParsesCompileCppNinja);
+  FRIEND_TEST(CppOptionsTests, ParsesCompileCppBatch);
   DISALLOW_COPY_AND_ASSIGN(CppOptions);
 };
 
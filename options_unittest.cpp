@@ -89,6 +89,16 @@ const char* kCompileCppCommandNinja[] = {
     nullptr,
 };
 
+const char kCompileCppBatchFile[] = "--batch=batch/file";
+const char* kCompileCppBatchCommand[] = {
+    "aidl-cpp",
+    kCompileCommandIncludePath,
+    kCompileDepFileNinja,
+    "-j4",
+    kCompileCppBatchFile,
+    nullptr,
+};
+
 template <typename T>
 unique_ptr<T> GetOptions(const char* command[]) {
   int argc = 0;
@@ -123,6 +133,30 @@ TEST(JavaOptionsTests, ParsesPreprocess) {
   EXPECT_EQ(expected_input, options->files_to_preprocess_);
 }
 
+TEST(JavaOptionsTests, ParsesBinaryPreprocess) {
+  const char* argv[] = {"aidl", "--preprocess", "--binary", "out", "in"};
+  unique_ptr<JavaOptions> options = JavaOptions::Parse(5, argv);
+  ASSERT_NE(nullptr, options);
+  EXPECT_EQ(JavaOptions::PREPROCESS_AIDL, options->task);
+  EXPECT_TRUE(options->preprocess_binary_);
+  EXPECT_EQ("out", options->output_file_name_);
+  EXPECT_EQ(vector<string>{"in"}, options->files_to_preprocess_);
+  const char* missing_input[] = {"aidl", "--preprocess", "--binary", "out"};
+  EXPECT_EQ(nullptr, JavaOptions::Parse(4, missing_input));
+}
+
+TEST(JavaOptionsTests, ParsesTimings) {
+  const char* argv[] = {"aidl", "--timings=t.json", "--trace-out=trace.json",
+                        "--mem-stats=mem.json", "p/IFoo.aidl"};
+  unique_ptr<JavaOptions> options = JavaOptions::Parse(5, argv);
+  ASSERT_NE(nullptr, options);
+  EXPECT_EQ("t.json", options->timings_file_);
+  EXPECT_EQ("trace.json", options->trace_file_);
+  EXPECT_EQ("mem.json", options->mem_stats_file_);
+  const char* empty[] = {"aidl", "--timings=", "p/IFoo.aidl"};
+  EXPECT_EQ(nullptr, JavaOptions::Parse(3, empty));
+}
+
 TEST(JavaOptionsTests, ParsesCompileJava) {
   unique_ptr<JavaOptions> options =
       GetOptions<JavaOptions>(kCompileJavaCommand);
@@ -149,6 +183,37 @@ TEST(JavaOptionsTests, ParsesCompileJavaNinja) {
   EXPECT_EQ(true, options->DependencyFileNinja());
 }
 
+TEST(JavaOptionsTests, ParsesCompileJavaBatch) {
+  const char* command[] = {
+      "aidl", "-b", kCompileCommandIncludePath, "-oout", "-j", "8",
+      "--batch=batch/file", nullptr,
+  };
+  unique_ptr<JavaOptions> options = GetOptions<JavaOptions>(command);
+  ASSERT_NE(nullptr, options);
+  EXPECT_TRUE(options->IsBatch());
+  EXPECT_EQ("batch/file", options->batch_file_name_);
+  EXPECT_EQ(8u, options->jobs_);
+
+  unique_ptr<JavaOptions> entry =
+      options->ParseBatchEntry("-dentry.d  directory/ITool.aidl");
+  ASSERT_NE(nullptr, entry);
+  EXPECT_FALSE(entry->IsBatch());
+  EXPECT_EQ(true, entry->fail_on_parcelable_);
+  EXPECT_EQ(options->import_paths_, entry->import_paths_);
+  EXPECT_EQ(string{kCompileCommandInput}, entry->input_file_name_);
+  EXPECT_EQ(string{}, entry->output_file_name_);
+  EXPECT_EQ("out", entry->output_base_folder_);
+  EXPECT_EQ("entry.d", entry->DependencyFilePath());
+
+  entry = options->ParseBatchEntry("directory/ITool.aidl ITool.java");
+  ASSERT_NE(nullptr, entry);
+  EXPECT_EQ("ITool.java", entry->output_file_name_);
+
+  EXPECT_EQ(nullptr, options->ParseBatchEntry(""));
+  EXPECT_EQ(nullptr, options->ParseBatchEntry("ITool.java"));
+  EXPECT_EQ(nullptr, options->ParseBatchEntry("-x directory/ITool.aidl"));
+}
+
 TEST(CppOptionsTests, ParsesCompileCpp) {
   unique_ptr<CppOptions> options = GetOptions<CppOptions>(kCompileCppCommand);
   ASSERT_EQ(1u, options->import_paths_.size());
@@ -173,6 +238,106 @@ TEST(CppOptionsTests, ParsesCompileCppNinja) {
   EXPECT_EQ(kCompileCommandCppOutput, options->OutputCppFilePath());
 }
 
+TEST(CppOptionsTests, ParsesCompileCppBatch) {
+  unique_ptr<CppOptions> options =
+      GetOptions<CppOptions>(kCompileCppBatchCommand);
+  ASSERT_NE(nullptr, options);
+  EXPECT_TRUE(options->IsBatch());
+  EXPECT_EQ(string{kCompileCppBatchFile}.substr(8), options->BatchFilePath());
+  EXPECT_EQ(4u, options->Jobs());
+
+  unique_ptr<CppOptions> entry = options->ParseBatchEntry(
+      string{kCompileCommandInput} + " " + kCompileCommandHeaderDir + "\t" +
+      kCompileCommandCppOutput + " entry.deps");
+  ASSERT_NE(nullptr, entry);
+  EXPECT_FALSE(entry->IsBatch());
+  EXPECT_EQ(options->ImportPaths(), entry->ImportPaths());
+  EXPECT_EQ(true, entry->DependencyFileNinja());
+  EXPECT_EQ(kCompileCommandInput, entry->InputFileName());
+  EXPECT_EQ(kCompileCommandHeaderDir, entry->OutputHeaderDir());
+  EXPECT_EQ(kCompileCommandCppOutput, entry->OutputCppFilePath());
+  EXPECT_EQ("entry.deps", entry->DependencyFilePath());
+
+  EXPECT_EQ(nullptr, options->ParseBatchEntry(kCompileCommandInput));
+  EXPECT_EQ(nullptr, options->ParseBatchEntry("IFoo.java out/dir out.cpp"));
+}
+
+TEST(CppOptionsTests, ParsesTimings) {
+  const char* argv[] = {"aidl-cpp", "--timings=t.json",
+                        "--trace-out=trace.json", "--mem-stats=mem.json",
+                        kCompileCommandInput, kCompileCommandHeaderDir,
+                        kCompileCommandCppOutput};
+  unique_ptr<CppOptions> options = CppOptions::Parse(7, argv);
+  ASSERT_NE(nullptr, options);
+  EXPECT_EQ("t.json", options->TimingsFile());
+  EXPECT_EQ("trace.json", options->TraceFile());
+  EXPECT_EQ("mem.json", options->MemStatsFile());
+}
+
+TEST(CppOptionsTests, RejectsBadJobs) {
+  const char* zero_jobs[] = {"aidl-cpp", "-j0", kCompileCppBatchFile, nullptr};
+  EXPECT_EQ(nullptr, CppOptions::Parse(3, zero_jobs));
+  const char* no_jobs[] = {"aidl-cpp", kCompileCppBatchFile, "-j", nullptr};
+  EXPECT_EQ(nullptr, CppOptions::Parse(3, no_jobs));
+}
+
+TEST(JavaOptionsTests, ParsesServerModes) {
+  const char* serve[] = {"aidl", "--server", "aidl.sock", nullptr};
+  unique_ptr<JavaOptions> options = GetOptions<JavaOptions>(serve);
+  ASSERT_NE(nullptr, options);
+  EXPECT_EQ(JavaOptions::RUN_SERVER, options->task);
+  EXPECT_EQ("aidl.sock", options->server_socket_);
+
+  const char* client[] = {"aidl", "--client", "aidl.sock", "-b",
+                          kCompileCommandInput, nullptr};
+  options = GetOptions<JavaOptions>(client);
+  ASSERT_NE(nullptr, options);
+  EXPECT_EQ(JavaOptions::COMPILE_ON_SERVER, options->task);
+  EXPECT_EQ("aidl.sock", options->server_socket_);
+  const vector<string> expected_args{"aidl", "-b", kCompileCommandInput};
+  EXPECT_EQ(expected_args, options->server_args_);
+}
+
+TEST(CppOptionsTests, ParsesClient) {
+  const char* client[] = {"aidl-cpp", "--client", "aidl.sock",
+                          kCompileCommandInput, nullptr};
+  unique_ptr<CppOptions> options = GetOptions<CppOptions>(client);
+  ASSERT_NE(nullptr, options);
+  EXPECT_TRUE(options->IsClient());
+  EXPECT_EQ("aidl.sock", options->ServerSocket());
+  const vector<string> expected_args{"aidl-cpp", kCompileCommandInput};
+  EXPECT_EQ(expected_args, options->ServerArgs());
+}
+
+TEST(CppOptionsTests, ParsesAstCache) {
+  const char* command[] = {"aidl-cpp", "--ast-cache=out/ast",
+                           kCompileCommandInput, "out/include", "out/IFoo.cpp",
+                           nullptr};
+  unique_ptr<CppOptions> options = GetOptions<CppOptions>(command);
+  ASSERT_NE(nullptr, options);
+  EXPECT_EQ("out/ast", options->AstCacheDir());
+
+  const char* empty[] = {"aidl-cpp", "--ast-cache=", kCompileCommandInput,
+                         "out/include", "out/IFoo.cpp", nullptr};
+  EXPECT_EQ(nullptr, CppOptions::Parse(5, empty));
+}
+
+TEST(JavaOptionsTests, ParsesSrcjar) {
+  const char* command[] = {"aidl", "--srcjar=out/gen.srcjar",
+                           kCompileCommandInput, nullptr};
+  unique_ptr<JavaOptions> options = GetOptions<JavaOptions>(command);
+  ASSERT_NE(nullptr, options);
+  EXPECT_EQ("out/gen.srcjar", options->srcjar_file_);
+  EXPECT_EQ("out/gen.srcjar", options->output_base_folder_);
+  EXPECT_EQ("", options->output_file_name_);
+
+  const char* with_folder[] = {"aidl", "-oout", "--srcjar=out/gen.srcjar",
+                               kCompileCommandInput, nullptr};
+  EXPECT_EQ(nullptr, JavaOptions::Parse(4, with_folder));
+  const char* empty[] = {"aidl", "--srcjar=", kCompileCommandInput, nullptr};
+  EXPECT_EQ(nullptr, JavaOptions::Parse(3, empty));
+}
+
 TEST(OptionsTests, EndsWith) {
   EXPECT_TRUE(EndsWith("foo", ""));
   EXPECT_TRUE(EndsWith("foo", "o"));
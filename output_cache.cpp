@@ -0,0 +1,452 @@
+/*
+ * Copyright (C) 2018, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "output_cache.h"
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <fstream>
+#include <functional>
+#include <utility>
+
+#if defined(__linux__)
+#include <link.h>
+#elif defined(__APPLE__)
+#include <limits.h>
+#include <mach-o/dyld.h>
+#elif defined(_WIN32)
+#include <windows.h>
+#endif
+
+#include <android-base/stringprintf.h>
+
+#include "logging.h"
+#include "os.h"
+#include "sha256.h"
+
+using android::base::StringAppendV;
+using std::map;
+using std::pair;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+namespace android {
+namespace aidl {
+namespace {
+
+// Identifies the format of cache entries.  The code generators are told
+// apart by CompilerId() instead.
+const char kMagic[] = "AIDLOUT1";
+
+#if defined(__linux__)
+// Stores the GNU build ID of the main executable, as hex, to |*id|.
+int FindBuildId(struct dl_phdr_info* info, size_t, void* id) {
+  // The main executable comes first.
+  for (int i = 0; i < info->dlpi_phnum; ++i) {
+    const ElfW(Phdr)& segment = info->dlpi_phdr[i];
+    if (segment.p_type != PT_NOTE) {
+      continue;
+    }
+    const char* note =
+        reinterpret_cast<const char*>(info->dlpi_addr + segment.p_vaddr);
+    const char* end = note + segment.p_memsz;
+    while (note + sizeof(ElfW(Nhdr)) <= end) {
+      const ElfW(Nhdr)* header = reinterpret_cast<const ElfW(Nhdr)*>(note);
+      const char* name = note + sizeof(ElfW(Nhdr));
+      const char* desc = name + ((header->n_namesz + 3) & ~3u);
+      if (header->n_type == NT_GNU_BUILD_ID && header->n_namesz == 4 &&
+          memcmp(name, "GNU", 4) == 0 && desc + header->n_descsz <= end) {
+        string* hex = static_cast<string*>(id);
+        for (size_t j = 0; j < header->n_descsz; ++j) {
+          android::base::StringAppendF(hex, "%02x",
+                                       static_cast<uint8_t>(desc[j]));
+        }
+        return 1;
+      }
+      note = desc + ((header->n_descsz + 3) & ~3u);
+    }
+  }
+  return 1;
+}
+#endif
+
+string ExecutablePath() {
+#if defined(__linux__)
+  return "/proc/self/exe";
+#elif defined(__APPLE__)
+  char path[PATH_MAX];
+  uint32_t size = sizeof(path);
+  return (_NSGetExecutablePath(path, &size) == 0) ? path : "";
+#elif defined(_WIN32)
+  char path[MAX_PATH];
+  const DWORD length = GetModuleFileNameA(nullptr, path, sizeof(path));
+  return (length > 0 && length < sizeof(path)) ? string(path, length) : "";
+#else
+  return "";
+#endif
+}
+
+string ComputeCompilerId() {
+  string id;
+#if defined(__linux__)
+  dl_iterate_phdr(FindBuildId, &id);
+  if (!id.empty()) {
+    return "build-id:" + id;
+  }
+#endif
+  const string path = ExecutablePath();
+  std::ifstream executable(path, std::ios::binary);
+  if (path.empty() || !executable) {
+    return "";
+  }
+  Sha256 hash;
+  char buffer[64 * 1024];
+  while (executable.read(buffer, sizeof(buffer)) || executable.gcount() > 0) {
+    hash.Update(buffer, executable.gcount());
+  }
+  return "sha256:" + hash.HexDigest();
+}
+
+// Writes through to another CodeWriter, and hands everything written to
+// |on_close| once closed or destroyed.
+class RecordingCodeWriter : public CodeWriter {
+ public:
+  RecordingCodeWriter(CodeWriterPtr writer,
+                      std::function<void(const string&)> on_close)
+      : writer_(std::move(writer)),
+        on_close_(on_close) {}
+  virtual ~RecordingCodeWriter() { Close(); }
+
+  bool Write(const char* format, ...) override {
+    string chunk;
+    va_list ap;
+    va_start(ap, format);
+    StringAppendV(&chunk, format, ap);
+    va_end(ap);
+    return AppendBytes(chunk.data(), chunk.size());
+  }
+
+  bool AppendBytes(const char* data, size_t length) override {
+    contents_.append(data, length);
+    return writer_->AppendBytes(data, length);
+  }
+
+  bool Close() override {
+    if (!closed_) {
+      closed_ = true;
+      success_ = writer_->Close();
+      on_close_(contents_);
+    }
+    return success_;
+  }
+
+ private:
+  CodeWriterPtr writer_;
+  std::function<void(const string&)> on_close_;
+  string contents_;
+  bool closed_ = false;
+  bool success_ = false;
+};  // class RecordingCodeWriter
+
+void WriteUint(uint32_t value, string* out) {
+  for (int i = 0; i < 4; ++i) {
+    out->push_back(static_cast<char>(value >> (8 * i)));
+  }
+}
+
+void WriteString(const string& value, string* out) {
+  WriteUint(value.size(), out);
+  out->append(value);
+}
+
+// Reads what WriteUint() and WriteString() wrote.  Once anything is out of
+// bounds, every read fails, and Ok() returns false.
+class EntryReader {
+ public:
+  EntryReader(const char* data, size_t length)
+      : data_(data), remaining_(length) {}
+
+  bool Ok() const { return ok_; }
+  bool AtEnd() const { return remaining_ == 0; }
+
+  uint32_t ReadUint() {
+    if (!Check(4)) {
+      return 0;
+    }
+    uint32_t value = 0;
+    for (int i = 0; i < 4; ++i) {
+      value |= uint32_t{static_cast<uint8_t>(data_[i])} << (8 * i);
+    }
+    Skip(4);
+    return value;
+  }
+  string ReadString() {
+    const uint32_t length = ReadUint();
+    if (!Check(length)) {
+      return "";
+    }
+    string value(data_, length);
+    Skip(length);
+    return value;
+  }
+
+ private:
+  bool Check(size_t length) {
+    ok_ = ok_ && length <= remaining_;
+    return ok_;
+  }
+  void Skip(size_t length) {
+    data_ += length;
+    remaining_ -= length;
+  }
+
+  const char* data_;
+  size_t remaining_;
+  bool ok_ = true;
+};
+
+// A file the outputs were generated from.
+struct Dependency {
+  // The class the file was imported for, or empty for preprocessed files.
+  string needed_class;
+  string path;
+  string contents_hash;
+};
+
+}  // namespace
+
+unique_ptr<string> OutputRecorder::GetFileContents(
+    const string& filename, const string& content_suffix) const {
+  return io_delegate_.GetFileContents(filename, content_suffix);
+}
+
+unique_ptr<SourceBuffer> OutputRecorder::GetSourceBuffer(
+    const string& filename) const {
+  return io_delegate_.GetSourceBuffer(filename);
+}
+
+unique_ptr<LineReader> OutputRecorder::GetLineReader(
+    const string& file_path) const {
+  return io_delegate_.GetLineReader(file_path);
+}
+
+bool OutputRecorder::FileIsReadable(const string& path) const {
+  return io_delegate_.FileIsReadable(path);
+}
+
+bool OutputRecorder::ListFiles(const string& dir,
+                               vector<string>* files) const {
+  return io_delegate_.ListFiles(dir, files);
+}
+
+bool OutputRecorder::GetModificationTime(const string& path,
+                                         int64_t* mtime) const {
+  return io_delegate_.GetModificationTime(path, mtime);
+}
+
+bool OutputRecorder::GetFileSize(const string& path, int64_t* size) const {
+  return io_delegate_.GetFileSize(path, size);
+}
+
+bool OutputRecorder::CreatedNestedDirs(
+    const string& base_dir, const vector<string>& nested_subdirs) const {
+  return io_delegate_.CreatedNestedDirs(base_dir, nested_subdirs);
+}
+
+unique_ptr<CodeWriter> OutputRecorder::GetCodeWriter(
+    const string& file_path) const {
+  CodeWriterPtr writer = io_delegate_.GetCodeWriter(file_path);
+  if (!writer) {
+    return writer;
+  }
+  return CodeWriterPtr(new RecordingCodeWriter(
+      std::move(writer),
+      [this, file_path](const string& contents) {
+        Record(file_path, contents);
+      }));
+}
+
+void OutputRecorder::RemovePath(const string& file_path) const {
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    outputs_.erase(file_path);
+  }
+  io_delegate_.RemovePath(file_path);
+}
+
+bool OutputRecorder::WriteFileAtomically(const string& path,
+                                         const string& contents) const {
+  if (!io_delegate_.WriteFileAtomically(path, contents)) {
+    return false;
+  }
+  Record(path, contents);
+  return true;
+}
+
+map<string, string> OutputRecorder::GetOutputs() const {
+  std::lock_guard<std::mutex> guard(lock_);
+  return outputs_;
+}
+
+void OutputRecorder::Record(const string& path, const string& contents) const {
+  std::lock_guard<std::mutex> guard(lock_);
+  outputs_[path] = contents;
+}
+
+OutputCache::OutputCache(const IoDelegate& io_delegate, const string& dir)
+    : io_delegate_(io_delegate),
+      dir_(dir) {}
+
+const string& CompilerId() {
+  static const string id = ComputeCompilerId();
+  return id;
+}
+
+string OutputCache::PathFor(const string& key) const {
+  string path = dir_;
+  if (!path.empty() && path.back() != OS_PATH_SEPARATOR) {
+    path += OS_PATH_SEPARATOR;
+  }
+  return path + key + ".out";
+}
+
+string OutputCache::Key(const string& options, const string& input_file) const {
+  const string& compiler_id = CompilerId();
+  if (compiler_id.empty()) {
+    return "";
+  }
+  unique_ptr<string> contents = io_delegate_.GetFileContents(input_file);
+  if (!contents) {
+    return "";
+  }
+  Sha256 hash;
+  hash.Update(kMagic, sizeof(kMagic));
+  hash.Update(compiler_id.c_str(), compiler_id.size() + 1);
+  hash.Update(options);
+  hash.Update("", 1);
+  hash.Update(*contents);
+  return hash.HexDigest();
+}
+
+bool OutputCache::Restore(const string& key,
+                          const ImportResolver& import_resolver,
+                          const IoDelegate& writer) const {
+  const string path = PathFor(key);
+  if (!io_delegate_.FileIsReadable(path)) {
+    return false;
+  }
+  unique_ptr<string> entry = io_delegate_.GetFileContents(path);
+  const size_t magic_length = strlen(kMagic);
+  if (!entry || entry->compare(0, magic_length, kMagic) != 0) {
+    return false;
+  }
+
+  EntryReader reader(entry->data() + magic_length,
+                     entry->size() - magic_length);
+  vector<Dependency> dependencies;
+  for (uint32_t count = reader.ReadUint(); reader.Ok() && count > 0; --count) {
+    Dependency dependency;
+    dependency.needed_class = reader.ReadString();
+    dependency.path = reader.ReadString();
+    dependency.contents_hash = reader.ReadString();
+    dependencies.push_back(dependency);
+  }
+  vector<pair<string, string>> outputs;
+  for (uint32_t count = reader.ReadUint(); reader.Ok() && count > 0; --count) {
+    const string output_path = reader.ReadString();
+    outputs.emplace_back(output_path, reader.ReadString());
+  }
+  if (!reader.Ok() || !reader.AtEnd()) {
+    LOG(WARNING) << "Ignoring corrupt cached outputs in " << path;
+    return false;
+  }
+
+  // Resolving an import again is cheap, and catches files that now shadow
+  // the one the outputs were generated from.
+  for (const Dependency& dependency : dependencies) {
+    if (!dependency.needed_class.empty() &&
+        import_resolver.FindImportFile(dependency.needed_class) !=
+            dependency.path) {
+      return false;
+    }
+    unique_ptr<string> contents = io_delegate_.GetFileContents(dependency.path);
+    if (!contents || Sha256Hex(*contents) != dependency.contents_hash) {
+      return false;
+    }
+  }
+
+  for (const auto& output : outputs) {
+    if (output.first != "-" && !writer.CreatePathForFile(output.first)) {
+      return false;
+    }
+    CodeWriterPtr code_writer = writer.GetCodeWriter(output.first);
+    if (!code_writer || !code_writer->Append(output.second) ||
+        !code_writer->Close()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void OutputCache::Store(const string& key,
+                        const vector<unique_ptr<AidlImport>>& imports,
+                        const vector<string>& preprocessed_files,
+                        const OutputRecorder& recorder) const {
+  // Pairs of the class a file was imported for and the file.
+  vector<pair<string, string>> dependencies;
+  for (const auto& import : imports) {
+    // Imports without a file were found among the preprocessed types.
+    if (!import->GetFilename().empty()) {
+      dependencies.emplace_back(import->GetNeededClass(),
+                                import->GetFilename());
+    }
+  }
+  for (const string& preprocessed_file : preprocessed_files) {
+    dependencies.emplace_back("", preprocessed_file);
+  }
+
+  string serialized = kMagic;
+  WriteUint(dependencies.size(), &serialized);
+  for (const auto& dependency : dependencies) {
+    unique_ptr<string> contents =
+        io_delegate_.GetFileContents(dependency.second);
+    if (!contents) {
+      return;
+    }
+    WriteString(dependency.first, &serialized);
+    WriteString(dependency.second, &serialized);
+    WriteString(Sha256Hex(*contents), &serialized);
+  }
+  const map<string, string> outputs = recorder.GetOutputs();
+  WriteUint(outputs.size(), &serialized);
+  for (const auto& output : outputs) {
+    WriteString(output.first, &serialized);
+    WriteString(output.second, &serialized);
+  }
+
+  const string path = PathFor(key);
+  if (!io_delegate_.CreatePathForFile(path) ||
+      !io_delegate_.WriteFileAtomically(path, serialized)) {
+    LOG(WARNING) << "Cannot store outputs to " << path;
+  }
+}
+
+}  // namespace aidl
+}  // namespace android
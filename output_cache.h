@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2018, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef AIDL_OUTPUT_CACHE_H_
+#define AIDL_OUTPUT_CACHE_H_
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <android-base/macros.h>
+
+#include "aidl_language.h"
+#include "import_resolver.h"
+#include "io_delegate.h"
+
+namespace android {
+namespace aidl {
+
+// Forwards everything to another IoDelegate, and remembers the contents of
+// the files written through it, so they can be stored in an OutputCache.
+class OutputRecorder : public IoDelegate {
+ public:
+  explicit OutputRecorder(const IoDelegate& io_delegate)
+      : io_delegate_(io_delegate) {}
+  virtual ~OutputRecorder() = default;
+
+  std::unique_ptr<std::string> GetFileContents(
+      const std::string& filename,
+      const std::string& content_suffix = "") const override;
+  std::unique_ptr<SourceBuffer> GetSourceBuffer(
+      const std::string& filename) const override;
+  std::unique_ptr<LineReader> GetLineReader(
+      const std::string& file_path) const override;
+  bool FileIsReadable(const std::string& path) const override;
+  bool ListFiles(const std::string& dir,
+                 std::vector<std::string>* files) const override;
+  bool GetModificationTime(const std::string& path,
+                           int64_t* mtime) const override;
+  bool GetFileSize(const std::string& path, int64_t* size) const override;
+  bool CreatedNestedDirs(
+      const std::string& base_dir,
+      const std::vector<std::string>& nested_subdirs) const override;
+  std::unique_ptr<CodeWriter> GetCodeWriter(
+      const std::string& file_path) const override;
+  void RemovePath(const std::string& file_path) const override;
+  bool WriteFileAtomically(const std::string& path,
+                           const std::string& contents) const override;
+
+  // Returns the files written so far, by path.
+  std::map<std::string, std::string> GetOutputs() const;
+
+ private:
+  void Record(const std::string& path, const std::string& contents) const;
+
+  const IoDelegate& io_delegate_;
+  mutable std::mutex lock_;
+  mutable std::map<std::string, std::string> outputs_;
+
+  DISALLOW_COPY_AND_ASSIGN(OutputRecorder);
+};
+
+// The outputs of earlier compiles, stored in a directory much like ccache
+// does.  An entry is found from the input file and the options alone, and is
+// only used if every import still resolves to a file with the contents it had
+// when the entry was stored, and every preprocessed file is unchanged.  Safe
+// to use from several threads and processes at once.
+class OutputCache {
+ public:
+  OutputCache(const IoDelegate& io_delegate, const std::string& dir);
+  ~OutputCache() = default;
+
+  // Returns the key of compiling |input_file| with |options|, which must
+  // describe every option that affects the outputs, with this build of the
+  // compiler.  Returns an empty string if |input_file| cannot be read, or if
+  // the build of the compiler cannot be told apart from others.
+  std::string Key(const std::string& options,
+                  const std::string& input_file) const;
+
+  // Writes the outputs stored under |key| through |writer| and returns true,
+  // if the files they were generated from are unchanged.  Imports are
+  // resolved with |import_resolver|.
+  bool Restore(const std::string& key,
+               const ImportResolver& import_resolver,
+               const IoDelegate& writer) const;
+
+  // Stores the outputs in |recorder| under |key|, along with the files that
+  // |imports| were resolved to and |preprocessed_files|.  Failing to store is
+  // not an error; the input is simply compiled again next time.
+  void Store(const std::string& key,
+             const std::vector<std::unique_ptr<AidlImport>>& imports,
+             const std::vector<std::string>& preprocessed_files,
+             const OutputRecorder& recorder) const;
+
+  const std::string& Dir() const { return dir_; }
+
+ private:
+  std::string PathFor(const std::string& key) const;
+
+  const IoDelegate& io_delegate_;
+  const std::string dir_;
+
+  DISALLOW_COPY_AND_ASSIGN(OutputCache);
+};
+
+// Identifies the build of the running compiler: the build ID that the linker
+// stamped into the executable where there is one, or else a hash of the
+// executable.  Empty if neither can be read.
+const std::string& CompilerId();
+
+}  // namespace aidl
+}  // namespace android
+
+#endif  // AIDL_OUTPUT_CACHE_H_
@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2018, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "aidl_language.h"
+#include "import_resolver.h"
+#include "output_cache.h"
+#include "tests/fake_io_delegate.h"
+
+using android::aidl::test::FakeIoDelegate;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+namespace android {
+namespace aidl {
+
+class OutputCacheTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    io_delegate_.SetFileContents("p/IFoo.aidl",
+                                 "package p; import q.Bar; interface IFoo {}");
+    io_delegate_.SetFileContents("imports/q/Bar.aidl",
+                                 "package q; parcelable Bar;");
+    io_delegate_.SetFileContents("preprocessed", "parcelable r.Baz;\n");
+  }
+
+  // Stores "out/IFoo.cpp" under |key| as if compiled from "p/IFoo.aidl", and
+  // makes the entry visible to Restore().
+  void StoreOutputs(const string& key) {
+    OutputRecorder recorder(io_delegate_);
+    unique_ptr<CodeWriter> writer = recorder.GetCodeWriter("out/IFoo.cpp");
+    ASSERT_NE(nullptr, writer);
+    writer->Write("generated %d\n", 1);
+    ASSERT_TRUE(writer->Close());
+
+    vector<unique_ptr<AidlImport>> imports;
+    imports.emplace_back(new AidlImport("p/IFoo.aidl", "q.Bar", 1));
+    imports.back()->SetFilename("imports/q/Bar.aidl");
+    // Found among the preprocessed types, so not a file of its own.
+    imports.emplace_back(new AidlImport("p/IFoo.aidl", "r.Baz", 1));
+    cache_.Store(key, imports, {"preprocessed"}, recorder);
+
+    string entry;
+    ASSERT_TRUE(io_delegate_.GetWrittenContents("cache/" + key + ".out",
+                                                &entry));
+    io_delegate_.SetFileContents("cache/" + key + ".out", entry);
+  }
+
+  // Returns true if the outputs under |key| were restored.
+  bool Restore(const string& key,
+               const vector<string>& import_paths = {"imports/"}) {
+    io_delegate_.GetCodeWriter("out/IFoo.cpp")->Write("stale\n");
+    ImportResolver import_resolver{io_delegate_, import_paths};
+    if (!cache_.Restore(key, import_resolver, io_delegate_)) {
+      return false;
+    }
+    string restored;
+    EXPECT_TRUE(io_delegate_.GetWrittenContents("out/IFoo.cpp", &restored));
+    EXPECT_EQ("generated 1\n", restored);
+    return true;
+  }
+
+  FakeIoDelegate io_delegate_;
+  OutputCache cache_{io_delegate_, "cache"};
+};
+
+TEST_F(OutputCacheTest, KeysDependOnOptionsAndInput) {
+  const string key = cache_.Key("-t", "p/IFoo.aidl");
+  EXPECT_EQ(64u, key.size());
+  EXPECT_EQ(key, cache_.Key("-t", "p/IFoo.aidl"));
+  EXPECT_NE(key, cache_.Key("", "p/IFoo.aidl"));
+  io_delegate_.SetFileContents("p/IFoo.aidl", "package p; interface IFoo {}");
+  EXPECT_NE(key, cache_.Key("-t", "p/IFoo.aidl"));
+  EXPECT_EQ("", cache_.Key("-t", "p/IMissing.aidl"));
+}
+
+TEST_F(OutputCacheTest, IdentifiesTheBuildOfTheCompiler) {
+  // The test binary is built like the compiler, so it has an identity too,
+  // which stays the same for as long as it runs.
+  const string id = CompilerId();
+  EXPECT_FALSE(id.empty());
+  EXPECT_EQ(id, CompilerId());
+}
+
+TEST_F(OutputCacheTest, RestoresOutputsOfUnchangedInputs) {
+  const string key = cache_.Key("", "p/IFoo.aidl");
+  EXPECT_FALSE(Restore(key));
+  StoreOutputs(key);
+  EXPECT_TRUE(Restore(key));
+  // Unrelated files in other import roots do not matter.
+  io_delegate_.SetFileContents("other/q/Qux.aidl", "package q; parcelable Qux;");
+  EXPECT_TRUE(Restore(key, {"other/", "imports/"}));
+}
+
+TEST_F(OutputCacheTest, MissesWhenDependenciesChange) {
+  const string key = cache_.Key("", "p/IFoo.aidl");
+  StoreOutputs(key);
+
+  // An import that now resolves to another file.
+  io_delegate_.SetFileContents("shadow/q/Bar.aidl", "package q; parcelable Bar;");
+  EXPECT_FALSE(Restore(key, {"shadow/", "imports/"}));
+  EXPECT_TRUE(Restore(key));
+
+  io_delegate_.SetFileContents("imports/q/Bar.aidl",
+                               "package q; parcelable Bar; parcelable Bar2;");
+  EXPECT_FALSE(Restore(key));
+
+  StoreOutputs(key);
+  EXPECT_TRUE(Restore(key));
+  io_delegate_.SetFileContents("preprocessed", "parcelable r.Other;\n");
+  EXPECT_FALSE(Restore(key));
+}
+
+TEST_F(OutputCacheTest, IgnoresCorruptEntries) {
+  const string key = cache_.Key("", "p/IFoo.aidl");
+  StoreOutputs(key);
+  const string path = "cache/" + key + ".out";
+  string entry;
+  ASSERT_TRUE(io_delegate_.GetWrittenContents(path, &entry));
+
+  for (const string& corrupt :
+       {entry.substr(0, entry.size() - 1), "AIDLOUT0" + entry.substr(8),
+        entry + "x"}) {
+    io_delegate_.SetFileContents(path, corrupt);
+    EXPECT_FALSE(Restore(key));
+  }
+}
+
+}  // namespace aidl
+}  // namespace android
@@ -0,0 +1,269 @@
+/*
+ * Copyright (C) 2018, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "preprocessed_file.h"
+
+#include <string.h>
+
+#include <limits>
+#include <map>
+
+#include "logging.h"
+
+using std::string;
+
+namespace android {
+namespace aidl {
+namespace {
+
+const char kMagic[8] = {'\x7f', 'A', 'I', 'D', 'L', 'P', 'P', '\0'};
+// Version 1 files had no index of short names, and version 2 files no index
+// at all.
+const uint32_t kVersion = 3;
+const size_t kHeaderSize = 32;
+const size_t kEntrySize = 12;
+
+uint32_t ReadUint32(const char* data) {
+  const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+  return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) |
+         (static_cast<uint32_t>(bytes[3]) << 24);
+}
+
+void WriteUint32(uint32_t value, char* out) {
+  for (int i = 0; i < 4; ++i) {
+    out[i] = static_cast<char>(value >> (8 * i));
+  }
+}
+
+// FNV-1a, which is plenty for the few thousand names of the SDK.
+uint32_t Hash(const char* data, size_t length) {
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < length; ++i) {
+    hash = (hash ^ static_cast<uint8_t>(data[i])) * 16777619u;
+  }
+  return hash;
+}
+
+// Cuts the |*length| bytes at |*name| down to the part after the last dot.
+void CutToShortName(const char** name, size_t* length) {
+  for (size_t i = *length; i > 0; --i) {
+    if ((*name)[i - 1] == '.') {
+      *name += i;
+      *length -= i;
+      return;
+    }
+  }
+}
+
+}  // namespace
+
+void BinaryPreprocessedWriter::Add(PreprocessedKind kind,
+                                   const string& canonical_name) {
+  declarations_.emplace_back(kind, canonical_name);
+}
+
+bool BinaryPreprocessedWriter::Finish(string* contents) const {
+  std::map<string, uint32_t> offsets;
+  for (const auto& declaration : declarations_) {
+    offsets[declaration.second] = 0;
+  }
+  string strings;
+  for (auto& name : offsets) {
+    name.second = static_cast<uint32_t>(strings.size());
+    strings += name.first;
+  }
+
+  size_t num_buckets = 1;
+  while (num_buckets < 2 * declarations_.size()) {
+    num_buckets *= 2;
+  }
+  const size_t strings_offset = kHeaderSize + kEntrySize * declarations_.size();
+  // Keep the indexes aligned for whoever maps the file.
+  const size_t index_offset = (strings_offset + strings.size() + 3) & ~3;
+  const size_t size = index_offset + 2 * 4 * num_buckets;
+  if (size > std::numeric_limits<uint32_t>::max()) {
+    LOG(ERROR) << "Too many declarations for a binary preprocessed file";
+    return false;
+  }
+
+  contents->assign(size, '\0');
+  char* const out = &(*contents)[0];
+  memcpy(out, kMagic, sizeof(kMagic));
+  WriteUint32(kVersion, out + 8);
+  WriteUint32(static_cast<uint32_t>(declarations_.size()), out + 12);
+  WriteUint32(static_cast<uint32_t>(strings_offset), out + 16);
+  WriteUint32(static_cast<uint32_t>(strings.size()), out + 20);
+  WriteUint32(static_cast<uint32_t>(index_offset), out + 24);
+  WriteUint32(static_cast<uint32_t>(num_buckets), out + 28);
+  memcpy(out + strings_offset, strings.data(), strings.size());
+
+  char* const index = out + index_offset;
+  char* const short_name_index = index + 4 * num_buckets;
+  for (size_t i = 0; i < declarations_.size(); ++i) {
+    const string& name = declarations_[i].second;
+    char* const entry = out + kHeaderSize + kEntrySize * i;
+    WriteUint32(static_cast<uint32_t>(declarations_[i].first), entry);
+    WriteUint32(offsets[name], entry + 4);
+    WriteUint32(static_cast<uint32_t>(name.size()), entry + 8);
+
+    size_t bucket = Hash(name.data(), name.size()) & (num_buckets - 1);
+    while (true) {
+      const uint32_t slot = ReadUint32(index + 4 * bucket);
+      if (slot == 0) {
+        WriteUint32(static_cast<uint32_t>(i + 1), index + 4 * bucket);
+        break;
+      }
+      if (declarations_[slot - 1].second == name) {
+        break;
+      }
+      bucket = (bucket + 1) & (num_buckets - 1);
+    }
+
+    const char* short_name = name.data();
+    size_t short_length = name.size();
+    CutToShortName(&short_name, &short_length);
+    bucket = Hash(short_name, short_length) & (num_buckets - 1);
+    while (true) {
+      const uint32_t slot = ReadUint32(short_name_index + 4 * bucket);
+      if (slot == 0) {
+        WriteUint32(static_cast<uint32_t>(i + 1),
+                    short_name_index + 4 * bucket);
+        break;
+      }
+      const string& other = declarations_[slot - 1].second;
+      const char* other_short_name = other.data();
+      size_t other_length = other.size();
+      CutToShortName(&other_short_name, &other_length);
+      if (other_length == short_length &&
+          memcmp(other_short_name, short_name, short_length) == 0) {
+        WriteUint32(static_cast<uint32_t>(i + 1),
+                    short_name_index + 4 * bucket);
+        break;
+      }
+      bucket = (bucket + 1) & (num_buckets - 1);
+    }
+  }
+  return true;
+}
+
+bool BinaryPreprocessedFile::IsBinary(const char* data, size_t size) {
+  return size >= sizeof(kMagic) && memcmp(data, kMagic, sizeof(kMagic)) == 0;
+}
+
+bool BinaryPreprocessedFile::Open(const char* data, size_t size) {
+  num_entries_ = 0;
+  num_buckets_ = 0;
+  if (size < kHeaderSize || !IsBinary(data, size)) {
+    return false;
+  }
+  if (ReadUint32(data + 8) != kVersion) {
+    LOG(ERROR) << "Unsupported binary preprocessed file version "
+               << ReadUint32(data + 8);
+    return false;
+  }
+  const uint64_t num_entries = ReadUint32(data + 12);
+  const uint64_t strings_offset = ReadUint32(data + 16);
+  const uint64_t strings_size = ReadUint32(data + 20);
+  const uint64_t index_offset = ReadUint32(data + 24);
+  const uint64_t num_buckets = ReadUint32(data + 28);
+  if (kHeaderSize + kEntrySize * num_entries > size ||
+      strings_offset + strings_size > size ||
+      index_offset + 2 * 4 * num_buckets > size ||
+      num_buckets == 0 || (num_buckets & (num_buckets - 1)) != 0 ||
+      num_buckets < num_entries) {
+    return false;
+  }
+
+  entries_ = data + kHeaderSize;
+  strings_ = data + strings_offset;
+  index_ = data + index_offset;
+  short_name_index_ = index_ + 4 * num_buckets;
+  for (uint64_t i = 0; i < num_entries; ++i) {
+    const char* entry = entries_ + kEntrySize * i;
+    const uint32_t kind = ReadUint32(entry);
+    if ((kind != static_cast<uint32_t>(PreprocessedKind::PARCELABLE) &&
+         kind != static_cast<uint32_t>(PreprocessedKind::INTERFACE)) ||
+        uint64_t{ReadUint32(entry + 4)} + ReadUint32(entry + 8) >
+            strings_size) {
+      return false;
+    }
+  }
+  for (uint64_t i = 0; i < 2 * num_buckets; ++i) {
+    if (ReadUint32(index_ + 4 * i) > num_entries) {
+      return false;
+    }
+  }
+  num_entries_ = num_entries;
+  num_buckets_ = num_buckets;
+  return true;
+}
+
+void BinaryPreprocessedFile::GetDeclaration(size_t i, PreprocessedKind* kind,
+                                            string* canonical_name) const {
+  *kind = static_cast<PreprocessedKind>(ReadUint32(entries_ + kEntrySize * i));
+  const char* name;
+  size_t length;
+  GetName(i, &name, &length);
+  canonical_name->assign(name, length);
+}
+
+bool BinaryPreprocessedFile::Find(const string& canonical_name,
+                                  size_t* i) const {
+  return Lookup(index_, canonical_name, false, i);
+}
+
+bool BinaryPreprocessedFile::FindShortName(const string& short_name,
+                                           size_t* i) const {
+  return Lookup(short_name_index_, short_name, true, i);
+}
+
+void BinaryPreprocessedFile::GetName(size_t i, const char** name,
+                                     size_t* length) const {
+  const char* entry = entries_ + kEntrySize * i;
+  *name = strings_ + ReadUint32(entry + 4);
+  *length = ReadUint32(entry + 8);
+}
+
+bool BinaryPreprocessedFile::Lookup(const char* index, const string& name,
+                                    bool short_name, size_t* i) const {
+  if (num_buckets_ == 0) {
+    return false;
+  }
+  size_t bucket = Hash(name.data(), name.size()) & (num_buckets_ - 1);
+  for (size_t probes = 0; probes < num_buckets_; ++probes) {
+    const uint32_t slot = ReadUint32(index + 4 * bucket);
+    if (slot == 0) {
+      return false;
+    }
+    const char* entry_name;
+    size_t length;
+    GetName(slot - 1, &entry_name, &length);
+    if (short_name) {
+      CutToShortName(&entry_name, &length);
+    }
+    if (length == name.size() &&
+        memcmp(entry_name, name.data(), length) == 0) {
+      *i = slot - 1;
+      return true;
+    }
+    bucket = (bucket + 1) & (num_buckets_ - 1);
+  }
+  return false;
+}
+
+}  // namespace aidl
+}  // namespace android
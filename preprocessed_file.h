@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2018, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef AIDL_PREPROCESSED_FILE_H_
+#define AIDL_PREPROCESSED_FILE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <android-base/macros.h>
+
+namespace android {
+namespace aidl {
+
+// Preprocessed files declare the parcelables and interfaces that code may use
+// without importing them.  Besides the text format of one declaration per
+// line, they come in a binary format that is looked up in place, so that only
+// the declarations a compilation uses are ever loaded:
+//
+//   header   magic, version, the number of entries, the offset and size of
+//            the string table, then the offset of the indexes and the number
+//            of buckets in each
+//   entries  per declaration, in order: its kind, then the offset and length
+//            of its canonical name in the string table
+//   strings  the canonical names, without duplicates
+//   indexes  two open addressing hash tables of entry numbers plus one, with
+//            0 marking empty buckets.  The first is keyed by canonical name
+//            and keeps the first declaration of a name, the second is keyed
+//            by short name, the part after the last dot, and keeps the last.
+//
+// All integers are little endian uint32_t.
+enum class PreprocessedKind : uint32_t {
+  PARCELABLE = 0,
+  INTERFACE = 1,
+};
+
+class BinaryPreprocessedWriter {
+ public:
+  BinaryPreprocessedWriter() = default;
+  ~BinaryPreprocessedWriter() = default;
+
+  void Add(PreprocessedKind kind, const std::string& canonical_name);
+  // Stores the binary preprocessed file to |*contents|.  Returns false if
+  // the declarations do not fit in one.
+  bool Finish(std::string* contents) const;
+
+ private:
+  std::vector<std::pair<PreprocessedKind, std::string>> declarations_;
+
+  DISALLOW_COPY_AND_ASSIGN(BinaryPreprocessedWriter);
+};
+
+class BinaryPreprocessedFile {
+ public:
+  BinaryPreprocessedFile() = default;
+  ~BinaryPreprocessedFile() = default;
+
+  // Returns true if the |size| bytes at |data| start like a binary
+  // preprocessed file, rather than a text one.
+  static bool IsBinary(const char* data, size_t size);
+
+  // Checks the |size| bytes at |data|, which must outlive this object.
+  // Returns false if they are not a well formed binary preprocessed file.
+  bool Open(const char* data, size_t size);
+
+  size_t NumDeclarations() const { return num_entries_; }
+  // Stores the kind and canonical name of the |i|th declaration.
+  void GetDeclaration(size_t i, PreprocessedKind* kind,
+                      std::string* canonical_name) const;
+  // Look up the declaration of |canonical_name|, or the last declaration
+  // with |short_name|, in the indexes, and store its number to |*i|.  Return
+  // false if there is none.
+  bool Find(const std::string& canonical_name, size_t* i) const;
+  bool FindShortName(const std::string& short_name, size_t* i) const;
+
+ private:
+  // Stores the name of the |i|th declaration to |*name| and |*length|.
+  void GetName(size_t i, const char** name, size_t* length) const;
+  bool Lookup(const char* index, const std::string& name, bool short_name,
+              size_t* i) const;
+
+  const char* entries_ = nullptr;
+  size_t num_entries_ = 0;
+  const char* strings_ = nullptr;
+  const char* index_ = nullptr;
+  const char* short_name_index_ = nullptr;
+  size_t num_buckets_ = 0;
+
+  DISALLOW_COPY_AND_ASSIGN(BinaryPreprocessedFile);
+};
+
+}  // namespace aidl
+}  // namespace android
+
+#endif  // AIDL_PREPROCESSED_FILE_H_
@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2018, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "preprocessed_file.h"
+
+using std::string;
+
+namespace android {
+namespace aidl {
+
+TEST(PreprocessedFileTest, RoundTripsDeclarations) {
+  BinaryPreprocessedWriter writer;
+  writer.Add(PreprocessedKind::PARCELABLE, "p.Outer.Inner");
+  writer.Add(PreprocessedKind::INTERFACE, "a.IFoo");
+  writer.Add(PreprocessedKind::PARCELABLE, "Bare");
+  string contents;
+  ASSERT_TRUE(writer.Finish(&contents));
+  EXPECT_TRUE(BinaryPreprocessedFile::IsBinary(contents.data(),
+                                               contents.size()));
+
+  BinaryPreprocessedFile file;
+  ASSERT_TRUE(file.Open(contents.data(), contents.size()));
+  ASSERT_EQ(3u, file.NumDeclarations());
+  PreprocessedKind kind;
+  string name;
+  // Declarations keep their order, whatever the order of the string table.
+  file.GetDeclaration(0, &kind, &name);
+  EXPECT_EQ(PreprocessedKind::PARCELABLE, kind);
+  EXPECT_EQ("p.Outer.Inner", name);
+  file.GetDeclaration(1, &kind, &name);
+  EXPECT_EQ(PreprocessedKind::INTERFACE, kind);
+  EXPECT_EQ("a.IFoo", name);
+  file.GetDeclaration(2, &kind, &name);
+  EXPECT_EQ("Bare", name);
+}
+
+TEST(PreprocessedFileTest, FindsDeclarationsInIndexes) {
+  BinaryPreprocessedWriter writer;
+  for (int i = 0; i < 100; ++i) {
+    writer.Add(i % 2 ? PreprocessedKind::INTERFACE
+                     : PreprocessedKind::PARCELABLE,
+               "p" + std::to_string(i % 3) + ".Type" + std::to_string(i));
+  }
+  writer.Add(PreprocessedKind::INTERFACE, "q.Type0");
+  writer.Add(PreprocessedKind::PARCELABLE, "p0.Type0");
+  string contents;
+  ASSERT_TRUE(writer.Finish(&contents));
+  BinaryPreprocessedFile file;
+  ASSERT_TRUE(file.Open(contents.data(), contents.size()));
+
+  size_t i = 0;
+  for (int j = 0; j < 100; ++j) {
+    ASSERT_TRUE(file.Find(
+        "p" + std::to_string(j % 3) + ".Type" + std::to_string(j), &i));
+    EXPECT_EQ(static_cast<size_t>(j), i);
+  }
+  EXPECT_FALSE(file.Find("p0.Type100", &i));
+  EXPECT_FALSE(file.Find("Type1", &i));
+  // The first declaration of a canonical name is found, and the last of a
+  // short name.
+  ASSERT_TRUE(file.Find("p0.Type0", &i));
+  EXPECT_EQ(0u, i);
+  ASSERT_TRUE(file.FindShortName("Type0", &i));
+  EXPECT_EQ(101u, i);
+  ASSERT_TRUE(file.FindShortName("Type1", &i));
+  EXPECT_EQ(1u, i);
+  EXPECT_FALSE(file.FindShortName("p1.Type1", &i));
+}
+
+TEST(PreprocessedFileTest, HandlesEmptyFiles) {
+  BinaryPreprocessedWriter writer;
+  string contents;
+  ASSERT_TRUE(writer.Finish(&contents));
+  BinaryPreprocessedFile file;
+  ASSERT_TRUE(file.Open(contents.data(), contents.size()));
+  EXPECT_EQ(0u, file.NumDeclarations());
+  size_t i = 0;
+  EXPECT_FALSE(file.Find("a.Foo", &i));
+  EXPECT_FALSE(file.FindShortName("Foo", &i));
+}
+
+TEST(PreprocessedFileTest, RejectsMalformedFiles) {
+  const string text = "parcelable a.Foo;\n";
+  EXPECT_FALSE(BinaryPreprocessedFile::IsBinary(text.data(), text.size()));
+  BinaryPreprocessedFile file;
+  EXPECT_FALSE(file.Open(text.data(), text.size()));
+
+  BinaryPreprocessedWriter writer;
+  writer.Add(PreprocessedKind::PARCELABLE, "a.Foo");
+  string contents;
+  ASSERT_TRUE(writer.Finish(&contents));
+  // Truncated.
+  EXPECT_FALSE(file.Open(contents.data(), contents.size() - 1));
+  // An unknown kind of declaration.
+  string bad_kind = contents;
+  bad_kind[32] = 7;
+  EXPECT_FALSE(file.Open(bad_kind.data(), bad_kind.size()));
+  // A name running past the string table.
+  string bad_name = contents;
+  bad_name[40] = 100;
+  EXPECT_FALSE(file.Open(bad_name.data(), bad_name.size()));
+  // An index naming a declaration past the last.  The offset of the indexes
+  // fits in the first byte of its field.
+  string bad_index = contents;
+  bad_index[static_cast<uint8_t>(contents[24])] = 2;
+  EXPECT_FALSE(file.Open(bad_index.data(), bad_index.size()));
+}
+
+}  // namespace aidl
+}  // namespace android
@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2018, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AIDL_SHA256_H_
+#define AIDL_SHA256_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+#include <android-base/macros.h>
+
+namespace android {
+namespace aidl {
+
+// Computes the SHA-256 digest of data given in any number of pieces.  Used to
+// key on-disk caches by content, so that they stay correct when shared
+// between machines.
+class Sha256 {
+ public:
+  Sha256();
+  ~Sha256() = default;
+
+  void Update(const void* data, size_t length);
+  void Update(const std::string& data) { Update(data.data(), data.size()); }
+
+  // Returns the digest of everything passed to Update() as 64 lowercase hex
+  // digits.  No more data may be added afterwards.
+  std::string HexDigest();
+
+ private:
+  void ProcessBlock(const uint8_t* block);
+
+  uint32_t state_[8];
+  uint8_t buffer_[64];
+  size_t buffer_length_ = 0;
+  uint64_t total_length_ = 0;
+
+  DISALLOW_COPY_AND_ASSIGN(Sha256);
+};
+
+// Returns the hex SHA-256 digest of |data|.
+std::string Sha256Hex(const std::string& data);
+
+}  // namespace aidl
+}  // namespace android
+
+#endif  // AIDL_SHA256_H_
@@ -0,0 +1,210 @@
+/*
+ * Copyright (C) 2018, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "srcjar.h"
+
+#include <stdarg.h>
+
+#include <functional>
+#include <utility>
+
+#include <android-base/stringprintf.h>
+
+#include "logging.h"
+#include "os.h"
+
+using android::base::StringAppendV;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+namespace android {
+namespace aidl {
+namespace {
+
+// Collects everything written to it, and hands it to |on_close| once closed
+// or destroyed.
+class EntryCodeWriter : public CodeWriter {
+ public:
+  explicit EntryCodeWriter(std::function<void(const string&)> on_close)
+      : on_close_(on_close) {}
+  virtual ~EntryCodeWriter() { Close(); }
+
+  bool Write(const char* format, ...) override {
+    va_list ap;
+    va_start(ap, format);
+    StringAppendV(&contents_, format, ap);
+    va_end(ap);
+    return true;
+  }
+
+  bool AppendBytes(const char* data, size_t length) override {
+    contents_.append(data, length);
+    return true;
+  }
+
+  bool Close() override {
+    if (!closed_) {
+      closed_ = true;
+      on_close_(contents_);
+    }
+    return true;
+  }
+
+ private:
+  std::function<void(const string&)> on_close_;
+  string contents_;
+  bool closed_ = false;
+};  // class EntryCodeWriter
+
+}  // namespace
+
+SrcjarWriter::SrcjarWriter(const IoDelegate& io_delegate,
+                           const string& srcjar_path)
+    : io_delegate_(io_delegate),
+      srcjar_path_(srcjar_path) {
+  if (!GetAbsolutePath(srcjar_path, &prefix_)) {
+    prefix_ = srcjar_path;
+  }
+  prefix_ += OS_PATH_SEPARATOR;
+}
+
+unique_ptr<string> SrcjarWriter::GetFileContents(
+    const string& filename, const string& content_suffix) const {
+  return io_delegate_.GetFileContents(filename, content_suffix);
+}
+
+unique_ptr<SourceBuffer> SrcjarWriter::GetSourceBuffer(
+    const string& filename) const {
+  return io_delegate_.GetSourceBuffer(filename);
+}
+
+unique_ptr<LineReader> SrcjarWriter::GetLineReader(
+    const string& file_path) const {
+  return io_delegate_.GetLineReader(file_path);
+}
+
+bool SrcjarWriter::FileIsReadable(const string& path) const {
+  return io_delegate_.FileIsReadable(path);
+}
+
+bool SrcjarWriter::ListFiles(const string& dir, vector<string>* files) const {
+  return io_delegate_.ListFiles(dir, files);
+}
+
+bool SrcjarWriter::GetModificationTime(const string& path,
+                                       int64_t* mtime) const {
+  return io_delegate_.GetModificationTime(path, mtime);
+}
+
+bool SrcjarWriter::GetFileSize(const string& path, int64_t* size) const {
+  return io_delegate_.GetFileSize(path, size);
+}
+
+bool SrcjarWriter::CreatedNestedDirs(
+    const string& base_dir, const vector<string>& nested_subdirs) const {
+  string path = base_dir.empty() ? "." : base_dir;
+  for (const string& subdir : nested_subdirs) {
+    if (path.back() != OS_PATH_SEPARATOR) {
+      path += OS_PATH_SEPARATOR;
+    }
+    path += subdir;
+  }
+  // Directories inside the archive are implied by the names of its entries.
+  string absolute_path;
+  if (GetAbsolutePath(path, &absolute_path) &&
+      (absolute_path + OS_PATH_SEPARATOR).compare(0, prefix_.size(),
+                                                  prefix_) == 0) {
+    return true;
+  }
+  return io_delegate_.CreatedNestedDirs(base_dir, nested_subdirs);
+}
+
+unique_ptr<CodeWriter> SrcjarWriter::GetCodeWriter(
+    const string& file_path) const {
+  string name;
+  if (!GetEntryName(file_path, &name)) {
+    return io_delegate_.GetCodeWriter(file_path);
+  }
+  return unique_ptr<CodeWriter>(new EntryCodeWriter(
+      [this, name](const string& contents) { AddEntry(name, contents); }));
+}
+
+void SrcjarWriter::RemovePath(const string& file_path) const {
+  string name;
+  if (!GetEntryName(file_path, &name)) {
+    io_delegate_.RemovePath(file_path);
+    return;
+  }
+  std::lock_guard<std::mutex> guard(lock_);
+  zip_.RemoveFile(name);
+}
+
+bool SrcjarWriter::WriteFileAtomically(const string& path,
+                                       const string& contents) const {
+  string name;
+  if (!GetEntryName(path, &name)) {
+    return io_delegate_.WriteFileAtomically(path, contents);
+  }
+  AddEntry(name, contents);
+  return true;
+}
+
+bool SrcjarWriter::Finish() const {
+  string archive;
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    if (!zip_.Finish(&archive)) {
+      io_delegate_.RemovePath(srcjar_path_);
+      return false;
+    }
+  }
+  if (!io_delegate_.CreatePathForFile(srcjar_path_)) {
+    return false;
+  }
+  unique_ptr<CodeWriter> writer = io_delegate_.GetCodeWriter(srcjar_path_);
+  if (!writer || !writer->Append(archive) || !writer->Close()) {
+    LOG(ERROR) << "Could not write " << srcjar_path_;
+    io_delegate_.RemovePath(srcjar_path_);
+    return false;
+  }
+  return true;
+}
+
+bool SrcjarWriter::GetEntryName(const string& path, string* name) const {
+  string absolute_path;
+  if (!GetAbsolutePath(path, &absolute_path) ||
+      absolute_path.compare(0, prefix_.size(), prefix_) != 0) {
+    return false;
+  }
+  *name = absolute_path.substr(prefix_.size());
+  // Entry names always use '/'.
+  for (char& c : *name) {
+    if (c == OS_PATH_SEPARATOR) {
+      c = '/';
+    }
+  }
+  return !name->empty();
+}
+
+void SrcjarWriter::AddEntry(const string& name, const string& contents) const {
+  std::lock_guard<std::mutex> guard(lock_);
+  zip_.AddFile(name, contents);
+}
+
+}  // namespace aidl
+}  // namespace android
@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2018, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef AIDL_SRCJAR_H_
+#define AIDL_SRCJAR_H_
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <android-base/macros.h>
+
+#include "io_delegate.h"
+#include "zip_file.h"
+
+namespace android {
+namespace aidl {
+
+// Forwards everything to another IoDelegate, except that files written below
+// |srcjar_path| are kept in memory as the entries of a zip archive, named by
+// their path below it, and directories below it are never created.  Finish()
+// then writes the archive to |srcjar_path| in one go.  Safe to write through
+// from several threads at once.
+class SrcjarWriter : public IoDelegate {
+ public:
+  SrcjarWriter(const IoDelegate& io_delegate, const std::string& srcjar_path);
+  virtual ~SrcjarWriter() = default;
+
+  std::unique_ptr<std::string> GetFileContents(
+      const std::string& filename,
+      const std::string& content_suffix = "") const override;
+  std::unique_ptr<SourceBuffer> GetSourceBuffer(
+      const std::string& filename) const override;
+  std::unique_ptr<LineReader> GetLineReader(
+      const std::string& file_path) const override;
+  bool FileIsReadable(const std::string& path) const override;
+  bool ListFiles(const std::string& dir,
+                 std::vector<std::string>* files) const override;
+  bool GetModificationTime(const std::string& path,
+                           int64_t* mtime) const override;
+  bool GetFileSize(const std::string& path, int64_t* size) const override;
+  bool CreatedNestedDirs(
+      const std::string& base_dir,
+      const std::vector<std::string>& nested_subdirs) const override;
+  std::unique_ptr<CodeWriter> GetCodeWriter(
+      const std::string& file_path) const override;
+  void RemovePath(const std::string& file_path) const override;
+  bool WriteFileAtomically(const std::string& path,
+                           const std::string& contents) const override;
+
+  // Writes the archive of everything written so far.  Returns false, and
+  // leaves no archive behind, on error.
+  bool Finish() const;
+
+ private:
+  // Stores the entry name of |path| to |*name| and returns true if |path|
+  // lies below the archive.
+  bool GetEntryName(const std::string& path, std::string* name) const;
+  void AddEntry(const std::string& name, const std::string& contents) const;
+
+  const IoDelegate& io_delegate_;
+  const std::string srcjar_path_;
+  // The absolute path of the archive, followed by a separator.
+  std::string prefix_;
+  mutable std::mutex lock_;
+  mutable ZipWriter zip_;
+
+  DISALLOW_COPY_AND_ASSIGN(SrcjarWriter);
+};
+
+}  // namespace aidl
+}  // namespace android
+
+#endif  // AIDL_SRCJAR_H_
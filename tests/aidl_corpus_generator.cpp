@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2018, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// Writes a synthetic corpus of AIDL files for benchmarks and stress tests.
+
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include <android-base/parseint.h>
+
+#include "io_delegate.h"
+#include "tests/corpus_generator.h"
+
+using android::aidl::IoDelegate;
+using android::aidl::test::Corpus;
+using android::aidl::test::CorpusShape;
+using android::aidl::test::GenerateCorpus;
+using android::base::ParseUint;
+using std::cerr;
+using std::endl;
+using std::string;
+
+namespace {
+
+int Usage(const char* program) {
+  cerr << "usage: " << program << " [--FIELD=N]... OUTPUT_DIR\n"
+       << "\n"
+       << "Writes the AIDL files, import roots, preprocessed files (sdk.txt\n"
+       << "and sdk.bin) and list of interfaces (interfaces.txt) of a corpus\n"
+       << "to OUTPUT_DIR.  The same fields always give the same corpus.\n"
+       << "\n"
+       << "FIELDS:\n"
+       << "   seed, interfaces, parcelables, packages, import_roots,\n"
+       << "   max_methods, max_args, max_imports, import_depth,\n"
+       << "   preprocessed_entries, outlined_interfaces, outline_threshold\n"
+       << "   (see tests/corpus_generator.h)" << endl;
+  return 1;
+}
+
+}  // namespace
+
+int main(int argc, const char* argv[]) {
+  CorpusShape shape;
+  struct {
+    const char* name;
+    size_t* value;
+  } fields[] = {
+      {"interfaces", &shape.interfaces},
+      {"parcelables", &shape.parcelables},
+      {"packages", &shape.packages},
+      {"import_roots", &shape.import_roots},
+      {"max_methods", &shape.max_methods},
+      {"max_args", &shape.max_args},
+      {"max_imports", &shape.max_imports},
+      {"import_depth", &shape.import_depth},
+      {"preprocessed_entries", &shape.preprocessed_entries},
+      {"outlined_interfaces", &shape.outlined_interfaces},
+      {"outline_threshold", &shape.outline_threshold},
+  };
+
+  string output_dir;
+  for (int i = 1; i < argc; ++i) {
+    const char* arg = argv[i];
+    if (strncmp(arg, "--", 2) != 0) {
+      if (!output_dir.empty()) {
+        return Usage(argv[0]);
+      }
+      output_dir = arg;
+      continue;
+    }
+    const char* equals = strchr(arg, '=');
+    if (!equals) {
+      return Usage(argv[0]);
+    }
+    const string name(arg + 2, equals);
+    bool parsed = false;
+    if (name == "seed") {
+      parsed = ParseUint(equals + 1, &shape.seed);
+    }
+    for (const auto& field : fields) {
+      if (name == field.name) {
+        parsed = ParseUint(equals + 1, field.value);
+      }
+    }
+    if (!parsed) {
+      cerr << "Invalid option: " << arg << endl;
+      return Usage(argv[0]);
+    }
+  }
+  if (output_dir.empty()) {
+    return Usage(argv[0]);
+  }
+
+  Corpus corpus;
+  GenerateCorpus(shape, &corpus);
+  IoDelegate io_delegate;
+  for (const auto& file : corpus.files) {
+    const string path = output_dir + "/" + file.first;
+    if (!io_delegate.CreatePathForFile(path) ||
+        !io_delegate.WriteFileAtomically(path, file.second)) {
+      cerr << "Unable to write " << path << endl;
+      return 1;
+    }
+  }
+  return 0;
+}
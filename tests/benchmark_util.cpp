@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2018, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "tests/benchmark_util.h"
+
+#include <android-base/stringprintf.h>
+
+#include "preprocessed_file.h"
+
+using android::base::StringAppendF;
+using android::base::StringPrintf;
+using std::string;
+
+namespace android {
+namespace aidl {
+namespace test {
+
+const char kBenchmarkInterface[] = "android/bench/IBig.aidl";
+
+namespace {
+
+const InputSize kTypicalInput = {64, 4, 16};
+
+string ParcelableName(int i) {
+  return StringPrintf("android.bench.types.Thing%d", i);
+}
+
+}  // namespace
+
+void InputSizes(benchmark::internal::Benchmark* benchmark) {
+  benchmark->ArgNames({"methods", "args", "types"});
+  const InputSize& t = kTypicalInput;
+  for (int methods : {16, 64, 256, 1024}) {
+    benchmark->Args({methods, t.args, t.types});
+  }
+  for (int args : {1, 16}) {
+    benchmark->Args({t.methods, args, t.types});
+  }
+  for (int types : {1, 256, 4096}) {
+    benchmark->Args({t.methods, t.args, types});
+  }
+}
+
+InputSize GetInputSize(const benchmark::State& state) {
+  return {static_cast<int>(state.range(0)), static_cast<int>(state.range(1)),
+          static_cast<int>(state.range(2))};
+}
+
+string MakeInterface(const InputSize& size) {
+  string contents = "package android.bench;\n\n";
+  for (int i = 0; i < size.types; ++i) {
+    StringAppendF(&contents, "import %s;\n", ParcelableName(i).c_str());
+  }
+  contents += "\n"
+              "/** A large interface. */\n"
+              "interface IBig {\n"
+              "  const int VERSION = 0x10;\n";
+  // Arguments cycle through primitives, arrays, strings, containers, binders
+  // and the imported parcelables, so that every kind of type is marshalled.
+  int next_type = 0;
+  for (int i = 0; i < size.methods; ++i) {
+    StringAppendF(&contents,
+                  "  /**\n"
+                  "   * Does thing number %d.\n"
+                  "   */\n"
+                  "  %s method%d(",
+                  i, (i % 2) ? "int" : "void", i);
+    for (int j = 0; j < size.args; ++j) {
+      if (j > 0) {
+        contents += ", ";
+      }
+      switch ((i + j) % 6) {
+        case 0: StringAppendF(&contents, "int a%d", j); break;
+        case 1: StringAppendF(&contents, "in int[] a%d", j); break;
+        case 2: StringAppendF(&contents, "String a%d", j); break;
+        case 3: StringAppendF(&contents, "inout List<String> a%d", j); break;
+        case 4: StringAppendF(&contents, "@nullable IBinder a%d", j); break;
+        case 5:
+          if (size.types == 0) {
+            StringAppendF(&contents, "out int[] a%d", j);
+            break;
+          }
+          StringAppendF(&contents, "out %s a%d",
+                        ParcelableName(next_type++ % size.types).c_str(), j);
+          break;
+      }
+    }
+    contents += ");\n";
+  }
+  contents += "}\n";
+  return contents;
+}
+
+void AddBenchmarkInterface(const InputSize& size,
+                           FakeIoDelegate* io_delegate) {
+  for (int i = 0; i < size.types; ++i) {
+    const string name = ParcelableName(i);
+    io_delegate->AddStubParcelable(
+        name, StringPrintf("android/bench/types/Thing%d.h", i));
+  }
+  io_delegate->SetFileContents(kBenchmarkInterface, MakeInterface(size));
+}
+
+string MakePreprocessedFile(int types, bool binary) {
+  string contents;
+  BinaryPreprocessedWriter writer;
+  for (int i = 0; i < types; ++i) {
+    const string name = ParcelableName(i);
+    if (binary) {
+      writer.Add(PreprocessedKind::PARCELABLE, name);
+    } else {
+      StringAppendF(&contents, "parcelable %s;\n", name.c_str());
+    }
+  }
+  if (binary && !writer.Finish(&contents)) {
+    contents.clear();
+  }
+  return contents;
+}
+
+}  // namespace test
+}  // namespace aidl
+}  // namespace android
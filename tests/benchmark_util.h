@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2018, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef AIDL_TESTS_BENCHMARK_UTIL_H_
+#define AIDL_TESTS_BENCHMARK_UTIL_H_
+
+#include <string>
+
+#include <benchmark/benchmark.h>
+
+#include "tests/fake_io_delegate.h"
+
+namespace android {
+namespace aidl {
+namespace test {
+
+// Path of the interface written by AddBenchmarkInterface().
+extern const char kBenchmarkInterface[];
+
+// Shape of a synthetic compiler input: an interface of |methods| methods
+// taking |args| arguments each, which imports |types| parcelables.
+struct InputSize {
+  int methods;
+  int args;
+  int types;
+};
+
+// Registers the input sizes the compiler benchmarks run over, growing one
+// dimension at a time from a typical interface.  Use with Apply().
+void InputSizes(benchmark::internal::Benchmark* benchmark);
+// Returns the input size a benchmark registered with InputSizes() runs on.
+InputSize GetInputSize(const benchmark::State& state);
+
+// Returns the contents of an interface of the given |size|.
+std::string MakeInterface(const InputSize& size);
+// Writes an interface of the given |size| to kBenchmarkInterface in
+// |io_delegate|, along with the parcelables it imports.
+void AddBenchmarkInterface(const InputSize& size, FakeIoDelegate* io_delegate);
+
+// Returns a preprocessed file declaring |types| parcelables, in the binary
+// format if |binary| is set.
+std::string MakePreprocessedFile(int types, bool binary);
+
+}  // namespace test
+}  // namespace aidl
+}  // namespace android
+
+#endif  // AIDL_TESTS_BENCHMARK_UTIL_H_
@@ -0,0 +1,291 @@
+/*
+ * Copyright (C) 2018, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "tests/corpus_generator.h"
+
+#include <algorithm>
+#include <set>
+
+#include <android-base/macros.h>
+#include <android-base/stringprintf.h>
+#include <android-base/strings.h>
+
+#include "preprocessed_file.h"
+
+using android::base::Join;
+using android::base::StringAppendF;
+using android::base::StringPrintf;
+using std::set;
+using std::string;
+using std::vector;
+
+namespace android {
+namespace aidl {
+namespace test {
+namespace {
+
+// SplitMix64, which unlike the <random> distributions produces the same
+// numbers with every standard library.
+class Random {
+ public:
+  explicit Random(uint64_t seed) : state_(seed) {}
+
+  uint64_t Next() {
+    uint64_t z = (state_ += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+  }
+  // Returns a number in [0, n), or 0 if |n| is 0.
+  size_t Below(size_t n) { return (n == 0) ? 0 : Next() % n; }
+  // Returns true once in |n| times.
+  bool OneIn(size_t n) { return Below(n) == 0; }
+
+ private:
+  uint64_t state_;
+};
+
+// A type declared in the corpus.
+struct Declaration {
+  string package;
+  string name;
+  string root;
+  bool is_interface;
+
+  string CanonicalName() const { return package + "." + name; }
+  string Path() const {
+    string folder = package;
+    std::replace(folder.begin(), folder.end(), '.', '/');
+    return root + "/" + folder + "/" + name + ".aidl";
+  }
+};
+
+const char* const kPrimitives[] = {"int", "long", "boolean"};
+// Types which may be passed in any direction.
+const char* const kContainers[] = {"int[]", "long[]", "String[]",
+                                   "List<String>"};
+const char* const kDirections[] = {"in", "out", "inout"};
+
+class Generator {
+ public:
+  Generator(const CorpusShape& shape, Corpus* corpus)
+      : shape_(shape), corpus_(corpus), random_(shape.seed) {}
+
+  void Run() {
+    const size_t packages = std::max<size_t>(shape_.packages, 1);
+    const size_t roots = std::max<size_t>(shape_.import_roots, 1);
+    for (size_t i = 0; i < roots; ++i) {
+      corpus_->import_roots.push_back(StringPrintf("root%zu", i));
+    }
+    auto declare = [&](const string& name, size_t index, bool is_interface) {
+      const size_t package = index % packages;
+      return Declaration{StringPrintf("corpus.pkg%zu", package), name,
+                         corpus_->import_roots[package % roots],
+                         is_interface};
+    };
+
+    for (size_t i = 0; i < shape_.parcelables; ++i) {
+      parcelables_.push_back(declare(StringPrintf("Data%zu", i), i, false));
+      AddParcelable(parcelables_.back());
+    }
+
+    // Layers are contiguous runs of interfaces, so interface i only takes
+    // interfaces numbered above it as arguments and imports never cycle.
+    const size_t depth = std::max<size_t>(shape_.import_depth, 1);
+    vector<Declaration> interfaces;
+    vector<size_t> layer_begin(depth + 1, shape_.interfaces);
+    for (size_t i = 0; i < shape_.interfaces; ++i) {
+      interfaces.push_back(declare(StringPrintf("IService%zu", i), i, true));
+      const size_t layer = i * depth / shape_.interfaces;
+      layer_begin[layer] = std::min(layer_begin[layer], i);
+    }
+    for (size_t i = 0; i < shape_.interfaces; ++i) {
+      const size_t layer = i * depth / shape_.interfaces;
+      vector<const Declaration*> next_layer;
+      for (size_t j = layer_begin[layer + 1];
+           j < shape_.interfaces && j * depth / shape_.interfaces == layer + 1;
+           ++j) {
+        next_layer.push_back(&interfaces[j]);
+      }
+      AddInterface(interfaces[i], next_layer, 1 + random_.Below(
+          std::max<size_t>(shape_.max_methods, 1)));
+    }
+
+    const size_t t = shape_.outline_threshold;
+    const size_t outlined_methods[] = {(t > 1) ? t - 1 : 1,
+                                       std::max<size_t>(t, 1), t + 1,
+                                       2 * t + 1};
+    for (size_t i = 0; i < shape_.outlined_interfaces; ++i) {
+      AddInterface(declare(StringPrintf("IOutlined%zu", i), i, true), {},
+                   outlined_methods[i % 4]);
+    }
+
+    AddPreprocessedFiles();
+    corpus_->files["interfaces.txt"] = Join(corpus_->interfaces, "\n") + "\n";
+  }
+
+ private:
+  void AddParcelable(const Declaration& parcelable) {
+    string header = parcelable.CanonicalName();
+    std::replace(header.begin(), header.end(), '.', '/');
+    corpus_->files[parcelable.Path()] = StringPrintf(
+        "package %s;\n\nparcelable %s cpp_header \"%s.h\";\n",
+        parcelable.package.c_str(), parcelable.name.c_str(), header.c_str());
+  }
+
+  // Adds |interface| with |methods| methods, taking interfaces from
+  // |next_layer| and parcelables as arguments.
+  void AddInterface(const Declaration& interface,
+                    const vector<const Declaration*>& next_layer,
+                    size_t methods) {
+    // Interfaces below the last layer always import one from the next, so
+    // that chains of imports run as deep as the layers.
+    vector<const Declaration*> imports;
+    set<string> imported;
+    const size_t import_count = random_.Below(shape_.max_imports + 1);
+    for (size_t i = 0; i < import_count || (i == 0 && !next_layer.empty());
+         ++i) {
+      const Declaration* import = nullptr;
+      if (!next_layer.empty() && (i == 0 || random_.OneIn(2))) {
+        import = next_layer[random_.Below(next_layer.size())];
+      } else if (!parcelables_.empty()) {
+        import = &parcelables_[random_.Below(parcelables_.size())];
+      }
+      if (import && imported.insert(import->CanonicalName()).second) {
+        imports.push_back(import);
+      }
+    }
+
+    string contents = StringPrintf("package %s;\n\n",
+                                   interface.package.c_str());
+    for (const Declaration* import : imports) {
+      StringAppendF(&contents, "import %s;\n",
+                    import->CanonicalName().c_str());
+    }
+    StringAppendF(&contents,
+                  "\n/** Generated interface %s. */\ninterface %s {\n",
+                  interface.name.c_str(), interface.name.c_str());
+    const size_t constants = random_.Below(4);
+    for (size_t i = 0; i < constants; ++i) {
+      StringAppendF(&contents, "  const int CONSTANT_%zu = %zu;\n", i,
+                    static_cast<size_t>(random_.Below(1 << 16)));
+    }
+    for (size_t i = 0; i < methods; ++i) {
+      AddMethod(i, imports, &contents);
+    }
+    contents += "}\n";
+
+    corpus_->files[interface.Path()] = contents;
+    corpus_->interfaces.push_back(interface.Path());
+  }
+
+  void AddMethod(size_t index, const vector<const Declaration*>& imports,
+                 string* contents) {
+    const bool oneway = random_.OneIn(8);
+    if (random_.OneIn(2)) {
+      StringAppendF(contents, "  /**\n   * Generated method %zu.\n   */\n",
+                    index);
+    }
+    string return_type = "void";
+    if (!oneway) {
+      switch (random_.Below(4)) {
+        case 0: return_type = kPrimitives[random_.Below(3)]; break;
+        case 1: return_type = "String"; break;
+        case 2: return_type = kContainers[random_.Below(4)]; break;
+        default: break;
+      }
+    }
+    StringAppendF(contents, "  %s%s call%zu(", oneway ? "oneway " : "",
+                  return_type.c_str(), index);
+    const size_t args = random_.Below(shape_.max_args + 1);
+    for (size_t i = 0; i < args; ++i) {
+      if (i > 0) {
+        *contents += ", ";
+      }
+      // Only containers and parcelables may be passed out, and only by
+      // methods which wait for a reply.
+      const char* direction = oneway ? "in" : kDirections[random_.Below(3)];
+      string argument;
+      const size_t kind = random_.Below(imports.empty() ? 5 : 6);
+      switch (kind) {
+        case 0:
+          argument = StringPrintf("in %s", kPrimitives[random_.Below(3)]);
+          break;
+        case 1:
+          argument = random_.OneIn(4) ? "@nullable String" : "String";
+          break;
+        case 2:
+          argument = random_.OneIn(4) ? "@nullable IBinder" : "IBinder";
+          break;
+        case 3:
+        case 4:
+          argument = StringPrintf("%s %s", direction,
+                                  kContainers[random_.Below(4)]);
+          break;
+        default: {
+          const Declaration* type = imports[random_.Below(imports.size())];
+          argument = StringPrintf("%s %s",
+                                  type->is_interface ? "in" : direction,
+                                  type->name.c_str());
+          break;
+        }
+      }
+      StringAppendF(contents, "%s arg%zu", argument.c_str(), i);
+    }
+    *contents += ");\n";
+  }
+
+  void AddPreprocessedFiles() {
+    string text;
+    BinaryPreprocessedWriter binary;
+    for (size_t i = 0; i < shape_.preprocessed_entries; ++i) {
+      const bool is_interface = random_.OneIn(4);
+      const string name = StringPrintf(
+          "corpus.sdk%zu.%s%zu", i % 97, is_interface ? "ISdk" : "Sdk", i);
+      StringAppendF(&text, "%s %s;\n",
+                    is_interface ? "interface" : "parcelable", name.c_str());
+      binary.Add(is_interface ? PreprocessedKind::INTERFACE
+                              : PreprocessedKind::PARCELABLE,
+                 name);
+    }
+    corpus_->text_preprocessed_file = "sdk.txt";
+    corpus_->files[corpus_->text_preprocessed_file] = text;
+    string contents;
+    if (binary.Finish(&contents)) {
+      corpus_->binary_preprocessed_file = "sdk.bin";
+      corpus_->files[corpus_->binary_preprocessed_file] = contents;
+    }
+  }
+
+  const CorpusShape& shape_;
+  Corpus* const corpus_;
+  Random random_;
+  vector<Declaration> parcelables_;
+
+  DISALLOW_COPY_AND_ASSIGN(Generator);
+};
+
+}  // namespace
+
+void GenerateCorpus(const CorpusShape& shape, Corpus* corpus) {
+  *corpus = Corpus();
+  Generator(shape, corpus).Run();
+}
+
+}  // namespace test
+}  // namespace aidl
+}  // namespace android
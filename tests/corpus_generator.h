@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2018, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef AIDL_TESTS_CORPUS_GENERATOR_H_
+#define AIDL_TESTS_CORPUS_GENERATOR_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace android {
+namespace aidl {
+namespace test {
+
+// Shape of a synthetic corpus of AIDL files.  The same shape always yields
+// the same corpus, on every host.
+struct CorpusShape {
+  uint64_t seed = 1;
+  // Interfaces are spread over |packages| packages, whose files are spread
+  // over |import_roots| import roots.
+  size_t interfaces = 100;
+  size_t parcelables = 50;
+  size_t packages = 10;
+  size_t import_roots = 2;
+  // Upper bounds of the methods of an interface, of the arguments of a
+  // method and of the imports of a file.
+  size_t max_methods = 32;
+  size_t max_args = 6;
+  size_t max_imports = 8;
+  // Interfaces are split in |import_depth| layers, and only take interfaces
+  // of the next layer as arguments, so the longest chain of imports between
+  // interfaces is |import_depth| files long.
+  size_t import_depth = 4;
+  // Declarations of the preprocessed files, which the corpus does not use
+  // but which fill the type namespace like an SDK does.
+  size_t preprocessed_entries = 1000;
+  // Interfaces, on top of |interfaces|, with about |outline_threshold|
+  // methods, so that the Java generator outlines some of their onTransact
+  // cases.
+  size_t outlined_interfaces = 4;
+  size_t outline_threshold = 275;
+};
+
+// A generated corpus.  Paths are relative to the directory of the corpus.
+struct Corpus {
+  // Contents of every file, keyed by path.
+  std::map<std::string, std::string> files;
+  std::vector<std::string> import_roots;
+  // Paths of the interfaces, which each compile on their own given the
+  // import roots and either preprocessed file.
+  std::vector<std::string> interfaces;
+  std::string text_preprocessed_file;
+  std::string binary_preprocessed_file;
+};
+
+// Stores the corpus described by |shape| to |*corpus|.  Along with the AIDL
+// files, it holds a list of the interfaces, one per line, which can serve as
+// a batch file.
+void GenerateCorpus(const CorpusShape& shape, Corpus* corpus);
+
+}  // namespace test
+}  // namespace aidl
+}  // namespace android
+
+#endif  // AIDL_TESTS_CORPUS_GENERATOR_H_
@@ -35,6 +35,9 @@ namespace test {
 // Claims to always write successfully, but can't close the file.
 class BrokenCodeWriter : public CodeWriter {
   bool Write(const char* /* format */, ...) override {  return true; }
+  bool AppendBytes(const char* /* data */, size_t /* length */) override {
+    return true;
+  }
   bool Close() override { return false; }
   virtual ~BrokenCodeWriter() = default;
 };  // class BrokenCodeWriter
@@ -55,6 +58,15 @@ unique_ptr<string> FakeIoDelegate::GetFileContents(
   return contents;
 }
 
+unique_ptr<SourceBuffer> FakeIoDelegate::GetSourceBuffer(
+    const string& filename) const {
+  unique_ptr<string> contents = GetFileContents(filename);
+  if (!contents) {
+    return nullptr;
+  }
+  return unique_ptr<SourceBuffer>(new SourceBuffer(std::move(contents)));
+}
+
 unique_ptr<LineReader> FakeIoDelegate::GetLineReader(
     const string& file_path) const {
   unique_ptr<LineReader> ret;
@@ -69,6 +81,45 @@ bool FakeIoDelegate::FileIsReadable(const string& path) const {
   return file_contents_.find(CleanPath(path)) != file_contents_.end();
 }
 
+bool FakeIoDelegate::ListFiles(const string& dir,
+                               vector<string>* files) const {
+  string prefix = CleanPath(dir);
+  if (prefix == ".") {
+    prefix.clear();
+  }
+  if (!prefix.empty() && prefix.back() != OS_PATH_SEPARATOR) {
+    prefix += OS_PATH_SEPARATOR;
+  }
+  bool found = prefix.empty();
+  for (const auto& it : file_contents_) {
+    if (it.first.compare(0, prefix.size(), prefix) == 0) {
+      files->push_back(it.first.substr(prefix.size()));
+      found = true;
+    }
+  }
+  // Directories only exist here as the parents of files.
+  return found;
+}
+
+bool FakeIoDelegate::GetModificationTime(const string& path,
+                                         int64_t* mtime) const {
+  auto it = file_versions_.find(CleanPath(path));
+  if (it == file_versions_.end()) {
+    return false;
+  }
+  *mtime = it->second;
+  return true;
+}
+
+bool FakeIoDelegate::GetFileSize(const string& path, int64_t* size) const {
+  auto it = file_contents_.find(CleanPath(path));
+  if (it == file_contents_.end()) {
+    return false;
+  }
+  *size = it->second.size();
+  return true;
+}
+
 bool FakeIoDelegate::CreatedNestedDirs(
     const std::string& /* base_dir */,
     const std::vector<std::string>& /* nested_subdirs */) const {
@@ -81,18 +132,32 @@ std::unique_ptr<CodeWriter> FakeIoDelegate::GetCodeWriter(
   if (broken_files_.count(file_path) > 0) {
     return unique_ptr<CodeWriter>(new BrokenCodeWriter);
   }
+  std::lock_guard<std::mutex> guard(written_lock_);
   removed_files_.erase(file_path);
   written_file_contents_[file_path] = "";
   return GetStringWriter(&written_file_contents_[file_path]);
 }
 
 void FakeIoDelegate::RemovePath(const std::string& file_path) const {
+  std::lock_guard<std::mutex> guard(written_lock_);
   removed_files_.insert(file_path);
 }
 
+bool FakeIoDelegate::WriteFileAtomically(const string& path,
+                                         const string& contents) const {
+  if (broken_files_.count(path) > 0) {
+    return false;
+  }
+  std::lock_guard<std::mutex> guard(written_lock_);
+  removed_files_.erase(path);
+  written_file_contents_[path] = contents;
+  return true;
+}
+
 void FakeIoDelegate::SetFileContents(const string& filename,
                                      const string& contents) {
   file_contents_[filename] = contents;
+  ++file_versions_[filename];
 }
 
 void FakeIoDelegate::AddStubParcelable(const string& canonical_name,
@@ -136,6 +201,7 @@ void FakeIoDelegate::AddBrokenFilePath(const std::string& path) {
 }
 
 bool FakeIoDelegate::GetWrittenContents(const string& path, string* content) {
+  std::lock_guard<std::mutex> guard(written_lock_);
   const auto it = written_file_contents_.find(path);
   if (it == written_file_contents_.end()) {
     return false;
@@ -147,6 +213,7 @@ bool FakeIoDelegate::GetWrittenContents(const string& path, string* content) {
 }
 
 bool FakeIoDelegate::PathWasRemoved(const std::string& path) {
+  std::lock_guard<std::mutex> guard(written_lock_);
   if (removed_files_.count(path) > 0) {
     return true;
   }
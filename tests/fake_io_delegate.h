@@ -21,6 +21,7 @@
 
 #include <map>
 #include <memory>
+#include <mutex>
 #include <set>
 #include <string>
 #include <vector>
@@ -40,15 +41,24 @@ class FakeIoDelegate : public IoDelegate {
   std::unique_ptr<std::string> GetFileContents(
       const std::string& filename,
       const std::string& append_content_suffix = "") const override;
+  std::unique_ptr<SourceBuffer> GetSourceBuffer(
+      const std::string& filename) const override;
   std::unique_ptr<LineReader> GetLineReader(
       const std::string& file_path) const override;
   bool FileIsReadable(const std::string& path) const override;
+  bool ListFiles(const std::string& dir,
+                 std::vector<std::string>* files) const override;
+  bool GetModificationTime(const std::string& path,
+                           int64_t* mtime) const override;
+  bool GetFileSize(const std::string& path, int64_t* size) const override;
   bool CreatedNestedDirs(
       const std::string& base_dir,
       const std::vector<std::string>& nested_subdirs) const override;
   std::unique_ptr<CodeWriter> GetCodeWriter(
       const std::string& file_path) const override;
   void RemovePath(const std::string& file_path) const override;
+  bool WriteFileAtomically(const std::string& path,
+                           const std::string& contents) const override;
 
   // Methods added to facilitate testing.
   void SetFileContents(const std::string& filename,
@@ -70,6 +80,12 @@ class FakeIoDelegate : public IoDelegate {
   std::string CleanPath(const std::string& path) const;
 
   std::map<std::string, std::string> file_contents_;
+  // Counts the calls to SetFileContents() for each file, standing in for its
+  // modification time.
+  std::map<std::string, int64_t> file_versions_;
+  // Guards |written_file_contents_| and |removed_files_|, since batches may
+  // write from several threads.
+  mutable std::mutex written_lock_;
   // Normally, writing to files leaves the IoDelegate unchanged, so
   // GetCodeWriter is a const method.  However, for tests, we break this
   // intentionally by storing the written strings.
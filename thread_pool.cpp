@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2018, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "thread_pool.h"
+
+using std::function;
+using std::lock_guard;
+using std::mutex;
+using std::unique_lock;
+
+namespace android {
+namespace aidl {
+namespace {
+
+thread_local bool on_worker_thread = false;
+
+}  // namespace
+
+ThreadPool::ThreadPool(size_t num_threads) {
+  if (num_threads == 0) {
+    num_threads = 1;
+  }
+  for (size_t i = 0; i < num_threads; ++i) {
+    queues_.emplace_back(new TaskQueue);
+  }
+  for (size_t i = 0; i < num_threads; ++i) {
+    threads_.emplace_back(&ThreadPool::WorkerLoop, this, i);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  Wait();
+  {
+    lock_guard<mutex> guard(lock_);
+    shutting_down_ = true;
+  }
+  work_available_.notify_all();
+  for (std::thread& thread : threads_) {
+    thread.join();
+  }
+}
+
+void ThreadPool::Post(function<void()> task) {
+  size_t queue;
+  {
+    // Count the task first, so that it can never finish before it is counted.
+    lock_guard<mutex> guard(lock_);
+    queue = next_queue_;
+    next_queue_ = (next_queue_ + 1) % queues_.size();
+    ++queued_;
+    ++pending_;
+  }
+  {
+    lock_guard<mutex> guard(queues_[queue]->lock);
+    queues_[queue]->tasks.push_back(std::move(task));
+  }
+  work_available_.notify_one();
+}
+
+void ThreadPool::Wait() {
+  unique_lock<mutex> guard(lock_);
+  all_done_.wait(guard, [this] { return pending_ == 0; });
+}
+
+bool ThreadPool::TakeTask(size_t worker, function<void()>* task) {
+  for (size_t i = 0; i < queues_.size(); ++i) {
+    TaskQueue* queue = queues_[(worker + i) % queues_.size()].get();
+    lock_guard<mutex> guard(queue->lock);
+    if (queue->tasks.empty()) {
+      continue;
+    }
+    if (i == 0) {
+      *task = std::move(queue->tasks.front());
+      queue->tasks.pop_front();
+    } else {
+      *task = std::move(queue->tasks.back());
+      queue->tasks.pop_back();
+    }
+    return true;
+  }
+  return false;
+}
+
+bool ThreadPool::OnWorkerThread() {
+  return on_worker_thread;
+}
+
+void ThreadPool::WorkerLoop(size_t worker) {
+  on_worker_thread = true;
+  while (true) {
+    function<void()> task;
+    if (TakeTask(worker, &task)) {
+      {
+        lock_guard<mutex> guard(lock_);
+        --queued_;
+      }
+      task();
+      lock_guard<mutex> guard(lock_);
+      if (--pending_ == 0) {
+        all_done_.notify_all();
+      }
+      continue;
+    }
+
+    unique_lock<mutex> guard(lock_);
+    work_available_.wait(guard, [this] {
+      return shutting_down_ || queued_ > 0;
+    });
+    if (shutting_down_ && queued_ == 0) {
+      return;
+    }
+  }
+}
+
+}  // namespace aidl
+}  // namespace android
@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2018, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AIDL_THREAD_POOL_H_
+#define AIDL_THREAD_POOL_H_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <android-base/macros.h>
+
+namespace android {
+namespace aidl {
+
+// Runs tasks on a fixed set of worker threads.  Every worker owns a queue of
+// tasks; it runs tasks from the front of its own queue and, once that is
+// empty, steals tasks from the back of the other workers' queues.
+class ThreadPool {
+ public:
+  explicit ThreadPool(size_t num_threads);
+  // Waits for all posted tasks to finish before joining the workers.
+  ~ThreadPool();
+
+  // Queues |task| to be run on one of the workers.
+  void Post(std::function<void()> task);
+  // Blocks until every task posted so far has finished.
+  void Wait();
+
+  size_t NumThreads() const { return threads_.size(); }
+
+  // Whether the calling thread is a worker of any ThreadPool.  Work that is
+  // already spread over a pool should not start pools of its own.
+  static bool OnWorkerThread();
+
+ private:
+  struct TaskQueue {
+    std::mutex lock;
+    std::deque<std::function<void()>> tasks;
+  };
+
+  // Pops a task for |worker| from its own queue or steals one from another.
+  bool TakeTask(size_t worker, std::function<void()>* task);
+  void WorkerLoop(size_t worker);
+
+  std::vector<std::unique_ptr<TaskQueue>> queues_;
+  std::vector<std::thread> threads_;
+
+  // Guards everything below.
+  std::mutex lock_;
+  std::condition_variable work_available_;
+  std::condition_variable all_done_;
+  size_t next_queue_ = 0;
+  // Tasks sitting in a queue.
+  size_t queued_ = 0;
+  // Tasks posted but not yet finished.
+  size_t pending_ = 0;
+  bool shutting_down_ = false;
+
+  DISALLOW_COPY_AND_ASSIGN(ThreadPool);
+};
+
+}  // namespace aidl
+}  // namespace android
+
+#endif  // AIDL_THREAD_POOL_H_
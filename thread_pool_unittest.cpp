@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2018, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "thread_pool.h"
+
+using std::atomic;
+using std::vector;
+
+namespace android {
+namespace aidl {
+
+TEST(ThreadPoolTest, RunsEveryTask) {
+  ThreadPool pool(4);
+  EXPECT_EQ(4u, pool.NumThreads());
+  vector<int> results(100, 0);
+  for (size_t i = 0; i < results.size(); ++i) {
+    pool.Post([&results, i]() { results[i] = static_cast<int>(i) * 2; });
+  }
+  pool.Wait();
+  for (size_t i = 0; i < results.size(); ++i) {
+    EXPECT_EQ(static_cast<int>(i) * 2, results[i]);
+  }
+}
+
+TEST(ThreadPoolTest, TasksCanPostMoreTasks) {
+  ThreadPool pool(2);
+  atomic<int> count{0};
+  for (int i = 0; i < 10; ++i) {
+    pool.Post([&pool, &count]() {
+      ++count;
+      pool.Post([&count]() { ++count; });
+    });
+  }
+  pool.Wait();
+  EXPECT_EQ(20, count.load());
+}
+
+TEST(ThreadPoolTest, CanBeReusedAfterWait) {
+  ThreadPool pool(3);
+  atomic<int> count{0};
+  pool.Wait();
+  for (int round = 1; round <= 3; ++round) {
+    for (int i = 0; i < 7; ++i) {
+      pool.Post([&count]() { ++count; });
+    }
+    pool.Wait();
+    EXPECT_EQ(round * 7, count.load());
+  }
+}
+
+TEST(ThreadPoolTest, DestructorFinishesPostedTasks) {
+  atomic<int> count{0};
+  {
+    ThreadPool pool(0);
+    EXPECT_EQ(1u, pool.NumThreads());
+    for (int i = 0; i < 5; ++i) {
+      pool.Post([&count]() { ++count; });
+    }
+  }
+  EXPECT_EQ(5, count.load());
+}
+
+TEST(ThreadPoolTest, KnowsItsWorkerThreads) {
+  EXPECT_FALSE(ThreadPool::OnWorkerThread());
+  ThreadPool pool(2);
+  atomic<bool> on_worker{false};
+  pool.Post([&on_worker]() { on_worker = ThreadPool::OnWorkerThread(); });
+  pool.Wait();
+  EXPECT_TRUE(on_worker.load());
+  EXPECT_FALSE(ThreadPool::OnWorkerThread());
+}
+
+}  // namespace aidl
+}  // namespace android
@@ -0,0 +1,206 @@
+/*
+ * Copyright (C) 2018, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "timings.h"
+
+#include <time.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include <android-base/stringprintf.h>
+
+using android::base::StringAppendF;
+using std::string;
+using std::vector;
+
+namespace android {
+namespace aidl {
+namespace {
+
+// What the calling thread is compiling; see TimedInput.
+thread_local Timings* current_timings = nullptr;
+thread_local const string* current_input = nullptr;
+
+string JsonTime(int64_t wall_ns, int64_t cpu_ns) {
+  return android::base::StringPrintf("{\"wall_ms\": %.3f, \"cpu_ms\": %.3f}",
+                                     wall_ns / 1e6, cpu_ns / 1e6);
+}
+
+}  // namespace
+
+const char* PhaseName(Phase phase) {
+  switch (phase) {
+    case Phase::INIT_TYPES: return "init_types";
+    case Phase::LOAD_PREPROCESSED: return "load_preprocessed";
+    case Phase::PARSE_INPUT: return "parse_input";
+    case Phase::RESOLVE_IMPORTS: return "resolve_imports";
+    case Phase::PARSE_IMPORTS: return "parse_imports";
+    case Phase::GATHER_TYPES: return "gather_types";
+    case Phase::CHECK_TYPES: return "check_types";
+    case Phase::ASSIGN_METHOD_IDS: return "assign_method_ids";
+    case Phase::BUILD_AST: return "build_ast";
+    case Phase::WRITE_OUTPUT: return "write_output";
+  }
+  return "unknown";
+}
+
+int64_t ThreadCpuTimeNs() {
+#ifdef _WIN32
+  FILETIME creation, exit, kernel, user;
+  if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user)) {
+    return 0;
+  }
+  // FILETIMEs count 100ns intervals.
+  auto to_ns = [](const FILETIME& t) {
+    return ((static_cast<int64_t>(t.dwHighDateTime) << 32) |
+            t.dwLowDateTime) * 100;
+  };
+  return to_ns(kernel) + to_ns(user);
+#else
+  struct timespec now;
+  if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now) != 0) {
+    return 0;
+  }
+  return static_cast<int64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+#endif
+}
+
+Timings::Timings() : start_(std::chrono::steady_clock::now()) {}
+
+void Timings::Record(const string& input, Phase phase, int64_t wall_ns,
+                     int64_t cpu_ns) {
+  const size_t i = static_cast<size_t>(phase);
+  std::lock_guard<std::mutex> guard(lock_);
+  totals_[i].wall_ns += wall_ns;
+  totals_[i].cpu_ns += cpu_ns;
+  if (!input.empty()) {
+    Time& time = inputs_[input][i];
+    time.wall_ns += wall_ns;
+    time.cpu_ns += cpu_ns;
+  }
+}
+
+string Timings::ToJson(size_t max_slowest) const {
+  const int64_t elapsed_ns =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now() - start_).count();
+  auto append_phases = [](const PhaseTimes& times, const string& indent,
+                          string* out) {
+    *out += "{\n";
+    for (size_t i = 0; i < kNumPhases; ++i) {
+      StringAppendF(out, "%s  %s: %s%s\n", indent.c_str(),
+                    JsonString(PhaseName(static_cast<Phase>(i))).c_str(),
+                    JsonTime(times[i].wall_ns, times[i].cpu_ns).c_str(),
+                    i + 1 < kNumPhases ? "," : "");
+    }
+    *out += indent + "}";
+  };
+  auto sum = [](const PhaseTimes& times) {
+    Time total;
+    for (const Time& time : times) {
+      total.wall_ns += time.wall_ns;
+      total.cpu_ns += time.cpu_ns;
+    }
+    return total;
+  };
+
+  std::lock_guard<std::mutex> guard(lock_);
+  vector<std::pair<int64_t, const string*>> slowest;
+  for (const auto& input : inputs_) {
+    slowest.emplace_back(sum(input.second).wall_ns, &input.first);
+  }
+  // Slowest first, ties by name so that the report is stable.
+  std::sort(slowest.begin(), slowest.end(),
+            [](const std::pair<int64_t, const string*>& a,
+               const std::pair<int64_t, const string*>& b) {
+              return a.first != b.first ? a.first > b.first
+                                        : *a.second < *b.second;
+            });
+  slowest.resize(std::min(slowest.size(), max_slowest));
+
+  const Time total = sum(totals_);
+  string out = "{\n";
+  StringAppendF(&out, "  \"elapsed_ms\": %.3f,\n", elapsed_ns / 1e6);
+  out += "  \"inputs\": " + std::to_string(inputs_.size()) + ",\n";
+  StringAppendF(&out, "  \"total\": %s,\n",
+                JsonTime(total.wall_ns, total.cpu_ns).c_str());
+  out += "  \"phases\": ";
+  append_phases(totals_, "  ", &out);
+  out += ",\n  \"slowest_inputs\": [";
+  for (size_t i = 0; i < slowest.size(); ++i) {
+    const PhaseTimes& times = inputs_.at(*slowest[i].second);
+    const Time input_total = sum(times);
+    StringAppendF(&out, "%s\n    {\n      \"input\": %s,\n      \"total\": %s,\n",
+                  i == 0 ? "" : ",", JsonString(*slowest[i].second).c_str(),
+                  JsonTime(input_total.wall_ns, input_total.cpu_ns).c_str());
+    out += "      \"phases\": ";
+    append_phases(times, "      ", &out);
+    out += "\n    }";
+  }
+  out += slowest.empty() ? "]\n" : "\n  ]\n";
+  out += "}\n";
+  return out;
+}
+
+TimedInput::TimedInput(Timings* timings, const string& input)
+    : input_(input),
+      previous_timings_(current_timings),
+      previous_input_(current_input),
+      span_(input.empty() ? "batch" : "compile", input) {
+  current_timings = timings;
+  current_input = &input_;
+}
+
+TimedInput::~TimedInput() {
+  current_timings = previous_timings_;
+  current_input = previous_input_;
+}
+
+PhaseTimer::PhaseTimer(Phase phase)
+    : phase_(phase),
+      timings_(current_timings),
+      input_(current_input),
+      span_(PhaseName(phase)),
+      mem_phase_(phase) {
+  if (timings_) {
+    wall_start_ = std::chrono::steady_clock::now();
+    cpu_start_ = ThreadCpuTimeNs();
+  }
+}
+
+void PhaseTimer::Stop() {
+  span_.End();
+  mem_phase_.End();
+  if (!timings_) {
+    return;
+  }
+  const int64_t wall_ns =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now() - wall_start_).count();
+  timings_->Record(*input_, phase_, wall_ns,
+                   ThreadCpuTimeNs() - cpu_start_);
+  timings_ = nullptr;
+}
+
+}  // namespace aidl
+}  // namespace android
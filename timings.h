@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2018, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef AIDL_TIMINGS_H_
+#define AIDL_TIMINGS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <array>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+
+#include <android-base/macros.h>
+
+#include "mem_stats.h"
+#include "trace.h"
+
+namespace android {
+namespace aidl {
+
+// The phases of compiling one input, in the order they run.
+enum class Phase {
+  INIT_TYPES,
+  LOAD_PREPROCESSED,
+  PARSE_INPUT,
+  RESOLVE_IMPORTS,
+  PARSE_IMPORTS,
+  GATHER_TYPES,
+  CHECK_TYPES,
+  ASSIGN_METHOD_IDS,
+  BUILD_AST,
+  WRITE_OUTPUT,
+};
+constexpr size_t kNumPhases = static_cast<size_t>(Phase::WRITE_OUTPUT) + 1;
+
+const char* PhaseName(Phase phase);
+
+// The CPU time used so far by the calling thread, in nanoseconds.
+int64_t ThreadCpuTimeNs();
+
+// The wall and CPU time spent in each phase, for each input and in total.
+// Safe to record into from several threads at once.
+class Timings {
+ public:
+  Timings();
+  ~Timings() = default;
+
+  // Adds to the time spent in |phase| for |input|.  Time spent on no input
+  // in particular, such as loading preprocessed files once for a whole
+  // batch, is recorded for the empty |input|, and only counts towards the
+  // totals.
+  void Record(const std::string& input, Phase phase, int64_t wall_ns,
+              int64_t cpu_ns);
+
+  // Returns the report as JSON: the time since this object was created, the
+  // totals of each phase, and the |max_slowest| inputs that took the most
+  // wall time, with the time of each of their phases.
+  std::string ToJson(size_t max_slowest) const;
+
+ private:
+  struct Time {
+    int64_t wall_ns = 0;
+    int64_t cpu_ns = 0;
+  };
+  using PhaseTimes = std::array<Time, kNumPhases>;
+
+  const std::chrono::steady_clock::time_point start_;
+  mutable std::mutex lock_;
+  PhaseTimes totals_;
+  std::map<std::string, PhaseTimes> inputs_;
+
+  DISALLOW_COPY_AND_ASSIGN(Timings);
+};
+
+// For as long as it lives, makes the phases timed on the calling thread
+// count towards compiling |input| in |timings|.  Nothing is timed while
+// |timings| is nullptr.  Also traces the compilation of |input| as a span.
+class TimedInput {
+ public:
+  TimedInput(Timings* timings, const std::string& input);
+  ~TimedInput();
+
+ private:
+  const std::string input_;
+  Timings* const previous_timings_;
+  const std::string* const previous_input_;
+  TraceSpan span_;
+
+  DISALLOW_COPY_AND_ASSIGN(TimedInput);
+};
+
+// Times the scope it lives in as |phase| of the input that the calling
+// thread is compiling, if that is being timed, traces it as a span, and
+// counts its allocations towards |phase|.
+class PhaseTimer {
+ public:
+  explicit PhaseTimer(Phase phase);
+  ~PhaseTimer() { Stop(); }
+
+  // Ends the phase before the end of the scope.
+  void Stop();
+
+ private:
+  const Phase phase_;
+  Timings* timings_;
+  const std::string* input_;
+  std::chrono::steady_clock::time_point wall_start_;
+  int64_t cpu_start_ = 0;
+  TraceSpan span_;
+  MemPhase mem_phase_;
+
+  DISALLOW_COPY_AND_ASSIGN(PhaseTimer);
+};
+
+}  // namespace aidl
+}  // namespace android
+
+#endif  // AIDL_TIMINGS_H_
@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2018, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "timings.h"
+
+using std::string;
+
+namespace android {
+namespace aidl {
+
+TEST(TimingsTest, ReportsPhasesAndSlowestInputs) {
+  Timings timings;
+  timings.Record("fast.aidl", Phase::PARSE_INPUT, 1000000, 500000);
+  timings.Record("slow.aidl", Phase::PARSE_INPUT, 2000000, 2000000);
+  timings.Record("slow.aidl", Phase::WRITE_OUTPUT, 3000000, 1000000);
+  timings.Record("", Phase::LOAD_PREPROCESSED, 4000000, 4000000);
+  timings.Record("odd\"name.aidl", Phase::BUILD_AST, 0, 0);
+
+  const string report = timings.ToJson(2);
+  EXPECT_NE(string::npos, report.find("\"inputs\": 3,"));
+  EXPECT_NE(string::npos,
+            report.find("\"total\": {\"wall_ms\": 10.000, \"cpu_ms\": 7.500}"));
+  EXPECT_NE(string::npos, report.find(
+      "\"load_preprocessed\": {\"wall_ms\": 4.000, \"cpu_ms\": 4.000}"));
+  EXPECT_NE(string::npos, report.find(
+      "\"parse_input\": {\"wall_ms\": 3.000, \"cpu_ms\": 2.500}"));
+  // Only the two slowest inputs are listed, slowest first.
+  const size_t slow = report.find("\"input\": \"slow.aidl\"");
+  const size_t fast = report.find("\"input\": \"fast.aidl\"");
+  ASSERT_NE(string::npos, slow);
+  ASSERT_NE(string::npos, fast);
+  EXPECT_LT(slow, fast);
+  EXPECT_EQ(string::npos, report.find("odd"));
+  EXPECT_NE(string::npos, timings.ToJson(3).find("\"odd\\\"name.aidl\""));
+}
+
+TEST(TimingsTest, TimesPhasesOfTheCurrentInput) {
+  Timings timings;
+  {
+    PhaseTimer untimed(Phase::PARSE_INPUT);
+  }
+  {
+    TimedInput input(&timings, "p/IFoo.aidl");
+    PhaseTimer timer(Phase::CHECK_TYPES);
+    {
+      TimedInput nested(nullptr, "p/IBar.aidl");
+      PhaseTimer untimed(Phase::PARSE_INPUT);
+    }
+  }
+  const string report = timings.ToJson(10);
+  EXPECT_NE(string::npos, report.find("\"inputs\": 1,"));
+  EXPECT_NE(string::npos, report.find("\"input\": \"p/IFoo.aidl\""));
+  EXPECT_EQ(string::npos, report.find("p/IBar.aidl"));
+}
+
+}  // namespace aidl
+}  // namespace android
@@ -0,0 +1,178 @@
+/*
+ * Copyright (C) 2018, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+#include <android-base/stringprintf.h>
+
+using android::base::StringAppendF;
+using std::shared_ptr;
+using std::string;
+using std::vector;
+
+namespace android {
+namespace aidl {
+
+namespace internals {
+std::atomic<bool> tracing_enabled{false};
+}  // namespace internals
+
+namespace {
+
+struct Event {
+  const char* name;
+  string detail;
+  int64_t start_ns;
+  int64_t duration_ns;
+};
+
+// The events of one thread.  Only that thread adds to it, so the lock is
+// only ever contended while the trace is being collected.
+struct ThreadEvents {
+  explicit ThreadEvents(int tid) : tid(tid) {}
+  const int tid;
+  std::mutex lock;
+  vector<Event> events;
+};
+
+// Guards everything below.
+std::mutex session_lock;
+// Bumped by each StartTracing() and StopTracing(), so that spans and
+// per-thread buffers outliving their session are dropped.
+std::atomic<uint64_t> current_session{0};
+std::chrono::steady_clock::time_point session_start;
+vector<shared_ptr<ThreadEvents>> thread_events;
+
+thread_local uint64_t thread_session = 0;
+// Shared, so that a span ending while the trace is collected cannot outlive
+// the buffer it writes to.
+thread_local shared_ptr<ThreadEvents> thread_buffer;
+
+int64_t NowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - session_start).count();
+}
+
+// Returns the calling thread's buffer for |session|, or nullptr if that is
+// over.
+shared_ptr<ThreadEvents> GetThreadEvents(uint64_t session) {
+  if (thread_session != session) {
+    std::lock_guard<std::mutex> guard(session_lock);
+    if (current_session.load() != session) {
+      return nullptr;
+    }
+    thread_events.emplace_back(
+        new ThreadEvents(static_cast<int>(thread_events.size()) + 1));
+    thread_buffer = thread_events.back();
+    thread_session = session;
+  }
+  return thread_buffer;
+}
+
+}  // namespace
+
+void StartTracing() {
+  std::lock_guard<std::mutex> guard(session_lock);
+  thread_events.clear();
+  session_start = std::chrono::steady_clock::now();
+  current_session.fetch_add(1);
+  internals::tracing_enabled.store(true);
+}
+
+string StopTracing() {
+  vector<shared_ptr<ThreadEvents>> threads;
+  {
+    std::lock_guard<std::mutex> guard(session_lock);
+    internals::tracing_enabled.store(false);
+    current_session.fetch_add(1);
+    threads.swap(thread_events);
+  }
+
+  string out = "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+  bool first = true;
+  for (const auto& thread : threads) {
+    std::lock_guard<std::mutex> guard(thread->lock);
+    vector<Event>& events = thread->events;
+    // Spans end innermost first; viewers want them in the order they start.
+    std::stable_sort(events.begin(), events.end(),
+                     [](const Event& a, const Event& b) {
+                       return std::tie(a.start_ns, b.duration_ns) <
+                              std::tie(b.start_ns, a.duration_ns);
+                     });
+    for (const Event& event : events) {
+      StringAppendF(&out,
+                    "%s\n{\"name\": %s, \"cat\": \"aidl\", \"ph\": \"X\", "
+                    "\"ts\": %.3f, \"dur\": %.3f, \"pid\": 1, \"tid\": %d",
+                    first ? "" : ",", JsonString(event.name).c_str(),
+                    event.start_ns / 1e3, event.duration_ns / 1e3,
+                    thread->tid);
+      if (!event.detail.empty()) {
+        StringAppendF(&out, ", \"args\": {\"detail\": %s}",
+                      JsonString(event.detail).c_str());
+      }
+      out += "}";
+      first = false;
+    }
+  }
+  out += "\n]}\n";
+  return out;
+}
+
+void TraceSpan::Begin(const char* name, const string* detail) {
+  session_ = current_session.load();
+  name_ = name;
+  if (detail != nullptr) {
+    detail_ = *detail;
+  }
+  start_ns_ = NowNs();
+}
+
+void TraceSpan::Finish() {
+  const int64_t end_ns = NowNs();
+  shared_ptr<ThreadEvents> events = GetThreadEvents(session_);
+  if (events != nullptr) {
+    std::lock_guard<std::mutex> guard(events->lock);
+    events->events.push_back(
+        Event{name_, std::move(detail_), start_ns_, end_ns - start_ns_});
+  }
+  name_ = nullptr;
+}
+
+string JsonString(const string& value) {
+  string out = "\"";
+  for (char c : value) {
+    if (c == '"' || c == '\\') {
+      out += '\\';
+      out += c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      StringAppendF(&out, "\\u%04x", c);
+    } else {
+      out += c;
+    }
+  }
+  return out + '"';
+}
+
+}  // namespace aidl
+}  // namespace android
@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2018, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef AIDL_TRACE_H_
+#define AIDL_TRACE_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <string>
+
+#include <android-base/macros.h>
+
+namespace android {
+namespace aidl {
+
+namespace internals {
+extern std::atomic<bool> tracing_enabled;
+}  // namespace internals
+
+// Starts recording the TraceSpans of every thread, dropping any recorded
+// before.
+void StartTracing();
+// Stops recording, and returns the spans recorded since StartTracing() in the
+// Chrome trace event format, for chrome://tracing or Perfetto.
+std::string StopTracing();
+
+// Records the scope it lives in as a span of the calling thread's timeline,
+// while tracing.  |name| must outlive the trace; it is usually a literal.
+// When not tracing, constructing and destroying a span costs a single
+// branch on a flag.
+class TraceSpan {
+ public:
+  explicit TraceSpan(const char* name) {
+    if (internals::tracing_enabled.load(std::memory_order_relaxed)) {
+      Begin(name, nullptr);
+    }
+  }
+  // As above, with |detail|, such as the file being worked on, attached.
+  TraceSpan(const char* name, const std::string& detail) {
+    if (internals::tracing_enabled.load(std::memory_order_relaxed)) {
+      Begin(name, &detail);
+    }
+  }
+  ~TraceSpan() { End(); }
+
+  // Ends the span before the end of the scope.
+  void End() {
+    if (name_ != nullptr) {
+      Finish();
+    }
+  }
+
+ private:
+  void Begin(const char* name, const std::string* detail);
+  void Finish();
+
+  const char* name_ = nullptr;
+  std::string detail_;
+  uint64_t session_ = 0;
+  int64_t start_ns_ = 0;
+
+  DISALLOW_COPY_AND_ASSIGN(TraceSpan);
+};
+
+// Returns |value| as a quoted JSON string.
+std::string JsonString(const std::string& value);
+
+}  // namespace aidl
+}  // namespace android
+
+#endif  // AIDL_TRACE_H_
@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2018, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <string>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include "trace.h"
+
+using std::string;
+
+namespace android {
+namespace aidl {
+
+TEST(TraceTest, RecordsNothingUnlessTracing) {
+  { TraceSpan span("before"); }
+  StartTracing();
+  TraceSpan open("open");
+  const string trace = StopTracing();
+  open.End();
+  { TraceSpan span("after"); }
+
+  EXPECT_EQ(string::npos, trace.find("before"));
+  EXPECT_EQ(string::npos, trace.find("open"));
+  StartTracing();
+  EXPECT_EQ(string::npos, StopTracing().find("after"));
+}
+
+TEST(TraceTest, RecordsSpansOfEachThread) {
+  StartTracing();
+  {
+    TraceSpan outer("outer", "p/IFoo.aidl");
+    TraceSpan inner("inner");
+  }
+  std::thread worker([]() { TraceSpan span("worker", "tab\there"); });
+  worker.join();
+  const string trace = StopTracing();
+
+  EXPECT_EQ(0u, trace.find("{\"displayTimeUnit\": \"ms\", \"traceEvents\": ["));
+  const size_t outer = trace.find("\"name\": \"outer\"");
+  const size_t inner = trace.find("\"name\": \"inner\"");
+  ASSERT_NE(string::npos, outer);
+  ASSERT_NE(string::npos, inner);
+  // Listed in the order they start, although the inner span ends first.
+  EXPECT_LT(outer, inner);
+  EXPECT_NE(string::npos, trace.find("\"args\": {\"detail\": \"p/IFoo.aidl\"}"));
+  EXPECT_NE(string::npos, trace.find("\"tid\": 1"));
+  EXPECT_NE(string::npos, trace.find("\"tid\": 2"));
+  EXPECT_NE(string::npos, trace.find("\"tab\\u0009here\""));
+}
+
+}  // namespace aidl
+}  // namespace android
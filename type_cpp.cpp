@@ -513,6 +513,13 @@ void TypeNamespace::Init() {
   Add(void_type_);
 }
 
+void TypeNamespace::InitFromParent(const TypeNamespace& parent) {
+  SetParent(&parent);
+  void_type_ = parent.void_type_;
+  string_type_ = parent.string_type_;
+  ibinder_type_ = parent.ibinder_type_;
+}
+
 bool TypeNamespace::AddParcelableType(const AidlParcelable& p,
                                       const string& filename) {
   if (p.GetCppHeader().empty()) {
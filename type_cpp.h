@@ -93,6 +93,8 @@ class TypeNamespace : public ::android::aidl::LanguageTypeNamespace<Type> {
   virtual ~TypeNamespace() = default;
 
   void Init() override;
+  // Instead of Init(), share the built in types of |parent|.
+  void InitFromParent(const TypeNamespace& parent);
   bool AddParcelableType(const AidlParcelable& p,
                          const std::string& filename) override;
   bool AddBinderType(const AidlInterface& b,
@@ -18,6 +18,8 @@
 
 #include <sys/types.h>
 
+#include <mutex>
+
 #include <android-base/strings.h>
 
 #include "aidl_language.h"
@@ -852,34 +854,76 @@ void JavaTypeNamespace::Init() {
   m_classloader_type = new class ClassLoaderType(this);
   Add(m_classloader_type);
 
-  NULL_VALUE = new LiteralExpression("null");
-  THIS_VALUE = new LiteralExpression("this");
-  SUPER_VALUE = new LiteralExpression("super");
-  TRUE_VALUE = new LiteralExpression("true");
-  FALSE_VALUE = new LiteralExpression("false");
+  // Shared by every generated tree, so only ever created once.
+  static std::once_flag values_created;
+  std::call_once(values_created, []() {
+    NULL_VALUE = new LiteralExpression("null");
+    THIS_VALUE = new LiteralExpression("this");
+    SUPER_VALUE = new LiteralExpression("super");
+    TRUE_VALUE = new LiteralExpression("true");
+    FALSE_VALUE = new LiteralExpression("false");
+  });
+}
+
+void JavaTypeNamespace::InitFromParent(const JavaTypeNamespace& parent) {
+  SetParent(&parent);
+  m_bool_type = parent.m_bool_type;
+  m_int_type = parent.m_int_type;
+  m_string_type = parent.m_string_type;
+  m_text_utils_type = parent.m_text_utils_type;
+  m_remote_exception_type = parent.m_remote_exception_type;
+  m_runtime_exception_type = parent.m_runtime_exception_type;
+  m_ibinder_type = parent.m_ibinder_type;
+  m_iinterface_type = parent.m_iinterface_type;
+  m_binder_native_type = parent.m_binder_native_type;
+  m_binder_proxy_type = parent.m_binder_proxy_type;
+  m_parcel_type = parent.m_parcel_type;
+  m_parcelable_interface_type = parent.m_parcelable_interface_type;
+  m_context_type = parent.m_context_type;
+  m_classloader_type = parent.m_classloader_type;
 }
 
 bool JavaTypeNamespace::AddParcelableType(const AidlParcelable& p,
                                           const std::string& filename) {
-  Type* type =
-      new UserDataType(this, p.GetPackage(), p.GetName(), false,
-                       true, filename, p.GetLine());
-  return Add(type);
+  return AddUserDataType(p.GetPackage(), p.GetName(), filename, p.GetLine());
 }
 
 bool JavaTypeNamespace::AddBinderType(const AidlInterface& b,
                                       const std::string& filename) {
+  return AddInterfaceType(b.GetPackage(), b.GetName(), b.IsOneway(), filename,
+                          b.GetLine());
+}
+
+bool JavaTypeNamespace::AddPreprocessedType(PreprocessedKind kind,
+                                            const string& package,
+                                            const string& name,
+                                            const string& filename, int line) {
+  if (kind == PreprocessedKind::PARCELABLE) {
+    return AddUserDataType(package, name, filename, line);
+  }
+  return AddInterfaceType(package, name, false, filename, line);
+}
+
+bool JavaTypeNamespace::AddUserDataType(const string& package,
+                                        const string& name,
+                                        const string& filename, int line) {
+  Type* type =
+      new UserDataType(this, package, name, false, true, filename, line);
+  return Add(type);
+}
+
+bool JavaTypeNamespace::AddInterfaceType(const string& package,
+                                         const string& name, bool oneway,
+                                         const string& filename, int line) {
   // for interfaces, add the stub, proxy, and interface types.
-  Type* stub = new Type(this, b.GetPackage(),
-                        b.GetName() + ".Stub", ValidatableType::KIND_GENERATED,
-                        false, false, filename, b.GetLine());
-  Type* proxy = new Type(this, b.GetPackage(),
-                         b.GetName() + ".Stub.Proxy",
+  Type* stub = new Type(this, package, name + ".Stub",
+                        ValidatableType::KIND_GENERATED,
+                        false, false, filename, line);
+  Type* proxy = new Type(this, package, name + ".Stub.Proxy",
                          ValidatableType::KIND_GENERATED,
-                         false, false, filename, b.GetLine());
-  Type* type =
-      new InterfaceType(this, b.GetPackage(), b.GetName(), false,
-                        b.IsOneway(), filename, b.GetLine(), stub, proxy);
+                         false, false, filename, line);
+  Type* type = new InterfaceType(this, package, name, false, oneway,
+                                 filename, line, stub, proxy);
 
   bool success = true;
   success &= Add(type);
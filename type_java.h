@@ -441,10 +441,15 @@ class JavaTypeNamespace : public LanguageTypeNamespace<Type> {
   virtual ~JavaTypeNamespace() = default;
 
   void Init() override;
+  // Instead of Init(), share the built in types of |parent|.
+  void InitFromParent(const JavaTypeNamespace& parent);
   bool AddParcelableType(const AidlParcelable& p,
                          const std::string& filename) override;
   bool AddBinderType(const AidlInterface& b,
                      const std::string& filename) override;
+  bool AddPreprocessedType(PreprocessedKind kind, const std::string& package,
+                           const std::string& name,
+                           const std::string& filename, int line) override;
   bool AddListType(const std::string& contained_type_name) override;
   bool AddMapType(const std::string& key_type_name,
                   const std::string& value_type_name) override;
@@ -467,6 +472,13 @@ class JavaTypeNamespace : public LanguageTypeNamespace<Type> {
   const Type* ClassLoaderType() const { return m_classloader_type; }
 
  private:
+  // Add the type of a parcelable, or the types of an interface and its stub
+  // and proxy, named |name| in |package|.
+  bool AddUserDataType(const std::string& package, const std::string& name,
+                       const std::string& filename, int line);
+  bool AddInterfaceType(const std::string& package, const std::string& name,
+                        bool oneway, const std::string& filename, int line);
+
   const Type* m_bool_type{nullptr};
   const Type* m_int_type{nullptr};
   const Type* m_string_type{nullptr};
@@ -15,6 +15,8 @@
  */
 
 #include <memory>
+#include <string>
+#include <vector>
 
 #include <gtest/gtest.h>
 
@@ -59,6 +61,33 @@ TEST_F(JavaTypeNamespaceTest, ContainerTypeCreation) {
   EXPECT_TRUE(types_.HasTypeByCanonicalName("java.util.List<a.goog.Foo>"));
 }
 
+TEST_F(JavaTypeNamespaceTest, PrefersCanonicalThenLastShortName) {
+  std::vector<unique_ptr<AidlParcelable>> parcelables;
+  auto add_parcelable = [&parcelables](JavaTypeNamespace* types,
+                                       const std::string& package) {
+    parcelables.emplace_back(
+        new AidlParcelable(new AidlQualifiedName("Foo", ""), 0, {package}));
+    EXPECT_TRUE(types->AddParcelableType(*parcelables.back(), __FILE__));
+  };
+  add_parcelable(&types_, "a");
+  add_parcelable(&types_, "b");
+
+  const Type* a_foo = types_.FindTypeByCanonicalName("a.Foo");
+  ASSERT_NE(nullptr, a_foo);
+  EXPECT_EQ("a.Foo", a_foo->CanonicalName());
+  EXPECT_EQ(a_foo, types_.FindTypeByCanonicalName(" a.Foo\n"));
+  ASSERT_NE(nullptr, types_.FindTypeByCanonicalName("Foo"));
+  EXPECT_EQ("b.Foo", types_.FindTypeByCanonicalName("Foo")->CanonicalName());
+
+  // Short names resolve in the closest namespace, but exact matches win.
+  JavaTypeNamespace child;
+  child.InitFromParent(types_);
+  add_parcelable(&child, "c");
+  ASSERT_NE(nullptr, child.FindTypeByCanonicalName("Foo"));
+  EXPECT_EQ("c.Foo", child.FindTypeByCanonicalName("Foo")->CanonicalName());
+  EXPECT_EQ(a_foo, child.FindTypeByCanonicalName("a.Foo"));
+}
+
 }  // namespace java
 }  // namespace android
 }  // namespace aidl
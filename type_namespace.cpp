@@ -93,6 +93,21 @@ string ValidatableType::HumanReadableKind() const {
   return "unknown";
 }
 
+bool TypeNamespace::AddPreprocessedType(PreprocessedKind kind,
+                                        const string& package,
+                                        const string& name,
+                                        const string& filename, int line) {
+  const vector<string> split_package =
+      package.empty() ? vector<string>{} : Split(package, ".");
+  if (kind == PreprocessedKind::PARCELABLE) {
+    AidlParcelable doc(new AidlQualifiedName(name, ""), line, split_package);
+    return AddParcelableType(doc, filename);
+  }
+  auto temp = new std::vector<std::unique_ptr<AidlMember>>();
+  AidlInterface doc(name, line, "", false, temp, split_package);
+  return AddBinderType(doc, filename);
+}
+
 bool TypeNamespace::IsValidPackage(const string& /* package */) const {
   return true;
 }
@@ -17,15 +17,22 @@
 #ifndef AIDL_TYPE_NAMESPACE_H_
 #define AIDL_TYPE_NAMESPACE_H_
 
+#include <ctype.h>
+
 #include <memory>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 #include <android-base/macros.h>
 #include <android-base/stringprintf.h>
 #include <android-base/strings.h>
 
 #include "aidl_language.h"
+#include "io_delegate.h"
 #include "logging.h"
+#include "preprocessed_file.h"
+#include "trace.h"
 
 namespace android {
 namespace aidl {
@@ -99,6 +106,18 @@ class TypeNamespace {
                                  const std::string& filename) = 0;
   virtual bool AddBinderType(const AidlInterface& b,
                              const std::string& filename) = 0;
+  // Load this TypeNamespace with the type named |name| in |package| that
+  // line |line| of the preprocessed file |filename| declares.  By default
+  // this goes through AddParcelableType() or AddBinderType().
+  virtual bool AddPreprocessedType(PreprocessedKind kind,
+                                   const std::string& package,
+                                   const std::string& name,
+                                   const std::string& filename, int line);
+  // Makes the declarations of the binary preprocessed file in |buffer|
+  // visible through this namespace.  Each is only loaded once it is looked
+  // up.  Returns false if the file is malformed.
+  virtual bool AddBinaryPreprocessedFile(std::unique_ptr<SourceBuffer> buffer,
+                                         const std::string& filename) = 0;
   // Add a container type to this namespace.  Returns false only
   // on error. Silently discards requests to add non-container types.
   virtual bool MaybeAddContainerType(const AidlType& aidl_type) = 0;
@@ -165,6 +184,9 @@ class LanguageTypeNamespace : public TypeNamespace {
     return FindTypeByCanonicalName(interface.GetCanonicalName());
   }
 
+  bool AddBinaryPreprocessedFile(std::unique_ptr<SourceBuffer> buffer,
+                                 const std::string& filename) override;
+
   bool MaybeAddContainerType(const AidlType& aidl_type) override;
   // We dynamically create container types as we discover them in the parse
   // tree.  Returns false if the contained types cannot be canonicalized.
@@ -175,6 +197,12 @@ class LanguageTypeNamespace : public TypeNamespace {
  protected:
   bool Add(const T* type);
 
+  // Makes every type of |parent| visible through this namespace, as though
+  // they had been added before any type of this namespace.  Nothing is copied,
+  // so |parent| must not change and must outlive this namespace.  This lets
+  // several compilations share the built in and preprocessed types.
+  void SetParent(const LanguageTypeNamespace<T>* parent) { parent_ = parent; }
+
  private:
   // Returns true iff the name can be canonicalized to a container type.
   virtual bool CanonicalizeContainerType(
@@ -189,7 +217,29 @@ class LanguageTypeNamespace : public TypeNamespace {
       const AidlType& type, std::string* error_msg,
       const AidlInterface& interface) const override;
 
+  // A binary preprocessed file, mapped for as long as its declarations may be
+  // looked up.
+  struct PreprocessedFile {
+    std::unique_ptr<SourceBuffer> buffer;
+    BinaryPreprocessedFile file;
+    std::string filename;
+  };
+  // Loads the |i|th declaration of |file| and returns its type.  Types are
+  // loaded into the namespace looked through, never into the one |file|
+  // belongs to, since only the former belongs to a single compilation.
+  const T* LoadPreprocessedType(const PreprocessedFile& file, size_t i) const;
+
   std::vector<std::unique_ptr<const T>> types_;
+  // Index |types_| by canonical name, keeping the first type added, and by
+  // short name, keeping the last, as a scan of |types_| would find them.
+  // Types loaded from binary preprocessed files are left out of the latter.
+  std::unordered_map<std::string, const T*> types_by_canonical_name_;
+  std::unordered_map<std::string, const T*> types_by_short_name_;
+  const LanguageTypeNamespace<T>* parent_ = nullptr;
+  std::vector<std::unique_ptr<PreprocessedFile>> preprocessed_files_;
+  // Set while a preprocessed type is loaded, when lookups must only see the
+  // types loaded already.
+  mutable bool loading_preprocessed_type_ = false;
 
   DISALLOW_COPY_AND_ASSIGN(LanguageTypeNamespace);
 };  // class LanguageTypeNamespace
@@ -199,6 +249,12 @@ bool LanguageTypeNamespace<T>::Add(const T* type) {
   const T* existing = FindTypeByCanonicalName(type->CanonicalName());
   if (!existing) {
     types_.emplace_back(type);
+    types_by_canonical_name_.emplace(type->CanonicalName(), type);
+    // Preprocessed types are found by short name through their files, which
+    // know the last declaration of each, whatever was loaded first.
+    if (!loading_preprocessed_type_) {
+      types_by_short_name_[type->ShortName()] = type;
+    }
     return true;
   }
 
@@ -229,6 +285,7 @@ const T* LanguageTypeNamespace<T>::Find(const AidlType& aidl_type) const {
   using android::base::Join;
   using android::base::Trim;
 
+  TraceSpan span("TypeNamespace::Find");
   string name = Trim(aidl_type.GetName());
   if (IsContainerType(name)) {
     vector<string> container_class;
@@ -249,22 +306,97 @@ const T* LanguageTypeNamespace<T>::FindTypeByCanonicalName(
     const std::string& raw_name) const {
   using android::base::Trim;
 
-  std::string name = Trim(raw_name);
-  const T* ret = nullptr;
-  for (const auto& type : types_) {
-    // Always prefer a exact match if possible.
-    // This works for primitives and class names qualified with a package.
-    if (type->CanonicalName() == name) {
-      ret = type.get();
-      break;
+  // Names rarely come with surrounding whitespace, so avoid copying them.
+  std::string trimmed_name;
+  const std::string* name = &raw_name;
+  if (!raw_name.empty() &&
+      (isspace(static_cast<unsigned char>(raw_name.front())) ||
+       isspace(static_cast<unsigned char>(raw_name.back())))) {
+    trimmed_name = Trim(raw_name);
+    name = &trimmed_name;
+  }
+
+  // Always prefer a exact match if possible.
+  // This works for primitives and class names qualified with a package.
+  // Types are never added over a type of the same name in a parent, so there
+  // is at most one.
+  for (const LanguageTypeNamespace<T>* ns = this; ns; ns = ns->parent_) {
+    const auto exact_match = ns->types_by_canonical_name_.find(*name);
+    if (exact_match != ns->types_by_canonical_name_.end()) {
+      return exact_match->second;
+    }
+  }
+  size_t i = 0;
+  if (!loading_preprocessed_type_) {
+    for (const LanguageTypeNamespace<T>* ns = this; ns; ns = ns->parent_) {
+      for (const auto& file : ns->preprocessed_files_) {
+        if (file->file.Find(*name, &i)) {
+          return LoadPreprocessedType(*file, i);
+        }
+      }
+    }
+  }
+
+  // We allow authors to drop packages when refering to a class name.
+  // Types of this namespace come after those of its parents, so the last
+  // short name match is the one found in the closest namespace.
+  for (const LanguageTypeNamespace<T>* ns = this; ns; ns = ns->parent_) {
+    const auto short_name_match = ns->types_by_short_name_.find(*name);
+    if (short_name_match != ns->types_by_short_name_.end()) {
+      return short_name_match->second;
+    }
+    if (loading_preprocessed_type_) {
+      continue;
     }
-    // We allow authors to drop packages when refering to a class name.
-    if (type->ShortName() == name) {
-      ret = type.get();
+    // Later files declare later types.
+    for (auto it = ns->preprocessed_files_.rbegin();
+         it != ns->preprocessed_files_.rend(); ++it) {
+      if ((*it)->file.FindShortName(*name, &i)) {
+        return LoadPreprocessedType(**it, i);
+      }
     }
   }
 
-  return ret;
+  return nullptr;
+}
+
+template<typename T>
+bool LanguageTypeNamespace<T>::AddBinaryPreprocessedFile(
+    std::unique_ptr<SourceBuffer> buffer, const std::string& filename) {
+  std::unique_ptr<PreprocessedFile> file(new PreprocessedFile);
+  if (!file->file.Open(buffer->data(), buffer->size())) {
+    return false;
+  }
+  file->buffer = std::move(buffer);
+  file->filename = filename;
+  preprocessed_files_.push_back(std::move(file));
+  return true;
+}
+
+template<typename T>
+const T* LanguageTypeNamespace<T>::LoadPreprocessedType(
+    const PreprocessedFile& file, size_t i) const {
+  PreprocessedKind kind;
+  std::string canonical_name;
+  file.file.GetDeclaration(i, &kind, &canonical_name);
+  // The class name is cut off at the last dot, as for the text format.
+  const size_t dot_pos = canonical_name.rfind('.');
+  const std::string package =
+      dot_pos == std::string::npos ? "" : canonical_name.substr(0, dot_pos);
+  const std::string class_name = dot_pos == std::string::npos
+                                     ? canonical_name
+                                     : canonical_name.substr(dot_pos + 1);
+
+  // Lookups are const, but loading only adds what was always visible.
+  LanguageTypeNamespace<T>* self = const_cast<LanguageTypeNamespace<T>*>(this);
+  loading_preprocessed_type_ = true;
+  // Declarations stand in for the lines of a text file.
+  self->AddPreprocessedType(kind, package, class_name, file.filename, i + 1);
+  // A type of the same name that was loaded already wins, as it would have
+  // when adding every declaration up front.
+  const T* type = FindTypeByCanonicalName(canonical_name);
+  loading_preprocessed_type_ = false;
+  return type;
 }
 
 template<typename T>
@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2018, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <string>
+
+#include <android-base/stringprintf.h>
+#include <benchmark/benchmark.h>
+
+#include "aidl_language.h"
+#include "type_java.h"
+
+using android::base::StringPrintf;
+using std::string;
+
+namespace android {
+namespace aidl {
+namespace java {
+namespace {
+
+// Adds |count| parcelables to |types|, as a large preprocessed file would.
+void AddParcelables(int count, JavaTypeNamespace* types) {
+  for (int i = 0; i < count; ++i) {
+    AidlParcelable parcelable(
+        new AidlQualifiedName(StringPrintf("Parcelable%d", i), ""), 0,
+        {"android", StringPrintf("pkg%d", i % 64)});
+    types->AddParcelableType(parcelable, "preprocessed");
+  }
+}
+
+// Looks up the last parcelable added by its canonical name.
+void BM_FindTypeByCanonicalName(benchmark::State& state) {
+  JavaTypeNamespace types;
+  types.Init();
+  const int count = state.range(0);
+  AddParcelables(count, &types);
+  const string name = StringPrintf("android.pkg%d.Parcelable%d",
+                                   (count - 1) % 64, count - 1);
+  while (state.KeepRunning()) {
+    benchmark::DoNotOptimize(types.FindTypeByCanonicalName(name));
+  }
+  state.SetComplexityN(count);
+}
+BENCHMARK(BM_FindTypeByCanonicalName)
+    ->RangeMultiplier(4)->Range(16, 16384)->Complexity();
+
+// Looks up the last parcelable added by its class name alone.
+void BM_FindTypeByShortName(benchmark::State& state) {
+  JavaTypeNamespace types;
+  types.Init();
+  const int count = state.range(0);
+  AddParcelables(count, &types);
+  const string name = StringPrintf("Parcelable%d", count - 1);
+  while (state.KeepRunning()) {
+    benchmark::DoNotOptimize(types.FindTypeByCanonicalName(name));
+  }
+  state.SetComplexityN(count);
+}
+BENCHMARK(BM_FindTypeByShortName)
+    ->RangeMultiplier(4)->Range(16, 16384)->Complexity();
+
+// Looks up a built in type through a namespace sharing the types of another.
+void BM_FindTypeInParent(benchmark::State& state) {
+  JavaTypeNamespace parent;
+  parent.Init();
+  const int count = state.range(0);
+  AddParcelables(count, &parent);
+  JavaTypeNamespace types;
+  types.InitFromParent(parent);
+  while (state.KeepRunning()) {
+    benchmark::DoNotOptimize(types.FindTypeByCanonicalName("java.lang.String"));
+  }
+  state.SetComplexityN(count);
+}
+BENCHMARK(BM_FindTypeInParent)
+    ->RangeMultiplier(4)->Range(16, 16384)->Complexity();
+
+}  // namespace
+}  // namespace java
+}  // namespace aidl
+}  // namespace android
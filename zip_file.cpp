@@ -0,0 +1,316 @@
+/*
+ * Copyright (C) 2018, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "zip_file.h"
+
+#include <string.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+#include "logging.h"
+
+using std::string;
+using std::vector;
+
+namespace android {
+namespace aidl {
+namespace {
+
+const uint32_t kLocalFileHeaderSignature = 0x04034b50;
+const uint32_t kCentralDirectorySignature = 0x02014b50;
+const uint32_t kEndOfCentralDirectorySignature = 0x06054b50;
+// Version 1.0 of the format covers stored files in plain directories.
+const uint16_t kVersionNeeded = 10;
+// 1980-01-01 00:00:00, the earliest time an MS-DOS timestamp holds.
+const uint16_t kDosTime = 0;
+const uint16_t kDosDate = (1 << 5) | 1;
+const uint16_t kMethodStored = 0;
+const uint16_t kMethodDeflated = 8;
+const uint16_t kFlagEncrypted = 1;
+const size_t kLocalFileHeaderSize = 30;
+const size_t kCentralDirectoryHeaderSize = 46;
+const size_t kEndOfCentralDirectorySize = 22;
+
+void WriteUint16(uint16_t value, string* out) {
+  out->push_back(static_cast<char>(value));
+  out->push_back(static_cast<char>(value >> 8));
+}
+
+void WriteUint32(uint32_t value, string* out) {
+  WriteUint16(static_cast<uint16_t>(value), out);
+  WriteUint16(static_cast<uint16_t>(value >> 16), out);
+}
+
+uint16_t ReadUint16(const char* data) {
+  const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+  return static_cast<uint16_t>(bytes[0] | (bytes[1] << 8));
+}
+
+uint32_t ReadUint32(const char* data) {
+  return ReadUint16(data) | (static_cast<uint32_t>(ReadUint16(data + 2)) << 16);
+}
+
+// Inflates the raw deflate stream of |length| bytes at |data| into
+// |*contents|, which must already have the inflated size.
+bool Inflate(const char* data, size_t length, string* contents) {
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  if (inflateInit2(&stream, -MAX_WBITS) != Z_OK) {
+    return false;
+  }
+  stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+  stream.avail_in = static_cast<uInt>(length);
+  stream.next_out = reinterpret_cast<Bytef*>(&(*contents)[0]);
+  stream.avail_out = static_cast<uInt>(contents->size());
+  const int result = inflate(&stream, Z_FINISH);
+  inflateEnd(&stream);
+  return result == Z_STREAM_END && stream.avail_out == 0;
+}
+
+// The fields that the local and central headers of an entry share.
+void WriteCommonFields(uint32_t crc, uint32_t size, uint16_t name_length,
+                       string* out) {
+  WriteUint16(kVersionNeeded, out);
+  WriteUint16(0, out);  // flags
+  WriteUint16(0, out);  // stored, not compressed
+  WriteUint16(kDosTime, out);
+  WriteUint16(kDosDate, out);
+  WriteUint32(crc, out);
+  WriteUint32(size, out);  // compressed size
+  WriteUint32(size, out);
+  WriteUint16(name_length, out);
+  WriteUint16(0, out);  // extra field length
+}
+
+}  // namespace
+
+void ZipWriter::AddFile(const string& name, const string& contents) {
+  files_[name] = contents;
+}
+
+void ZipWriter::RemoveFile(const string& name) {
+  files_.erase(name);
+}
+
+bool ZipWriter::Finish(string* archive) const {
+  const uint64_t kMaxOffset = std::numeric_limits<uint32_t>::max();
+  if (files_.size() > std::numeric_limits<uint16_t>::max()) {
+    LOG(ERROR) << "Too many files for a zip archive: " << files_.size();
+    return false;
+  }
+
+  archive->clear();
+  string central_directory;
+  for (const auto& file : files_) {
+    const string& name = file.first;
+    const string& contents = file.second;
+    if (name.size() > std::numeric_limits<uint16_t>::max() ||
+        archive->size() + contents.size() + name.size() + 30 > kMaxOffset) {
+      LOG(ERROR) << "Zip archive too large at " << name;
+      return false;
+    }
+    const uint32_t crc = Crc32(contents.data(), contents.size());
+    const uint32_t size = static_cast<uint32_t>(contents.size());
+    const uint16_t name_length = static_cast<uint16_t>(name.size());
+    const uint32_t offset = static_cast<uint32_t>(archive->size());
+
+    WriteUint32(kLocalFileHeaderSignature, archive);
+    WriteCommonFields(crc, size, name_length, archive);
+    archive->append(name);
+    archive->append(contents);
+
+    WriteUint32(kCentralDirectorySignature, &central_directory);
+    WriteUint16(kVersionNeeded, &central_directory);  // version made by
+    WriteCommonFields(crc, size, name_length, &central_directory);
+    WriteUint16(0, &central_directory);  // comment length
+    WriteUint16(0, &central_directory);  // disk number
+    WriteUint16(0, &central_directory);  // internal attributes
+    WriteUint32(0, &central_directory);  // external attributes
+    WriteUint32(offset, &central_directory);
+    central_directory.append(name);
+  }
+  if (archive->size() + central_directory.size() > kMaxOffset) {
+    LOG(ERROR) << "Zip archive too large";
+    return false;
+  }
+
+  const uint16_t num_files = static_cast<uint16_t>(files_.size());
+  const uint32_t directory_offset = static_cast<uint32_t>(archive->size());
+  archive->append(central_directory);
+  WriteUint32(kEndOfCentralDirectorySignature, archive);
+  WriteUint16(0, archive);  // this disk
+  WriteUint16(0, archive);  // disk holding the central directory
+  WriteUint16(num_files, archive);  // entries on this disk
+  WriteUint16(num_files, archive);
+  WriteUint32(static_cast<uint32_t>(central_directory.size()), archive);
+  WriteUint32(directory_offset, archive);
+  WriteUint16(0, archive);  // comment length
+  return true;
+}
+
+bool ZipReader::Open(const char* data, size_t size) {
+  data_ = data;
+  size_ = size;
+  entries_.clear();
+  if (size < kEndOfCentralDirectorySize) {
+    return false;
+  }
+
+  // The end of central directory record is followed by a comment of up to
+  // 64 KiB, so search backwards for it.
+  size_t end = size - kEndOfCentralDirectorySize;
+  const size_t first = end > std::numeric_limits<uint16_t>::max()
+                           ? end - std::numeric_limits<uint16_t>::max()
+                           : 0;
+  while (ReadUint32(data + end) != kEndOfCentralDirectorySignature) {
+    if (end == first) {
+      return false;
+    }
+    --end;
+  }
+  const uint16_t num_files = ReadUint16(data + end + 10);
+  const uint32_t directory_size = ReadUint32(data + end + 12);
+  const uint32_t directory_offset = ReadUint32(data + end + 16);
+  if (directory_offset > end || directory_size > end - directory_offset) {
+    LOG(ERROR) << "Zip archive needs zip64 or is corrupt";
+    return false;
+  }
+
+  const char* entry = data + directory_offset;
+  const char* const directory_end = entry + directory_size;
+  for (uint16_t i = 0; i < num_files; ++i) {
+    if (directory_end - entry < static_cast<ptrdiff_t>(
+            kCentralDirectoryHeaderSize) ||
+        ReadUint32(entry) != kCentralDirectorySignature) {
+      LOG(ERROR) << "Corrupt zip central directory";
+      return false;
+    }
+    const size_t name_length = ReadUint16(entry + 28);
+    const size_t record_size = kCentralDirectoryHeaderSize + name_length +
+                               ReadUint16(entry + 30) + ReadUint16(entry + 32);
+    if (directory_end - entry < static_cast<ptrdiff_t>(record_size)) {
+      LOG(ERROR) << "Corrupt zip central directory";
+      return false;
+    }
+    string name(entry + kCentralDirectoryHeaderSize, name_length);
+    // Directories are implied by the names of the files in them.
+    if (!name.empty() && name.back() != '/') {
+      Entry& file = entries_[std::move(name)];
+      file.flags = ReadUint16(entry + 8);
+      file.method = ReadUint16(entry + 10);
+      file.crc = ReadUint32(entry + 16);
+      file.compressed_size = ReadUint32(entry + 20);
+      file.size = ReadUint32(entry + 24);
+      file.local_header_offset = ReadUint32(entry + 42);
+    }
+    entry += record_size;
+  }
+  return true;
+}
+
+bool ZipReader::HasFile(const string& name) const {
+  return entries_.find(name) != entries_.end();
+}
+
+bool ZipReader::GetFileSize(const string& name, int64_t* size) const {
+  const auto it = entries_.find(name);
+  if (it == entries_.end()) {
+    return false;
+  }
+  *size = it->second.size;
+  return true;
+}
+
+void ZipReader::ListFiles(const string& prefix, vector<string>* names) const {
+  for (auto it = entries_.lower_bound(prefix);
+       it != entries_.end() && it->first.compare(0, prefix.size(), prefix) == 0;
+       ++it) {
+    names->push_back(it->first);
+  }
+}
+
+bool ZipReader::ReadFile(const string& name, string* contents) const {
+  const auto it = entries_.find(name);
+  if (it == entries_.end()) {
+    return false;
+  }
+  const Entry& file = it->second;
+  if (file.flags & kFlagEncrypted) {
+    LOG(ERROR) << "Cannot extract encrypted zip entry " << name;
+    return false;
+  }
+  const size_t offset = file.local_header_offset;
+  if (offset > size_ || size_ - offset < kLocalFileHeaderSize ||
+      ReadUint32(data_ + offset) != kLocalFileHeaderSignature) {
+    LOG(ERROR) << "Corrupt zip entry " << name;
+    return false;
+  }
+  // The local header may carry different extra fields than the central one.
+  const size_t data_offset = offset + kLocalFileHeaderSize +
+                             ReadUint16(data_ + offset + 26) +
+                             ReadUint16(data_ + offset + 28);
+  if (data_offset > size_ || size_ - data_offset < file.compressed_size) {
+    LOG(ERROR) << "Corrupt zip entry " << name;
+    return false;
+  }
+
+  const char* const data = data_ + data_offset;
+  switch (file.method) {
+    case kMethodStored:
+      if (file.compressed_size != file.size) {
+        LOG(ERROR) << "Corrupt zip entry " << name;
+        return false;
+      }
+      contents->assign(data, file.size);
+      break;
+    case kMethodDeflated:
+      contents->assign(file.size, '\0');
+      if (!Inflate(data, file.compressed_size, contents)) {
+        LOG(ERROR) << "Could not inflate zip entry " << name;
+        return false;
+      }
+      break;
+    default:
+      LOG(ERROR) << "Unsupported compression method for zip entry " << name;
+      return false;
+  }
+  if (Crc32(contents->data(), contents->size()) != file.crc) {
+    LOG(ERROR) << "Corrupt zip entry " << name;
+    return false;
+  }
+  return true;
+}
+
+uint32_t Crc32(const void* data, size_t length) {
+  const Bytef* bytes = static_cast<const Bytef*>(data);
+  uLong crc = crc32(0, Z_NULL, 0);
+  // zlib takes the length in a uInt, which may be narrower than size_t.
+  while (length > 0) {
+    const uInt chunk = static_cast<uInt>(
+        std::min<size_t>(length, std::numeric_limits<uInt>::max()));
+    crc = crc32(crc, bytes, chunk);
+    bytes += chunk;
+    length -= chunk;
+  }
+  return static_cast<uint32_t>(crc);
+}
+
+}  // namespace aidl
+}  // namespace android
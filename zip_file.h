@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2018, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef AIDL_ZIP_FILE_H_
+#define AIDL_ZIP_FILE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <android-base/macros.h>
+
+namespace android {
+namespace aidl {
+
+// Builds a zip archive of stored, uncompressed files in memory.  The archive
+// depends only on the files in it: entries are written sorted by name, and
+// all carry the same timestamp, so that rebuilding an unchanged archive gives
+// identical bytes.
+class ZipWriter {
+ public:
+  ZipWriter() = default;
+  ~ZipWriter() = default;
+
+  // Adds |contents| as the file |name|, replacing any file of that name.
+  // Names use '/' as the separator, whatever the host.
+  void AddFile(const std::string& name, const std::string& contents);
+  void RemoveFile(const std::string& name);
+  size_t NumFiles() const { return files_.size(); }
+
+  // Stores the archive to |*archive|.  Returns false if the files do not fit
+  // in a zip archive without the zip64 extensions.
+  bool Finish(std::string* archive) const;
+
+ private:
+  std::map<std::string, std::string> files_;
+
+  DISALLOW_COPY_AND_ASSIGN(ZipWriter);
+};
+
+// Reads the files of a zip archive held in memory.  Only the central
+// directory is read up front; files are extracted as they are asked for.
+// Files may be stored or deflated, but not encrypted or in zip64 archives.
+class ZipReader {
+ public:
+  ZipReader() = default;
+  ~ZipReader() = default;
+
+  // Reads the central directory of the |size| bytes at |data|, which must
+  // outlive the reader.  Returns false if they are not a zip archive.
+  bool Open(const char* data, size_t size);
+
+  bool HasFile(const std::string& name) const;
+  // Stores the size of the file |name| once extracted to |*size|.  Returns
+  // false if there is no such file.
+  bool GetFileSize(const std::string& name, int64_t* size) const;
+  // Appends the names of the files whose names start with |prefix|, in
+  // order, to |*names|.
+  void ListFiles(const std::string& prefix,
+                 std::vector<std::string>* names) const;
+  // Stores the contents of the file |name| to |*contents|.  Returns false if
+  // there is no such file, or it cannot be extracted.
+  bool ReadFile(const std::string& name, std::string* contents) const;
+
+ private:
+  struct Entry {
+    uint16_t flags;
+    uint16_t method;
+    uint32_t crc;
+    uint32_t compressed_size;
+    uint32_t size;
+    uint32_t local_header_offset;
+  };
+
+  const char* data_ = nullptr;
+  size_t size_ = 0;
+  std::map<std::string, Entry> entries_;
+
+  DISALLOW_COPY_AND_ASSIGN(ZipReader);
+};
+
+// Returns the CRC-32 of |length| bytes at |data|, as zip archives use it.
+uint32_t Crc32(const void* data, size_t length);
+
+}  // namespace aidl
+}  // namespace android
+
+#endif  // AIDL_ZIP_FILE_H_
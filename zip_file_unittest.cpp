@@ -0,0 +1,165 @@
+/*
+ * Copyright (C) 2018, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "zip_file.h"
+
+using std::string;
+using std::vector;
+
+namespace android {
+namespace aidl {
+
+namespace {
+
+uint32_t ReadUint32(const string& data, size_t offset) {
+  uint32_t value = 0;
+  for (int i = 3; i >= 0; --i) {
+    value = (value << 8) | static_cast<uint8_t>(data[offset + i]);
+  }
+  return value;
+}
+
+// A zip archive holding p/IFoo.aidl deflated, as written by Python's zipfile.
+const char kDeflatedArchive[] =
+    "\x50\x4b\x03\x04\x14\x00\x00\x00\x08\x00\x00\x00\x21\x00\x5b\xc7"
+    "\x09\x8b\x2c\x00\x00\x00\x35\x00\x00\x00\x0b\x00\x00\x00\x70\x2f"
+    "\x49\x46\x6f\x6f\x2e\x61\x69\x64\x6c\x2b\x48\x4c\xce\x4e\x4c\x4f"
+    "\x55\x28\xb0\x56\xc8\xcc\x2b\x49\x2d\x4a\x4b\x4c\x4e\x55\xf0\x74"
+    "\xcb\xcf\x57\xa8\x56\x28\xcb\xcf\x4c\x51\x48\xcb\xcf\xd7\xd0\xb4"
+    "\x46\x61\xd7\x02\x00\x50\x4b\x01\x02\x14\x03\x14\x00\x00\x00\x08"
+    "\x00\x00\x00\x21\x00\x5b\xc7\x09\x8b\x2c\x00\x00\x00\x35\x00\x00"
+    "\x00\x0b\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x80\x01\x00"
+    "\x00\x00\x00\x70\x2f\x49\x46\x6f\x6f\x2e\x61\x69\x64\x6c\x50\x4b"
+    "\x05\x06\x00\x00\x00\x00\x01\x00\x01\x00\x39\x00\x00\x00\x55\x00"
+    "\x00\x00\x00\x00";
+
+}  // namespace
+
+TEST(ZipFileTest, ComputesCrc32) {
+  EXPECT_EQ(0u, Crc32("", 0));
+  EXPECT_EQ(0xcbf43926u, Crc32("123456789", 9));
+}
+
+TEST(ZipFileTest, WritesDeterministicArchives) {
+  ZipWriter first;
+  first.AddFile("p/IFoo.java", "foo");
+  first.AddFile("p/IBar.java", "stale");
+  first.AddFile("p/IBar.java", "bar");
+  first.AddFile("gone.java", "");
+  first.RemoveFile("gone.java");
+  ZipWriter second;
+  second.AddFile("p/IBar.java", "bar");
+  second.AddFile("p/IFoo.java", "foo");
+  EXPECT_EQ(2u, first.NumFiles());
+
+  string archive;
+  ASSERT_TRUE(first.Finish(&archive));
+  string other;
+  ASSERT_TRUE(second.Finish(&other));
+  EXPECT_EQ(archive, other);
+
+  // A stored entry: local header, name, then the contents verbatim.
+  EXPECT_EQ(0x04034b50u, ReadUint32(archive, 0));
+  EXPECT_EQ(Crc32("bar", 3), ReadUint32(archive, 14));
+  EXPECT_EQ(3u, ReadUint32(archive, 18));
+  EXPECT_EQ("p/IBar.javabar", archive.substr(30, 14));
+
+  // The end record points back at two central directory entries.
+  const size_t end = archive.size() - 22;
+  EXPECT_EQ(0x06054b50u, ReadUint32(archive, end));
+  EXPECT_EQ(2u, ReadUint32(archive, end + 8) & 0xffff);
+  const uint32_t directory_offset = ReadUint32(archive, end + 16);
+  EXPECT_EQ(end, directory_offset + ReadUint32(archive, end + 12));
+  EXPECT_EQ(0x02014b50u, ReadUint32(archive, directory_offset));
+}
+
+TEST(ZipFileTest, WritesEmptyArchives) {
+  ZipWriter writer;
+  string archive;
+  ASSERT_TRUE(writer.Finish(&archive));
+  ASSERT_EQ(22u, archive.size());
+  EXPECT_EQ(0x06054b50u, ReadUint32(archive, 0));
+}
+
+TEST(ZipFileTest, ReadsWrittenArchives) {
+  ZipWriter writer;
+  writer.AddFile("p/IFoo.aidl", "package p; interface IFoo {}");
+  writer.AddFile("p/q/IBar.aidl", "");
+  writer.AddFile("r/IBaz.aidl", "package r; interface IBaz {}");
+  string archive;
+  ASSERT_TRUE(writer.Finish(&archive));
+
+  ZipReader reader;
+  ASSERT_TRUE(reader.Open(archive.data(), archive.size()));
+  EXPECT_TRUE(reader.HasFile("p/q/IBar.aidl"));
+  EXPECT_FALSE(reader.HasFile("p/q"));
+  vector<string> names;
+  reader.ListFiles("p/", &names);
+  EXPECT_EQ((vector<string>{"p/IFoo.aidl", "p/q/IBar.aidl"}), names);
+
+  string contents;
+  ASSERT_TRUE(reader.ReadFile("r/IBaz.aidl", &contents));
+  EXPECT_EQ("package r; interface IBaz {}", contents);
+  ASSERT_TRUE(reader.ReadFile("p/q/IBar.aidl", &contents));
+  EXPECT_EQ("", contents);
+  EXPECT_FALSE(reader.ReadFile("p/IMissing.aidl", &contents));
+
+  int64_t size = -1;
+  ASSERT_TRUE(reader.GetFileSize("r/IBaz.aidl", &size));
+  EXPECT_EQ(28, size);
+  EXPECT_FALSE(reader.GetFileSize("p/IMissing.aidl", &size));
+}
+
+TEST(ZipFileTest, ReadsDeflatedFiles) {
+  ZipReader reader;
+  ASSERT_TRUE(reader.Open(kDeflatedArchive, sizeof(kDeflatedArchive) - 1));
+  string contents;
+  ASSERT_TRUE(reader.ReadFile("p/IFoo.aidl", &contents));
+  EXPECT_EQ("package p; interface IFoo { void foo(); void foo(); }", contents);
+  // Sizes are those of the files once inflated.
+  int64_t size = -1;
+  ASSERT_TRUE(reader.GetFileSize("p/IFoo.aidl", &size));
+  EXPECT_EQ(static_cast<int64_t>(contents.size()), size);
+}
+
+TEST(ZipFileTest, RejectsCorruptArchives) {
+  ZipReader reader;
+  const string not_zip = "package p; interface IFoo {}";
+  EXPECT_FALSE(reader.Open(not_zip.data(), not_zip.size()));
+
+  // A damaged file fails its checksum, but leaves the others readable.
+  ZipWriter writer;
+  writer.AddFile("a", "first");
+  writer.AddFile("b", "second");
+  string archive;
+  ASSERT_TRUE(writer.Finish(&archive));
+  archive[archive.find("first")] = 'F';
+  ASSERT_TRUE(reader.Open(archive.data(), archive.size()));
+  string contents;
+  EXPECT_FALSE(reader.ReadFile("a", &contents));
+  EXPECT_TRUE(reader.ReadFile("b", &contents));
+}
+
+}  // namespace aidl
+}  // namespace android